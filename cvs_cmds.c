@@ -2,10 +2,15 @@
  * File: cvs_cmds.c
  * Functions for communicating with the CVS server. Responses from the server
  * are read into cvs_buff structures, and are read one line at a time by
- * cvs_read_line. 
+ * cvs_read_line. The server is either a pserver, or a "cvs server" we
+ * start ourselves for a :fork: root. When the repository is read directly
+ * (vcfsd -l), each request is answered by cvs_rcs.c instead, with the same
+ * response.
  ****************************************************************************/
 
 #include <sys/poll.h>
+#include <sys/wait.h>
+#include <pthread.h>
 #include "cvs_cmds.h"
 #include "utils.h"
 
@@ -33,6 +38,12 @@ shifts[] =
 static cvs_session *session;
 int DEBUG_RESP = 0;
 
+/* There is only one connection to the server, so only one thread can be
+ * talking to it at a time. Each request holds this until it has read the
+ * whole response.
+ */
+static pthread_mutex_t session_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /* Taken from the cvs client code */
 char *scramble (char *str)
 {
@@ -76,7 +87,8 @@ static struct hostent *init_sockaddr(struct sockaddr_in *name,
 
 /* Set initial CVS session arguments */
 void cvs_init_session(char *hostname, char *root, char *module, char *user,
-                      char *password, char *dir, bool use_gzip, char *tag)
+                      char *password, char *dir, int gzip_level, int method,
+                      char *tag)
 {
     session = (cvs_session *)malloc(sizeof(cvs_session));
 
@@ -86,7 +98,8 @@ void cvs_init_session(char *hostname, char *root, char *module, char *user,
     session->user = strdup(user);
     session->password = scramble(password);
     session->dir = strdup(dir);
-    session->use_gzip = use_gzip;
+    session->gzip_level = gzip_level;
+    session->method = method;
 
     memset(session->tag, 0, sizeof(session->tag));
     if (tag != NULL)
@@ -129,26 +142,80 @@ void cvs_ensure_buff(cvs_buff *b, int n)
     }
 }
 
-/* See if the last thing we read is 'ok', meaning the message from the server
- * has completed successfully, there should be no more data.
+/* How far we have got through a response that is still arriving */
+typedef struct cvs_resp_scan {
+    int pos; /* Where the next line starts */
+    int lines; /* Lines left before the size of a file's contents */
+    int skip; /* Bytes of a file's contents left to step over */
+    int last; /* The last line was 1 'ok', -1 'error', 0 something else */
+} cvs_resp_scan;
+
+/* Look through what has arrived of a response since we last looked. The
+ * server says 'ok' or 'error' on a line of its own when it has finished,
+ * but a file's contents can hold anything (and with Gzip-stream a line can
+ * arrive in pieces), so only whole response lines are looked at, and file
+ * contents are stepped over. Returns 1 if the response ended with 'ok', -1
+ * if it ended with 'error', and 0 if there is more to come.
  */
-int cvs_check_ok(char *c, int n)
+static int cvs_scan_resp(cvs_buff *b, cvs_resp_scan *s)
 {
-    if (n > 0)
-    {
-        return (c[n-3] == 'o' && c[n-2] == 'k' && c[n-1] == '\012');
-    }
-    else
+    char *line;
+    char *nl;
+    int len;
+
+    while (s->pos < b->size)
     {
-        return 0;
+        if (s->skip > 0)
+        {
+            len = b->size - s->pos;
+            if (len > s->skip)
+            {
+                len = s->skip;
+            }
+            s->pos += len;
+            s->skip -= len;
+            continue;
+        }
+
+        line = b->data + s->pos;
+        nl = (char *)memchr(line, '\012', b->size - s->pos);
+        if (nl == NULL)
+        {
+            /* The rest of the line is still to come */
+            return 0;
+        }
+        len = nl - line;
+        s->pos += len + 1;
+        s->last = 0;
+
+        if (s->lines > 0)
+        {
+            /* The repository name, entry line and mode, then the size */
+            if (--s->lines == 0)
+            {
+                s->skip = atoi(line[0] == 'z' ? line + 1 : line);
+            }
+        }
+        else if (len == 2 && !strncmp(line, "ok", 2))
+        {
+            s->last = 1;
+        }
+        else if (len >= 5 && !strncmp(line, "error", 5) &&
+                 (len == 5 || line[5] == ' '))
+        {
+            s->last = -1;
+        }
+        else if (!strncmp(line, "Updated ", 8) ||
+                 !strncmp(line, "Created ", 8) ||
+                 !strncmp(line, "Update-existing ", 16) ||
+                 !strncmp(line, "Merged ", 7) ||
+                 !strncmp(line, "Rcs-diff ", 9))
+        {
+            s->lines = 4;
+        }
     }
-}
 
-/* Look for an error. Currently unused */
-int cvs_check_error(char *c, int n)
-{
-    return (c[n-8] == 'e' && c[n-7] == 'r' && c[n-6] == 'r' 
-            && c[n-5] == 'o' && c[n-4] == 'r');
+    return s->last;
 }
 
 /* Read one line from the buffer into a malloc'ed string.
@@ -190,45 +257,49 @@ int cvs_buff_read_line(cvs_buff *b, char **line)
     return (len + 1);
 }
 
-/* Read a response from the server into a cvs_buff */
-cvs_buff *cvs_get_resp()
+/* Read a response from the server on the given connection into a
+ * cvs_buff
+ */
+static cvs_buff *cvs_read_resp(int sock)
 {
     int n = 0;
     cvs_buff *buff;
     char temp[CVS_READ_SIZE];
     int count = 0;
     struct pollfd fds;
+    cvs_resp_scan scan;
     int result;
+    int done;
 
-    fds.fd = session->sock;
+    fds.fd = sock;
     fds.events = POLLIN; /* Check if there is data waiting to be read */
     fds.revents = 0;
 
+    memset(&scan, 0, sizeof(scan));
     buff = cvs_get_buff();
 
     do 
     {
-        result = poll(&fds, 1, 10000);
+        /* A compressed connection may already have read what comes next */
+        result = cvs_zlib_stream_pending(sock) ? 1 : poll(&fds, 1, 10000);
         
         if (result == 0)
         {
-            /* There is nothing to read */
-            if (cvs_check_ok(temp, n))
-            {
-                /* We finished reading successfully */
-                break;
-            }
-            else
-            {
-                /* There was an error. TODO: Handle this */
-                debug("Error! Client read: \n%s\n", temp);
-                cvs_free_buff(buff);
-                return NULL;  
-            }
+            /* Nothing more has come, and the response isn't finished */
+            debug("Error! Client read: \n%.*s\n", n, temp);
+            cvs_free_buff(buff);
+            return NULL;  
         }
         
         //memset(&temp, 0, CVS_READ_SIZE);
-        n = recv(session->sock, &temp, CVS_READ_SIZE, 0);
+        n = cvs_zlib_stream_recv(sock, temp, CVS_READ_SIZE);
+        if (n <= 0)
+        {
+            /* The server has gone away */
+            fprintf(stderr, "Lost the connection to the CVS server\n");
+            cvs_free_buff(buff);
+            return NULL;
+        }
 
         if (DEBUG_RESP)
         {
@@ -240,14 +311,31 @@ cvs_buff *cvs_get_resp()
         memcpy(buff->data + buff->size, temp, n);
         buff->size += n;
         count++;
-    } while(!cvs_check_ok(temp, n)); /* Read until last thing read is 'ok' */
+
+        done = cvs_scan_resp(buff, &scan);
+        if (done < 0)
+        {
+            /* No need to wait for an 'ok' that isn't coming */
+            debug("Error! Client read: \n%.*s\n", n, temp);
+            cvs_free_buff(buff);
+            return NULL;
+        }
+    } while (done == 0); /* Read until the last thing read is 'ok' */
     
     DEBUG_RESP = 0;
     return buff;
 }
 
-/* Connect to the CVS pserver and authenticate ourselves */
-int cvs_pserver_connect() 
+/* Read a response from the server into a cvs_buff */
+cvs_buff *cvs_get_resp()
+{
+    return cvs_read_resp(session->sock);
+}
+
+/* Open a new connection to the CVS pserver and authenticate ourselves.
+ * Returns the socket, or -1 if we couldn't.
+ */
+static int cvs_pserver_open() 
 {
     int sock;
     struct sockaddr_in client_sock;
@@ -300,6 +388,184 @@ int cvs_pserver_connect()
         return -1;
     }
     
+    return sock;
+}
+
+/* Start a "cvs server" of our own for a :fork: root, and talk to it over a
+ * socket pair, so the rest of the protocol code can't tell it from a
+ * pserver. The program is $CVS_SERVER, or "cvs", as for the cvs client. It
+ * is started from a child that exits straight away, so there is nothing to
+ * wait for when we close the connection. Returns our end of the socket
+ * pair, or -1 if we couldn't.
+ */
+static int cvs_fork_open()
+{
+    char *server;
+    int sv[2];
+    pid_t pid;
+
+    server = getenv("CVS_SERVER");
+    if (server == NULL || server[0] == '\0')
+    {
+        server = "cvs";
+    }
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+    {
+        perror("Cannot create socket pair");
+        return -1;
+    }
+
+    pid = fork();
+    if (pid < 0)
+    {
+        perror("Cannot start cvs server");
+        close(sv[0]);
+        close(sv[1]);
+        return -1;
+    }
+
+    if (pid == 0)
+    {
+        if (fork() == 0)
+        {
+            dup2(sv[1], 0);
+            dup2(sv[1], 1);
+            close(sv[0]);
+            close(sv[1]);
+            execlp(server, server, "server", (char *)NULL);
+            _exit(127);
+        }
+        _exit(0);
+    }
+
+    close(sv[1]);
+    waitpid(pid, NULL, 0);
+
+    return sv[0];
+}
+
+/* Does a Valid-requests response list the given request? */
+static int cvs_valid_request(cvs_buff *resp, char *req)
+{
+    char *line;
+    char *word;
+    char *save;
+    int found = 0;
+
+    while (!found && cvs_buff_read_line(resp, &line) > 0)
+    {
+        if (!strncmp(line, "Valid-requests ", 15))
+        {
+            for (word = strtok_r(line + 15, " ", &save);
+                 word != NULL && !found; word = strtok_r(NULL, " ", &save))
+            {
+                found = !strcmp(word, req);
+            }
+        }
+        free(line);
+    }
+
+    return found;
+}
+
+/* Close a connection to the server */
+static void cvs_close(int sock)
+{
+    cvs_zlib_stream_end(sock);
+    close(sock);
+}
+
+/* Open a new connection to the server, whichever kind it is. Returns the
+ * socket, or -1 if we couldn't.
+ */
+static int cvs_open()
+{
+    cvs_buff *resp;
+    char cmd[sizeof(vcfs_path) + 16];
+    int stream;
+    int sock;
+
+    if (session->method == CVS_METHOD_FORK)
+    {
+        sock = cvs_fork_open();
+    }
+    else
+    {
+        sock = cvs_pserver_open();
+    }
+
+    if (sock < 0)
+    {
+        return -1;
+    }
+
+    /* Every connection needs this once, before anything that isn't about
+     * the protocol itself. Logging in to a pserver doesn't count.
+     */
+    sprintf(cmd, "Root %s\012", session->root);
+    cvs_send(sock, cmd);
+
+    /* Tell the server which responses we understand. Mod-time is the one
+     * that matters: without it we never learn when a file was committed.
+     * MT and Patched are left out so that messages stay plain. Rcs-diff
+     * only comes back when cvs_get_file() says we have another revision.
+     */
+    cvs_send(sock, "Valid-responses ok error Valid-requests Checked-in "
+             "New-entry Checksum Copy-file Updated Created Update-existing "
+             "Merged Removed Remove-entry Set-static-directory "
+             "Clear-static-directory Set-sticky Clear-sticky "
+             "Module-expansion Mod-time Rcs-diff M E\012");
+    
+    if (session->method != CVS_METHOD_FORK && session->gzip_level == 0)
+    {
+        return sock;
+    }
+
+    /* For a :fork: root nothing has answered yet, so this also makes sure
+     * the server started and is happy with the root
+     */
+    cvs_send(sock, "valid-requests\012");
+    resp = cvs_read_resp(sock);
+    if (resp == NULL)
+    {
+        fprintf(stderr, "The cvs server did not answer\n");
+        cvs_close(sock);
+        return -1;
+    }
+    stream = cvs_valid_request(resp, "Gzip-stream");
+    cvs_free_buff(resp);
+
+    /* Compress the whole connection if we can, logs and all. The request
+     * itself goes as it is. It has to come after Root: without one the
+     * server ignores it, and would get zlib it can't read from us.
+     */
+    if (session->gzip_level > 0 && stream)
+    {
+        sprintf(cmd, "Gzip-stream %d\012", session->gzip_level);
+        cvs_send(sock, cmd);
+
+        if (cvs_zlib_stream_start(sock, session->gzip_level) < 0)
+        {
+            cvs_close(sock);
+            return -1;
+        }
+    }
+
+    return sock;
+}
+
+/* Connect to the CVS server (authenticating ourselves to a pserver) */
+int cvs_connect() 
+{
+    int sock;
+    
+    sock = cvs_open();
+    if (sock < 0)
+    {
+        return -1;
+    }
+    
     session->sock = sock;
     return sock;
 }
@@ -315,7 +581,8 @@ int cvs_send(int sock, char *msg)
         return -1;
     }
     
-    n = send(sock, msg, strlen(msg), 0);
+    /* A server that has gone away gives us an error, not SIGPIPE */
+    n = cvs_zlib_stream_send(sock, msg, strlen(msg));
     if (n < 0)
     {
         fprintf(stderr, "Cannot send message: %s\n", msg);
@@ -335,10 +602,14 @@ int cvs_expand_modules(cvs_buff **resp)
     char cmd[1024];
     char buff[1024];
     
+    if (session->method == CVS_METHOD_RCS)
+    {
+        return cvs_rcs_expand_modules(session->module, resp);
+    }
+
     memset(buff, 0, 1024);
 
-    sprintf(&cmd[0], "Root %s\012", session->root);
-    cvs_send(session->sock, cmd);
+    pthread_mutex_lock(&session_lock);
 
     sprintf(&cmd[0], "Argument %s\012", session->module);
     cvs_send(session->sock, cmd);
@@ -351,6 +622,7 @@ int cvs_expand_modules(cvs_buff **resp)
     cvs_send(session->sock, "expand-modules\012");
     
     *resp = cvs_get_resp();
+    pthread_mutex_unlock(&session_lock);
     
     return 1;
 }
@@ -361,9 +633,18 @@ int cvs_co(cvs_buff **resp, char *tag)
     char cmd[1024];
     time_t before;
     
-    if (session->use_gzip)
+    if (session->method == CVS_METHOD_RCS)
     {
-        cvs_send(session->sock, "gzip-file-contents 3\012");
+        return cvs_rcs_co(session->root, session->module, session->tag, resp);
+    }
+
+    pthread_mutex_lock(&session_lock);
+
+    if (session->gzip_level > 0 && !cvs_zlib_stream_on(session->sock))
+    {
+        /* The server can't compress everything, but it can do the files */
+        sprintf(cmd, "gzip-file-contents %d\012", session->gzip_level);
+        cvs_send(session->sock, cmd);
     }
     
     if (strlen(session->tag) > 0)
@@ -392,6 +673,7 @@ int cvs_co(cvs_buff **resp, char *tag)
     before = time(NULL);
     
     *resp = cvs_get_resp();
+    pthread_mutex_unlock(&session_lock);
     if (*resp == NULL)
     {
         return 0;
@@ -402,25 +684,168 @@ int cvs_co(cvs_buff **resp, char *tag)
     return 1;
 }
 
-/* Send an "update" CVS request */
-int cvs_get_file(vcfs_path name, char *ver, cvs_buff **resp)
+/* Send an "rdiff -s" CVS request, listing every file in the module that
+ * has changed since the given date (in a format the server understands).
+ * Each changed file comes back as a single "M File ..." line.
+ */
+int cvs_rdiff_summary(char *since, cvs_buff **resp)
+{
+    char cmd[1024];
+
+    if (session->method == CVS_METHOD_RCS)
+    {
+        return cvs_rcs_rdiff_summary(session->root, session->module,
+                                     session->tag, since, resp);
+    }
+
+    pthread_mutex_lock(&session_lock);
+
+    sprintf(cmd, "Argument -s\012Argument -D\012Argument %s\012", since);
+    cvs_send(session->sock, cmd);
+
+    if (strlen(session->tag) > 0)
+    {
+        sprintf(cmd, "Argument -r\012Argument %s\012", session->tag);
+        cvs_send(session->sock, cmd);
+    }
+
+    sprintf(cmd, "Argument %s\012", session->module);
+    cvs_send(session->sock, cmd);
+
+    sprintf(cmd, "Directory .\012%s\012", session->root);
+    cvs_send(session->sock, cmd);
+
+    cvs_send(session->sock, "rdiff\012");
+
+    *resp = cvs_get_resp();
+    pthread_mutex_unlock(&session_lock);
+    if (*resp == NULL)
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Send an "rlog" CVS request for a file or directory in the module (or
+ * for the whole module if path is NULL), on a connection of its own so
+ * that nobody else has to wait while the server works through it. Each
+ * file's log comes back one after another, and can be read with
+ * cvs_parse_log().
+ */
+int cvs_rlog(char *path, cvs_buff **resp)
+{
+    char cmd[sizeof(vcfs_path) + 1024];
+    int sock;
+
+    if (session->method == CVS_METHOD_RCS)
+    {
+        return cvs_rcs_rlog(session->root, path ? path : session->module,
+                            resp);
+    }
+
+    *resp = NULL;
+
+    sock = cvs_open();
+    if (sock < 0)
+    {
+        return 0;
+    }
+
+    sprintf(cmd, "Argument %s\012Directory .\012%s\012rlog\012",
+            path ? path : session->module, session->root);
+    cvs_send(sock, cmd);
+
+    *resp = cvs_read_resp(sock);
+    cvs_close(sock);
+
+    return (*resp != NULL);
+}
+
+/* Send an "rlog" CVS request for a list of files in the module, on a
+ * connection of its own, the same way as cvs_rlog()
+ */
+int cvs_rlog_files(char **paths, int n, cvs_buff **resp)
+{
+    char cmd[sizeof(vcfs_path) + 1024];
+    int sock;
+    int i;
+
+    if (session->method == CVS_METHOD_RCS)
+    {
+        return cvs_rcs_rlog_files(session->root, paths, n, resp);
+    }
+
+    *resp = NULL;
+
+    sock = cvs_open();
+    if (sock < 0)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        sprintf(cmd, "Argument %s\012", paths[i]);
+        cvs_send(sock, cmd);
+    }
+
+    sprintf(cmd, "Directory .\012%s\012rlog\012", session->root);
+    cvs_send(sock, cmd);
+
+    *resp = cvs_read_resp(sock);
+    cvs_close(sock);
+
+    return (*resp != NULL);
+}
+
+/* The tag or branch the repository was loaded with, "" if none */
+char *cvs_session_tag()
+{
+    return session->tag;
+}
+
+/* Send an "update" CVS request. If have isn't NULL, it is a revision of
+ * the file we already have, and the server may send the difference
+ * between that and the one we want (see cvs_read_file()) instead of the
+ * whole file.
+ */
+int cvs_get_file(vcfs_path name, char *ver, char *have, cvs_buff **resp)
 {
     char cmd[2048];
     char temp[1024];
     vcfs_path parent;
     vcfs_name entry;
     
+    if (session->method == CVS_METHOD_RCS)
+    {
+        /* The whole file costs no more than the difference */
+        return cvs_rcs_get_file(session->root, name, ver, resp);
+    }
+
     memset(cmd, 0, sizeof(cmd));
     memset(temp, 0, sizeof(temp));
 
     split_path(name, &parent, &entry);
     
+    pthread_mutex_lock(&session_lock);
+
     sprintf(cmd, "Argument -r\012Argument %s\012", ver);
     
-    sprintf(temp, "Argument -u\012Directory .\012%s/%s\012\0", session->root, parent);
+    /* -u asks for the whole file, whatever we have */
+    sprintf(temp, "%sDirectory .\012%s/%s\012\0",
+            (have != NULL) ? "" : "Argument -u\012", session->root, parent);
     strcat(cmd, temp);
 
-    sprintf(temp, "Entry /%s/%s///\012\0", entry, ver);
+    if (have != NULL)
+    {
+        sprintf(temp, "Entry /%s/%s///\012Unchanged %s\012\0", entry, have,
+                entry);
+    }
+    else
+    {
+        sprintf(temp, "Entry /%s/%s///\012\0", entry, ver);
+    }
     strcat(cmd, temp);
     
     sprintf(temp, "Argument %s\012update\012\0", entry);
@@ -429,74 +854,160 @@ int cvs_get_file(vcfs_path name, char *ver, cvs_buff **resp)
     cvs_send(session->sock, cmd);
     
     *resp = cvs_get_resp();
+    pthread_mutex_unlock(&session_lock);
     
     return 1;
     
 }
 
-/* Send a "log" CVS request */
-int cvs_get_status(vcfs_path name, char *ver, cvs_buff **resp)
+/* Turn a "Mod-time" response, such as "Mod-time 1 Jan 2001 00:00:00 -0000",
+ * into the time it stands for. Returns 0 if the line can't be understood.
+ */
+time_t cvs_mod_time(char *line)
 {
+    static char *months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                              "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    struct tm tm;
+    char month[4];
+    int zone = 0;
+    int i;
 
-    char cmd[1024];
-    vcfs_path parent;
-    vcfs_name entry;
-  
-    split_path(name, &parent, &entry);
+    memset(&tm, 0, sizeof(tm));
 
-    sprintf(cmd, "Argument -r%s\012", ver);
-    cvs_send(session->sock, cmd);
+    if (strncmp(line, "Mod-time ", 9) ||
+        sscanf(line + 9, "%d %3s %d %d:%d:%d %d", &tm.tm_mday, month,
+               &tm.tm_year, &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &zone) < 6)
+    {
+        return 0;
+    }
 
-    sprintf(cmd, "Directory .\012%s/%s\012", session->root, parent);
-    cvs_send(session->sock, cmd);
-    
-    sprintf(cmd, "Entry /%s/%s///\012", entry, ver);
-    cvs_send(session->sock, cmd);
-    
-    sprintf(cmd, "Argument %s\012log\012", entry);
-    cvs_send(session->sock, cmd);
-    
-    *resp = cvs_get_resp();
-    
-    return 1;
+    for (i = 0; i < 12 && strcmp(month, months[i]); i++)
+        ;
+    if (i == 12)
+    {
+        return 0;
+    }
 
+    tm.tm_mon = i;
+    tm.tm_year -= 1900;
+
+    /* The zone is +hhmm or -hhmm, and servers always send -0000 */
+    return timegm(&tm) - (zone / 100 * 3600 + zone % 100 * 60);
 }
 
-/* Send a 'cvs status -v' command */
-int cvs_get_status_tags(vcfs_ventry *v, cvs_buff **resp)
+/* Pull the contents of a file out of the response to an update request.
+ * The contents come after an "Updated" (or "Created") response, the
+ * repository name of the file, its entry line, its mode, and its size,
+ * which starts with a 'z' if the contents are compressed. Returns the size
+ * of the file and puts a malloc'ed copy of the contents in *data, or
+ * returns -1 if the response doesn't contain a file. If mtime isn't NULL
+ * it is set to the time the revision was committed, or 0 if the server
+ * didn't say.
+ *
+ * An "Rcs-diff" response is sent the same way, but what comes is the
+ * difference from base (the revision cvs_get_file() said we have), which
+ * is applied to it to get the file.
+ */
+int cvs_read_file(cvs_buff *resp, char **data, time_t *mtime, char *base,
+                  int base_size)
 {
-    char cmd[1024];
-    vcfs_path parent;
-    vcfs_name entry;
-    
-    split_path(v->name, &parent, &entry);
-    
-    sprintf(cmd, "Argument -v\012");
-    cvs_send(session->sock, cmd);
-    
-    sprintf(cmd, "Directory .\012%s/%s\012", session->root, parent);
-    cvs_send(session->sock, cmd);
-    
-    sprintf(cmd, "Entry /%s/%s///\012", entry, v->ver);
-    
-    cvs_send(session->sock, cmd);
-    
-    sprintf(cmd, "Argument %s\012status\012", entry);
-    cvs_send(session->sock, cmd);
-    
-    *resp = cvs_get_resp();
-    
-    return 1;  
+    char *line;
+    char *diff;
+    int patch;
+    int size;
+    int len;
+    int i;
+
+    *data = NULL;
+    if (mtime != NULL)
+    {
+        *mtime = 0;
+    }
+
+    while (cvs_buff_read_line(resp, &line) > 0)
+    {
+        if (mtime != NULL && !strncmp(line, "Mod-time ", 9))
+        {
+            /* Comes just before the file it belongs to */
+            *mtime = cvs_mod_time(line);
+            free(line);
+            continue;
+        }
+
+        patch = (base != NULL && !strncmp(line, "Rcs-diff ", 9));
+        
+        if (strncmp(line, "Updated ", 8) && strncmp(line, "Created ", 8) &&
+            strncmp(line, "Update-existing ", 16) && strncmp(line, "Merged ", 7) &&
+            !patch)
+        {
+            /* Messages, or something else we aren't interested in */
+            free(line);
+            continue;
+        }
+        free(line);
+
+        /* Skip the repository name, entry line and mode */
+        for (i = 0; i < 3; i++)
+        {
+            cvs_buff_read_line(resp, NULL);
+        }
+
+        if (cvs_buff_read_line(resp, &line) <= 0)
+        {
+            return -1;
+        }
+
+        len = atoi(line[0] == 'z' ? line + 1 : line);
+
+        if (len < 0 || resp->cookie + len > resp->size)
+        {
+            fprintf(stderr, "cvs_read_file: Response is too short\n");
+            free(line);
+            return -1;
+        }
+
+        if (line[0] == 'z')
+        {
+            size = cvs_zlib_inflate_all(resp, len, data);
+        }
+        else
+        {
+            size = len;
+            *data = (char *)malloc(len + 1);
+            memcpy(*data, resp->data + resp->cookie, len);
+        }
+
+        resp->cookie += len;
+        free(line);
+
+        if (patch && size >= 0)
+        {
+            diff = *data;
+            size = cvs_rcsdiff_apply(base, base_size, diff, size, data);
+            free(diff);
+        }
+
+        return size;
+    }
+
+    return -1;
 }
-    
+
 int cvs_get_log(vcfs_path name, cvs_buff **resp)
 {
     char cmd[1024];
     vcfs_path parent;
     vcfs_name entry;
 
+    if (session->method == CVS_METHOD_RCS)
+    {
+        return cvs_rcs_get_log(session->root, name, resp);
+    }
+
     split_path(name, &parent, &entry);
     
+    pthread_mutex_lock(&session_lock);
+
     sprintf(cmd, "Directory .\012%s/%s\012", session->root, parent);
     cvs_send(session->sock, cmd);
 
@@ -507,23 +1018,28 @@ int cvs_get_log(vcfs_path name, cvs_buff **resp)
     cvs_send(session->sock, cmd);
     
     *resp = cvs_get_resp();
+    pthread_mutex_unlock(&session_lock);
     
     return 1;
 }
 
 
-/* TBD - Combine with split_path. Same functionality. */
-int cvs_ver_extended(char *name, vcfs_path *short_name, vcfs_ver *ver)
+/* TBD - Combine with split_path. Same functionality.
+ * What comes after the comma may be a revision, a tag or @date (see
+ * vcfs_resolve_version()); anything too long to be one of those isn't a
+ * version extended name.
+ */
+int cvs_ver_extended(char *name, vcfs_path *short_name, vcfs_tag *ver)
 {
     char *p;
     
-    memset(short_name, 0, sizeof(short_name));
-    memset(ver, 0, sizeof(ver));
+    memset(short_name, 0, sizeof(*short_name));
+    memset(ver, 0, sizeof(*ver));
     
     /* Look for a comma */
     p = (char *)strrchr(name, ',');
     
-    if (p == NULL)
+    if (p == NULL || strlen(p + 1) >= sizeof(*ver))
     {
         return 0;
     }
@@ -538,73 +1054,272 @@ int cvs_ver_extended(char *name, vcfs_path *short_name, vcfs_ver *ver)
     
 }
 
-/* Note: log message currently unsupported */
-int cvs_get_log_info(cvs_buff *log_buff, char **ver,
-                         char **date, char **author, char **msg)
+/* Strip the "M " off a line of text from the server */
+static char *cvs_msg_text(char *line)
+{
+    if (line[0] == 'M' && line[1] == ' ')
+    {
+        return line + 2;
+    }
+
+    return (line[0] == 'M') ? line + 1 : line;
+}
+
+/* Turn a date from a log, "2001/01/01 00:00:00" (or "2001-01-01 00:00:00
+ * +0000" from newer servers), into the time it stands for.
+ */
+static time_t cvs_log_time(char *date)
+{
+    struct tm tm;
+
+    memset(&tm, 0, sizeof(tm));
+
+    if (sscanf(date, "%d%*c%d%*c%d %d:%d:%d", &tm.tm_year, &tm.tm_mon,
+               &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) < 6)
+    {
+        return 0;
+    }
+
+    tm.tm_year -= 1900;
+    tm.tm_mon--;
+
+    return timegm(&tm);
+}
+
+/* Fill in a revision from the line after "revision", which looks like
+ *   date: 2001/01/01 00:00:00;  author: joe;  state: Exp;  lines: +1 -0
+ */
+static void cvs_log_rev_info(char *text, vcfs_rev *r)
+{
+    char *field;
+    char *end;
+
+    for (field = text; *field != '\0'; field = end)
+    {
+        while (*field == ' ')
+        {
+            field++;
+        }
+
+        end = strchr(field, ';');
+        if (end == NULL)
+        {
+            end = field + strlen(field);
+        }
+        else
+        {
+            *end++ = '\0';
+        }
+
+        if (!strncmp(field, "date: ", 6))
+        {
+            r->date = strdup(field + 6);
+            r->when = cvs_log_time(r->date);
+        }
+        else if (!strncmp(field, "author: ", 8))
+        {
+            r->author = strdup(field + 8);
+        }
+        else if (!strncmp(field, "state: ", 7))
+        {
+            r->state = strdup(field + 7);
+        }
+    }
+}
+
+/* Turn "branches:  1.2.2;  1.2.4;" into "1.2.2 1.2.4" */
+static char *cvs_log_branches(char *text)
+{
+    char *b;
+    char *p;
+    int len = 0;
+
+    b = (char *)malloc(strlen(text) + 1);
+
+    for (p = text + 9; *p != '\0'; p++)
+    {
+        if (*p == ';')
+        {
+            continue;
+        }
+        if (*p == ' ' && (len == 0 || b[len - 1] == ' '))
+        {
+            continue;
+        }
+        b[len++] = *p;
+    }
+
+    while (len > 0 && b[len - 1] == ' ')
+    {
+        len--;
+    }
+    b[len] = '\0';
+
+    return b;
+}
+
+/* What cvs_parse_log() expects next in a revision */
+#define LOG_DATE 1
+#define LOG_BRANCHES 2
+#define LOG_MSG 3
+#define LOG_MSG_MORE 4
+
+/* Work out a file's name in the module from its RCS file, such as
+ * "/cvs/proj/Attic/foo.c,v"
+ */
+static void cvs_log_name(char *rcs, vcfs_path name)
+{
+    char *attic;
+    int len;
+
+    len = strlen(session->root);
+    if (!strncmp(rcs, session->root, len) && rcs[len] == '/')
+    {
+        rcs += len + 1;
+    }
+
+    memset(name, 0, sizeof(vcfs_path));
+    strncpy(name, rcs, sizeof(vcfs_path) - 1);
+
+    len = strlen(name);
+    if (len > 2 && !strcmp(name + len - 2, ",v"))
+    {
+        name[len - 2] = '\0';
+    }
+
+    /* Removed files are kept in the Attic */
+    attic = strstr(name, "/Attic/");
+    if (attic != NULL)
+    {
+        memmove(attic, attic + 6, strlen(attic + 6) + 1);
+    }
+}
+
+/* Read the response to a "log" request for one file into h: its head, its
+ * symbolic names, and every revision with its date, author, state,
+ * branches and log message, newest first like the server lists them. If
+ * h->name is empty it is filled in from the RCS file. The response to an
+ * "rlog" has one of these after another; each call reads the next.
+ * Returns the number of revisions, or -1 if there was no log in the
+ * response.
+ */
+int cvs_parse_log(cvs_buff *log_buff, vcfs_hist *h)
 {
     char *line;
-    char *p, *a;
+    char *text;
+    char *p;
+    vcfs_rev *r = NULL;
+    int max_revs = 0;
+    int max_tags = 0;
+    int in_tags = 0;
+    int want = 0;
+    int found = 0;
     int len;
-    int n;
 
-    while ((n = cvs_buff_read_line(log_buff, &line)) > 0) 
+    h->revs = NULL;
+    h->nrevs = 0;
+    h->tags = NULL;
+    h->ntags = 0;
+    memset(h->head, 0, sizeof(h->head));
+
+    while (cvs_buff_read_line(log_buff, &line) > 0)
     {
-        if (!strncmp(line, "M revision", 10))
+        if (line[0] != 'M')
+        {
+            /* "ok", "error", or a message on stderr */
+            free(line);
+            continue;
+        }
+        text = cvs_msg_text(line);
+
+        if (!strncmp(text, "=============================================", 45))
         {
-            /* This line lists a version number */
-            if (ver != NULL)
+            /* The end of the log */
+            free(line);
+            break;
+        }
+        else if (!strcmp(text, "----------------------------"))
+        {
+            /* The end of a revision */
+            in_tags = 0;
+            r = NULL;
+        }
+        else if (r != NULL && want == LOG_DATE)
+        {
+            cvs_log_rev_info(text, r);
+            want = LOG_BRANCHES;
+        }
+        else if (r != NULL && want == LOG_BRANCHES &&
+                 !strncmp(text, "branches:", 9))
+        {
+            free(r->branches);
+            r->branches = cvs_log_branches(text);
+            want = LOG_MSG;
+        }
+        else if (r != NULL)
+        {
+            /* Another line of the log message */
+            len = strlen(r->msg);
+            r->msg = (char *)realloc(r->msg, len + strlen(text) + 2);
+            sprintf(r->msg + len, "%s%s", want == LOG_MSG_MORE ? "\n" : "",
+                    text);
+            want = LOG_MSG_MORE;
+        }
+        else if (!strncmp(text, "revision ", 9))
+        {
+            if (h->nrevs == max_revs)
             {
-                /* The version number is from the 2nd space to the end of the line */
-                p = (char *)strchr(line, ' ');
-                p = (char *)strchr(p + 1, ' ');
-                a = (char *)strchr(line, '\n');
-                
-                /* Skip past the space */
-                p++;
-                
-                /* Copy up to sizeof(vcfs_ver) bytes of the version */
-                len = a - p;
-                len = (len <= sizeof(vcfs_ver) ? len : sizeof(vcfs_ver)); 
-                *ver = malloc(len);
-                strncpy(*ver, p, len);
-                (*ver)[len] = '\0';
+                max_revs = (max_revs == 0) ? 8 : 2 * max_revs;
+                h->revs = (vcfs_rev *)realloc(h->revs,
+                                              max_revs * sizeof(vcfs_rev));
             }
-            
-            free(line);
-            
-            /* The next line contains date and author information */
-            cvs_buff_read_line(log_buff, &line);
-            
-            if (!strncmp(line, "M date:", 7))
+            r = &h->revs[h->nrevs++];
+            memset(r, 0, sizeof(vcfs_rev));
+
+            /* Locked revisions have "\tlocked by: joe;" after them */
+            strncpy(r->ver, text + 9, sizeof(r->ver) - 1);
+            r->ver[strcspn(r->ver, "\t ")] = '\0';
+            r->branches = strdup("");
+            r->msg = strdup("");
+            want = LOG_DATE;
+        }
+        else if (!strncmp(text, "RCS file: ", 10))
+        {
+            if (h->name[0] == '\0')
             {
-                p = (char *)strchr(line, ';');
-                
-                if (p != NULL && date != NULL)
-                {
-                    len = p - line - 8;  /* Hack to copy correct chunk */
-                    *date = malloc(len + 1);
-                    strncpy(*date, line + 8, len);
-                    (*date)[len] = '\0';
-                }
-                
-                a = (char *)strchr(p + 1, ';');
-                
-                if (a != NULL && author != NULL)
-                {
-                    len = a - p - 11;
-                    *author = malloc(len + 1);
-                    strncpy(*author, p + 11, len);
-                    (*author)[len] = '\0';
-                }
+                cvs_log_name(text + 10, h->name);
             }
-            
-            /* We found one a log entry, so return */
-            free(line);
-            return 1;
         }
-        
+        else if (!strncmp(text, "head: ", 6))
+        {
+            found = 1;
+            strncpy(h->head, text + 6, sizeof(h->head) - 1);
+        }
+        else if (!strcmp(text, "symbolic names:"))
+        {
+            in_tags = 1;
+        }
+        else if (in_tags && text[0] == '\t' && (p = strrchr(text, ':')) != NULL)
+        {
+            if (h->ntags == max_tags)
+            {
+                max_tags = (max_tags == 0) ? 8 : 2 * max_tags;
+                h->tags = (vcfs_symname *)realloc(h->tags, max_tags *
+                                                  sizeof(vcfs_symname));
+            }
+            *p = '\0';
+            h->tags[h->ntags].tag = strdup(text + 1);
+            memset(h->tags[h->ntags].ver, 0, sizeof(vcfs_ver));
+            strncpy(h->tags[h->ntags].ver, p + 2, sizeof(vcfs_ver) - 1);
+            h->ntags++;
+        }
+        else
+        {
+            in_tags = 0;
+        }
+
+        free(line);
     }
-    
-    return 0;
-    
+
+    return found ? h->nrevs : -1;
 }
@@ -7,6 +7,12 @@
 #include "vcfs.h"
 
 #define CVSPORT 2401
+#define CVS_GZIP_LEVEL 3 /* How hard to compress, unless told (-z) */
+
+/* How we get at the repository */
+#define CVS_METHOD_PSERVER 0
+#define CVS_METHOD_FORK 1 /* A "cvs server" of our own, on a socket pair */
+#define CVS_METHOD_RCS 2 /* Reading the RCS files ourselves (cvs_rcs.c) */
 #define CVS_BUFF_SIZE (64 * 1024)
 
 /* A buffer to hold a response from the CVS server */
@@ -26,7 +32,8 @@ typedef struct cvs_session {
     char *password;
     char *dir;
     int sock;
-    bool use_gzip;
+    int gzip_level; /* 0 for none */
+    int method;
     vcfs_tag tag;
 } cvs_session;
 
@@ -39,19 +46,43 @@ void cvs_ensure_buff(cvs_buff *b, int n);
 
 char *scramble (char *str);
 void cvs_init_session(char *hostname, char *root, char *module, char *user,
-                      char *password, char *dir, bool use_gzip, char *tag);
-int cvs_pserver_connect();
+                      char *password, char *dir, int gzip_level, int method,
+                      char *tag);
+int cvs_connect();
 int cvs_send(int sock, char *msg);
 int cvs_expand_modules(cvs_buff **resp);
 int cvs_co(cvs_buff **resp, char *tag);
+int cvs_rdiff_summary(char *since, cvs_buff **resp);
+char *cvs_session_tag();
 int cvs_buff_read_line(cvs_buff *b, char **line);
-int cvs_ver_extended(char *name, vcfs_path *short_name, vcfs_ver *ver);
-int cvs_get_file(vcfs_path name, char *ver, cvs_buff **resp);
-int cvs_get_status(vcfs_path name, char *ver, cvs_buff **resp);
+int cvs_ver_extended(char *name, vcfs_path *short_name, vcfs_tag *ver);
+int cvs_get_file(vcfs_path name, char *ver, char *have, cvs_buff **resp);
+time_t cvs_mod_time(char *line);
+int cvs_read_file(cvs_buff *resp, char **data, time_t *mtime, char *base,
+                  int base_size);
 int cvs_get_log(vcfs_path name, cvs_buff **resp);
-int cvs_get_log_info(cvs_buff *log_buff, char **ver,
-                     char **date, char **author, char **msg);
-int vcfs_read(char *buff, vcfs_fhdata *fh, int count, int offset);
+int cvs_rlog(char *path, cvs_buff **resp);
+int cvs_rlog_files(char **paths, int n, cvs_buff **resp);
+int cvs_parse_log(cvs_buff *log_buff, vcfs_hist *h);
+int vcfs_read(vcfs_fhdata *fh, int count, int offset, struct svc_req *rp,
+              vcfs_ventry *attr);
 int cvs_zlib_inflate_buffer(cvs_buff *input_buff, int in_size, int in_offset, 
                             char *output, int out_size, int keep_data);
-int cvs_get_status_tags(vcfs_ventry *v, cvs_buff **resp);
+int cvs_zlib_inflate_all(cvs_buff *input_buff, int in_size, char **output);
+int cvs_zlib_stream_start(int sock, int level);
+void cvs_zlib_stream_end(int sock);
+int cvs_zlib_stream_on(int sock);
+int cvs_zlib_stream_pending(int sock);
+int cvs_zlib_stream_send(int sock, char *msg, int len);
+int cvs_zlib_stream_recv(int sock, char *buf, int len);
+int cvs_rcsdiff_apply(char *base, int size, char *diff, int len, char **out);
+
+/* Reading RCS files directly (cvs_rcs.c) */
+int cvs_rcs_expand_modules(char *module, cvs_buff **resp);
+int cvs_rcs_co(char *root, char *module, char *tag, cvs_buff **resp);
+int cvs_rcs_rdiff_summary(char *root, char *module, char *tag, char *since,
+                          cvs_buff **resp);
+int cvs_rcs_rlog(char *root, char *path, cvs_buff **resp);
+int cvs_rcs_rlog_files(char *root, char **paths, int n, cvs_buff **resp);
+int cvs_rcs_get_file(char *root, char *name, char *ver, cvs_buff **resp);
+int cvs_rcs_get_log(char *root, char *name, cvs_buff **resp);
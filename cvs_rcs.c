@@ -0,0 +1,1466 @@
+/*****************************************************************************
+ * Filename: cvs_rcs.c
+ * Reads the RCS files of a repository directly, for repositories on a disk
+ * we can see (vcfsd -l). Each request that would have gone to the CVS
+ * server is answered here instead, with the response the server would
+ * have given, so nothing above cvs_cmds.c has to know the difference.
+ * Files are mapped into memory and parsed each time they are asked about;
+ * the caches above us keep that from happening often.
+ *
+ * The newest revision on the trunk is kept whole in an RCS file. Every
+ * other trunk revision is kept as the difference from the one after it,
+ * and each revision on a branch as the difference from the one before it,
+ * so getting an old revision means applying differences back down the
+ * trunk from the head, then out along the branch (see rcs_checkout()).
+ ****************************************************************************/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cvs_cmds.h"
+#include "utils.h"
+
+/* One revision, from the admin part of an RCS file. The log message and
+ * the text are left in the mapped file, still quoted (see rcs_unquote()).
+ */
+typedef struct rcs_delta {
+    vcfs_ver ver;
+    char date[24]; /* As "cvs log" shows it: 2001/01/01 00:00:00 */
+    time_t when;
+    char author[64];
+    char state[32];
+    char *branches; /* The first revision on each branch from here */
+    vcfs_ver next; /* The one before it on the trunk, after it elsewhere */
+    char *log;
+    int log_len;
+    char *text; /* The whole file for the head, a difference otherwise */
+    int text_len;
+} rcs_delta;
+
+/* An RCS file, mapped into memory */
+typedef struct rcs_file {
+    char *map;
+    int size;
+    char *pos; /* Where the parser has got to */
+    vcfs_ver head;
+    vcfs_ver branch; /* The default branch, "" for the trunk */
+    char expand[8]; /* How keywords are expanded, "" for the usual way */
+    vcfs_symname *syms;
+    int nsyms;
+    rcs_delta *deltas; /* In the order they are in the file */
+    int ndeltas;
+} rcs_file;
+
+/* A request being answered */
+typedef struct rcs_req {
+    cvs_buff *resp;
+    char *root;
+    char *tag;
+    time_t since;
+} rcs_req;
+
+/* Something done for each directory (with name NULL) and each RCS file
+ * found by rcs_walk()
+ */
+typedef void (*rcs_visit)(rcs_req *q, char *dir, char *name, int attic);
+
+/* Kinds of token */
+#define RCS_END 0
+#define RCS_WORD 1
+#define RCS_STRING 2
+#define RCS_SEMI 3
+#define RCS_COLON 4
+
+/* Keywords that are expanded in files. $Log$ is left alone. */
+static char *rcs_keywords[] = { "Author", "CVSHeader", "Date", "Header",
+                                "Id", "Locker", "Name", "RCSfile",
+                                "Revision", "Source", "State", NULL };
+
+static char *rcs_months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                              "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+
+/* Read the next token. Words and strings are left where they are in the
+ * file, with *tok and *len saying where; strings are still quoted.
+ */
+static int rcs_token(rcs_file *r, char **tok, int *len)
+{
+    char *p = r->pos;
+    char *end = r->map + r->size;
+
+    while (p < end && isspace((unsigned char)*p))
+    {
+        p++;
+    }
+
+    if (p >= end)
+    {
+        r->pos = end;
+        return RCS_END;
+    }
+
+    if (*p == ';' || *p == ':')
+    {
+        r->pos = p + 1;
+        return (*p == ';') ? RCS_SEMI : RCS_COLON;
+    }
+
+    if (*p == '@')
+    {
+        /* A string, in which "@@" stands for "@" */
+        *tok = ++p;
+        while (p < end && (*p != '@' || (p + 1 < end && p[1] == '@')))
+        {
+            p += (*p == '@') ? 2 : 1;
+        }
+
+        if (p >= end)
+        {
+            r->pos = end;
+            return RCS_END;
+        }
+
+        *len = p - *tok;
+        r->pos = p + 1;
+        return RCS_STRING;
+    }
+
+    *tok = p;
+    while (p < end && !isspace((unsigned char)*p) && *p != ';' &&
+           *p != ':' && *p != '@')
+    {
+        p++;
+    }
+    *len = p - *tok;
+    r->pos = p;
+
+    return RCS_WORD;
+}
+
+/* Copy a token into a buffer, cutting it short if it doesn't fit */
+static void rcs_copy(char *buf, int size, char *tok, int len)
+{
+    if (len >= size)
+    {
+        len = size - 1;
+    }
+    memcpy(buf, tok, len);
+    buf[len] = '\0';
+}
+
+/* Make a malloc'ed copy of a string without the quoting. Returns its
+ * length.
+ */
+static int rcs_unquote(char *s, int len, char **out)
+{
+    char *end = s + len;
+    int n = 0;
+
+    *out = (char *)malloc(len + 1);
+
+    while (s < end)
+    {
+        (*out)[n++] = *s;
+        s += (*s == '@') ? 2 : 1;
+    }
+    (*out)[n] = '\0';
+
+    return n;
+}
+
+/* Read the rest of a phrase, up to its ';'. The first value in it, if
+ * there is one and buf isn't NULL, is copied to buf. Returns 0 if the file
+ * ends first.
+ */
+static int rcs_phrase(rcs_file *r, char *buf, int size)
+{
+    char *tok;
+    int len;
+    int t;
+    int first = 1;
+
+    if (buf != NULL)
+    {
+        buf[0] = '\0';
+    }
+
+    while ((t = rcs_token(r, &tok, &len)) != RCS_SEMI)
+    {
+        if (t == RCS_END)
+        {
+            return 0;
+        }
+
+        if (first && buf != NULL)
+        {
+            rcs_copy(buf, size, tok, len);
+            first = 0;
+        }
+    }
+
+    return 1;
+}
+
+/* Read the symbolic names, "symbols REL1:1.1 BR:1.2.0.2;" */
+static int rcs_symbols(rcs_file *r)
+{
+    vcfs_symname *s;
+    char *tok;
+    int len;
+    int max = 0;
+    int t;
+
+    while ((t = rcs_token(r, &tok, &len)) == RCS_WORD)
+    {
+        if (r->nsyms == max)
+        {
+            max = (max == 0) ? 8 : 2 * max;
+            r->syms = (vcfs_symname *)realloc(r->syms,
+                                              max * sizeof(vcfs_symname));
+        }
+        s = &r->syms[r->nsyms++];
+        s->tag = (char *)malloc(len + 1);
+        rcs_copy(s->tag, len + 1, tok, len);
+        s->ver[0] = '\0';
+
+        if (rcs_token(r, &tok, &len) != RCS_COLON ||
+            rcs_token(r, &tok, &len) != RCS_WORD)
+        {
+            return 0;
+        }
+        rcs_copy(s->ver, sizeof(s->ver), tok, len);
+    }
+
+    return (t == RCS_SEMI);
+}
+
+/* Read the branches that start at a revision */
+static int rcs_branches(rcs_file *r, rcs_delta *d)
+{
+    char *tok;
+    int len;
+    int used = 0;
+    int t;
+
+    while ((t = rcs_token(r, &tok, &len)) == RCS_WORD)
+    {
+        d->branches = (char *)realloc(d->branches, used + len + 2);
+        if (used > 0)
+        {
+            d->branches[used++] = ' ';
+        }
+        memcpy(d->branches + used, tok, len);
+        used += len;
+        d->branches[used] = '\0';
+    }
+
+    return (t == RCS_SEMI);
+}
+
+/* Turn an RCS date, "2001.01.01.00.00.00" (or "99.01.01.00.00.00" before
+ * 2000), into the way "cvs log" shows it, and the time it stands for
+ */
+static void rcs_date(char *raw, rcs_delta *d)
+{
+    struct tm tm;
+
+    memset(&tm, 0, sizeof(tm));
+
+    if (sscanf(raw, "%d.%d.%d.%d.%d.%d", &tm.tm_year, &tm.tm_mon,
+               &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) < 6)
+    {
+        return;
+    }
+
+    if (tm.tm_year < 100)
+    {
+        tm.tm_year += 1900;
+    }
+
+    snprintf(d->date, sizeof(d->date), "%04d/%02d/%02d %02d:%02d:%02d",
+             tm.tm_year, tm.tm_mon, tm.tm_mday, tm.tm_hour, tm.tm_min,
+             tm.tm_sec);
+
+    tm.tm_year -= 1900;
+    tm.tm_mon--;
+    d->when = timegm(&tm);
+}
+
+/* Find a revision */
+static rcs_delta *rcs_find(rcs_file *r, char *ver)
+{
+    int i;
+
+    for (i = 0; i < r->ndeltas; i++)
+    {
+        if (!strcmp(r->deltas[i].ver, ver))
+        {
+            return &r->deltas[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Add a revision */
+static rcs_delta *rcs_add(rcs_file *r, char *ver, int *max)
+{
+    rcs_delta *d;
+
+    if (r->ndeltas == *max)
+    {
+        *max = (*max == 0) ? 16 : 2 * *max;
+        r->deltas = (rcs_delta *)realloc(r->deltas,
+                                         *max * sizeof(rcs_delta));
+    }
+
+    d = &r->deltas[r->ndeltas++];
+    memset(d, 0, sizeof(rcs_delta));
+    strncpy(d->ver, ver, sizeof(d->ver) - 1);
+    d->branches = strdup("");
+
+    return d;
+}
+
+/* Read an RCS file: the admin part, then the revisions, the description,
+ * and the log message and text of each revision. Phrases we don't know
+ * about are skipped. Returns 0 if the file doesn't make sense.
+ */
+static int rcs_parse(rcs_file *r)
+{
+    rcs_delta *d = NULL;
+    char word[64];
+    char raw[32];
+    char *tok;
+    int len;
+    int max = 0;
+    int in_text = 0;
+    int ok = 1;
+    int t;
+
+    while (ok && (t = rcs_token(r, &tok, &len)) == RCS_WORD)
+    {
+        rcs_copy(word, sizeof(word), tok, len);
+
+        if (isdigit((unsigned char)word[0]))
+        {
+            /* A revision, or the log and text of one */
+            d = in_text ? rcs_find(r, word) : rcs_add(r, word, &max);
+            ok = (d != NULL);
+        }
+        else if (!strcmp(word, "desc"))
+        {
+            ok = (rcs_token(r, &tok, &len) == RCS_STRING);
+            in_text = 1;
+            d = NULL;
+        }
+        else if (in_text && d != NULL &&
+                 (!strcmp(word, "log") || !strcmp(word, "text")))
+        {
+            ok = (rcs_token(r, &tok, &len) == RCS_STRING);
+            if (word[0] == 'l')
+            {
+                d->log = tok;
+                d->log_len = len;
+            }
+            else
+            {
+                d->text = tok;
+                d->text_len = len;
+            }
+        }
+        else if (!in_text && d != NULL && !strcmp(word, "date"))
+        {
+            ok = rcs_phrase(r, raw, sizeof(raw));
+            rcs_date(raw, d);
+        }
+        else if (!in_text && d != NULL && !strcmp(word, "author"))
+        {
+            ok = rcs_phrase(r, d->author, sizeof(d->author));
+        }
+        else if (!in_text && d != NULL && !strcmp(word, "state"))
+        {
+            ok = rcs_phrase(r, d->state, sizeof(d->state));
+        }
+        else if (!in_text && d != NULL && !strcmp(word, "branches"))
+        {
+            ok = rcs_branches(r, d);
+        }
+        else if (!in_text && d != NULL && !strcmp(word, "next"))
+        {
+            ok = rcs_phrase(r, d->next, sizeof(d->next));
+        }
+        else if (d == NULL && !strcmp(word, "head"))
+        {
+            ok = rcs_phrase(r, r->head, sizeof(r->head));
+        }
+        else if (d == NULL && !strcmp(word, "branch"))
+        {
+            ok = rcs_phrase(r, r->branch, sizeof(r->branch));
+        }
+        else if (d == NULL && !strcmp(word, "expand"))
+        {
+            ok = rcs_phrase(r, r->expand, sizeof(r->expand));
+        }
+        else if (d == NULL && !strcmp(word, "symbols"))
+        {
+            ok = rcs_symbols(r);
+        }
+        else
+        {
+            /* access, locks, comment, commitid and the like */
+            ok = rcs_phrase(r, NULL, 0);
+        }
+    }
+
+    return ok && in_text && t == RCS_END;
+}
+
+/* Done with an RCS file */
+static void rcs_close(rcs_file *r)
+{
+    int i;
+
+    for (i = 0; i < r->nsyms; i++)
+    {
+        free(r->syms[i].tag);
+    }
+
+    for (i = 0; i < r->ndeltas; i++)
+    {
+        free(r->deltas[i].branches);
+    }
+
+    if (r->map != NULL)
+    {
+        munmap(r->map, r->size);
+    }
+
+    free(r->syms);
+    free(r->deltas);
+    free(r);
+}
+
+/* Map an RCS file into memory and read it. Returns NULL if it isn't there,
+ * or doesn't make sense.
+ */
+static rcs_file *rcs_open(char *path)
+{
+    rcs_file *r;
+    struct stat st;
+    void *map;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    if (fstat(fd, &st) < 0 || st.st_size == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        perror("cvs_rcs: Could not map RCS file");
+        return NULL;
+    }
+
+    r = (rcs_file *)malloc(sizeof(rcs_file));
+    memset(r, 0, sizeof(rcs_file));
+    r->map = (char *)map;
+    r->size = st.st_size;
+    r->pos = r->map;
+
+    if (!rcs_parse(r))
+    {
+        fprintf(stderr, "cvs_rcs: Could not read %s\n", path);
+        rcs_close(r);
+        return NULL;
+    }
+
+    return r;
+}
+
+/* Open the RCS file for a file in the module, which is in the Attic if the
+ * file has been removed. Its path is put in path.
+ */
+static rcs_file *rcs_open_name(char *root, char *name, vcfs_path path)
+{
+    vcfs_path parent;
+    vcfs_name entry;
+    rcs_file *r;
+
+    snprintf(path, sizeof(vcfs_path), "%s/%s,v", root, name);
+    r = rcs_open(path);
+
+    if (r == NULL)
+    {
+        split_path(name, &parent, &entry);
+        snprintf(path, sizeof(vcfs_path), "%s/%s/Attic/%s,v", root, parent,
+                 entry);
+        r = rcs_open(path);
+    }
+
+    return r;
+}
+
+/* How many dots there are in a revision or branch number */
+static int rcs_dots(char *ver)
+{
+    int n = 0;
+
+    while ((ver = strchr(ver, '.')) != NULL)
+    {
+        ver++;
+        n++;
+    }
+
+    return n;
+}
+
+/* Find the first revision on a branch (such as 1.2.4) that starts at bp */
+static rcs_delta *rcs_branch_start(rcs_file *r, rcs_delta *bp, char *branch)
+{
+    vcfs_ver first;
+    char *p;
+    int len = strlen(branch);
+    int n;
+
+    if (bp == NULL)
+    {
+        return NULL;
+    }
+
+    for (p = bp->branches; sscanf(p, "%15s%n", first, &n) == 1; p += n)
+    {
+        if (!strncmp(first, branch, len) && first[len] == '.')
+        {
+            return rcs_find(r, first);
+        }
+    }
+
+    return NULL;
+}
+
+/* Apply the difference kept with a revision to the text of the one it
+ * was made from. Returns the new size, or -1 (and *text NULL) if it
+ * couldn't be done.
+ */
+static int rcs_apply(rcs_delta *d, char **text, int size)
+{
+    char *diff;
+    char *out = NULL;
+    int len;
+
+    if (d->text != NULL)
+    {
+        len = rcs_unquote(d->text, d->text_len, &diff);
+        size = cvs_rcsdiff_apply(*text, size, diff, len, &out);
+        free(diff);
+    }
+    else
+    {
+        size = -1;
+    }
+
+    free(*text);
+    *text = out;
+
+    return size;
+}
+
+/* Get the text of a revision, before keywords are expanded. Returns its
+ * size with a malloc'ed copy in *out, or -1 if it can't be had.
+ */
+static int rcs_checkout(rcs_file *r, char *ver, char **out)
+{
+    rcs_delta *d;
+    vcfs_ver branch;
+    vcfs_ver from;
+    int size;
+    int n = 0;
+
+    *out = NULL;
+
+    if (rcs_dots(ver) % 2 == 0)
+    {
+        /* That's a branch, not a revision */
+        return -1;
+    }
+
+    if (rcs_dots(ver) == 1)
+    {
+        /* Back down the trunk from the head */
+        d = rcs_find(r, r->head);
+        if (d == NULL || d->text == NULL)
+        {
+            return -1;
+        }
+        size = rcs_unquote(d->text, d->text_len, out);
+
+        while (size >= 0 && strcmp(d->ver, ver))
+        {
+            d = rcs_find(r, d->next);
+            if (d == NULL || ++n > r->ndeltas)
+            {
+                free(*out);
+                *out = NULL;
+                return -1;
+            }
+            size = rcs_apply(d, out, size);
+        }
+
+        return size;
+    }
+
+    /* Out along the branch from where it starts */
+    strcpy(branch, ver);
+    *strrchr(branch, '.') = '\0';
+    strcpy(from, branch);
+    *strrchr(from, '.') = '\0';
+
+    size = rcs_checkout(r, from, out);
+    d = rcs_branch_start(r, rcs_find(r, from), branch);
+
+    while (size >= 0 && d != NULL)
+    {
+        size = rcs_apply(d, out, size);
+        if (!strcmp(d->ver, ver))
+        {
+            return size;
+        }
+        d = (++n > r->ndeltas) ? NULL : rcs_find(r, d->next);
+    }
+
+    free(*out);
+    *out = NULL;
+    return -1;
+}
+
+/* The newest revision on a branch (such as 1.2.4, or 1.2.0.4 as branch
+ * tags have it), or the revision itself if num is one. A branch nothing
+ * has been committed on yet gives the revision it starts at.
+ */
+static rcs_delta *rcs_latest(rcs_file *r, char *num)
+{
+    rcs_delta *d;
+    rcs_delta *next;
+    vcfs_ver branch;
+    vcfs_ver from;
+    char *dot;
+    int n = 0;
+
+    memset(branch, 0, sizeof(branch));
+    strncpy(branch, num, sizeof(branch) - 1);
+
+    dot = strrchr(branch, '.');
+    if (dot != NULL && dot - branch >= 2 && !strncmp(dot - 2, ".0", 2))
+    {
+        memmove(dot - 2, dot, strlen(dot) + 1);
+    }
+
+    if (rcs_dots(branch) % 2 == 1)
+    {
+        return rcs_find(r, branch);
+    }
+
+    if (rcs_dots(branch) == 0)
+    {
+        /* The trunk */
+        return rcs_find(r, r->head);
+    }
+
+    strcpy(from, branch);
+    *strrchr(from, '.') = '\0';
+
+    d = rcs_branch_start(r, rcs_find(r, from), branch);
+    if (d == NULL)
+    {
+        return rcs_find(r, from);
+    }
+
+    while ((next = rcs_find(r, d->next)) != NULL && ++n <= r->ndeltas)
+    {
+        d = next;
+    }
+
+    return d;
+}
+
+/* The revision a tag or revision number stands for, or the one that would
+ * be checked out without one ("").
+ */
+static rcs_delta *rcs_select(rcs_file *r, char *tag)
+{
+    int i;
+
+    if (tag[0] == '\0')
+    {
+        return rcs_latest(r, r->branch[0] ? r->branch : r->head);
+    }
+
+    if (!strcmp(tag, "HEAD"))
+    {
+        return rcs_find(r, r->head);
+    }
+
+    if (isdigit((unsigned char)tag[0]))
+    {
+        return rcs_latest(r, tag);
+    }
+
+    for (i = 0; i < r->nsyms; i++)
+    {
+        if (!strcmp(r->syms[i].tag, tag))
+        {
+            return rcs_latest(r, r->syms[i].ver);
+        }
+    }
+
+    return NULL;
+}
+
+/* The trunk revision that was the newest at a given time */
+static rcs_delta *rcs_at(rcs_file *r, time_t when)
+{
+    rcs_delta *d;
+    int n = 0;
+
+    d = rcs_find(r, r->head);
+    while (d != NULL && d->when > when && ++n <= r->ndeltas)
+    {
+        d = rcs_find(r, d->next);
+    }
+
+    return (d != NULL && d->when <= when) ? d : NULL;
+}
+
+/* Is this revision one where the file was removed? */
+static int rcs_dead(rcs_delta *d)
+{
+    return (d == NULL || !strcmp(d->state, "dead"));
+}
+
+/* Add to some output, making room for it */
+static void rcs_out(char **out, int *max, int *used, char *data, int len)
+{
+    while (*used + len > *max)
+    {
+        *max *= 2;
+        *out = (char *)realloc(*out, *max);
+    }
+
+    memcpy(*out + *used, data, len);
+    *used += len;
+}
+
+/* The value of a keyword */
+static void rcs_keyword_value(char *kw, rcs_delta *d, char *root,
+                              char *path, char *tag, char *value, int size)
+{
+    char *base = strrchr(path, '/');
+    char *rel = path;
+    int len = strlen(root);
+
+    base = (base != NULL) ? base + 1 : path;
+    if (!strncmp(path, root, len) && path[len] == '/')
+    {
+        rel = path + len + 1;
+    }
+
+    value[0] = '\0';
+
+    if (!strcmp(kw, "Author"))
+    {
+        snprintf(value, size, "%s", d->author);
+    }
+    else if (!strcmp(kw, "Date"))
+    {
+        snprintf(value, size, "%s", d->date);
+    }
+    else if (!strcmp(kw, "Id") || !strcmp(kw, "Header") ||
+             !strcmp(kw, "CVSHeader"))
+    {
+        snprintf(value, size, "%s %s %s %s %s",
+                 (kw[0] == 'I') ? base : (kw[0] == 'H') ? path : rel,
+                 d->ver, d->date, d->author, d->state);
+    }
+    else if (!strcmp(kw, "Name") && !isdigit((unsigned char)tag[0]))
+    {
+        snprintf(value, size, "%s", tag);
+    }
+    else if (!strcmp(kw, "RCSfile"))
+    {
+        snprintf(value, size, "%s", base);
+    }
+    else if (!strcmp(kw, "Revision"))
+    {
+        snprintf(value, size, "%s", d->ver);
+    }
+    else if (!strcmp(kw, "Source"))
+    {
+        snprintf(value, size, "%s", path);
+    }
+    else if (!strcmp(kw, "State"))
+    {
+        snprintf(value, size, "%s", d->state);
+    }
+}
+
+/* Expand the keywords in a revision of a file, like "$Id$", the way the
+ * server would. Returns the new size of the text.
+ */
+static int rcs_expand(rcs_file *r, rcs_delta *d, char *root, char *path,
+                      char *tag, char **text, int size)
+{
+    char value[sizeof(vcfs_path) + 256];
+    char *p = *text;
+    char *end = *text + size;
+    char *dollar;
+    char *close;
+    char *out;
+    int max = size + 1024;
+    int used = 0;
+    int len;
+    int i;
+
+    if (!strcmp(r->expand, "b") || !strcmp(r->expand, "o"))
+    {
+        return size;
+    }
+
+    out = (char *)malloc(max);
+
+    while ((dollar = memchr(p, '$', end - p)) != NULL)
+    {
+        rcs_out(&out, &max, &used, p, dollar - p);
+        p = dollar + 1;
+
+        /* "$Id$" or "$Id: anything on the same line $" */
+        close = NULL;
+        for (i = 0; rcs_keywords[i] != NULL && close == NULL; i++)
+        {
+            len = strlen(rcs_keywords[i]);
+            if (end - p <= len || strncmp(p, rcs_keywords[i], len) ||
+                (p[len] != '$' && p[len] != ':'))
+            {
+                continue;
+            }
+
+            for (close = p + len; close < end && *close != '$'; close++)
+            {
+                if (*close == '\n')
+                {
+                    break;
+                }
+            }
+            if (close >= end || *close != '$')
+            {
+                close = NULL;
+            }
+        }
+
+        if (close == NULL)
+        {
+            rcs_out(&out, &max, &used, "$", 1);
+            continue;
+        }
+
+        len = strlen(rcs_keywords[i - 1]);
+        rcs_keyword_value(rcs_keywords[i - 1], d, root, path, tag, value,
+                          sizeof(value) - 1);
+
+        if (!strcmp(r->expand, "k"))
+        {
+            rcs_out(&out, &max, &used, dollar, len + 1);
+            rcs_out(&out, &max, &used, "$", 1);
+        }
+        else if (!strcmp(r->expand, "v"))
+        {
+            rcs_out(&out, &max, &used, value, strlen(value));
+        }
+        else
+        {
+            rcs_out(&out, &max, &used, dollar, len + 1);
+            rcs_out(&out, &max, &used, ": ", 2);
+            rcs_out(&out, &max, &used, value, strlen(value));
+            rcs_out(&out, &max, &used, " $", 2);
+        }
+
+        p = close + 1;
+    }
+
+    rcs_out(&out, &max, &used, p, end - p);
+
+    free(*text);
+    *text = out;
+
+    return used;
+}
+
+/* Add to a response */
+static void rcs_put(cvs_buff *b, char *data, int len)
+{
+    while (b->size + len >= b->limit)
+    {
+        cvs_ensure_buff(b, len);
+    }
+
+    memcpy(b->data + b->size, data, len);
+    b->size += len;
+}
+
+/* Add some formatted text to a response */
+static void rcs_printf(cvs_buff *b, char *fmt, ...)
+{
+    va_list ap;
+    int len;
+
+    va_start(ap, fmt);
+    len = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+
+    while (b->size + len + 1 >= b->limit)
+    {
+        cvs_ensure_buff(b, len + 1);
+    }
+
+    va_start(ap, fmt);
+    vsnprintf(b->data + b->size, len + 1, fmt, ap);
+    va_end(ap);
+
+    b->size += len;
+}
+
+/* Add a revision of a file to a response, the way the server sends it for
+ * "co" (with the "M U" line) or "update". Returns 0 if the revision can't
+ * be had.
+ */
+static int rcs_put_file(rcs_req *q, rcs_file *r, rcs_delta *d, char *dir,
+                        char *name, char *path, int co)
+{
+    struct tm tm;
+    char *text;
+    int size;
+
+    size = rcs_checkout(r, d->ver, &text);
+    if (size < 0)
+    {
+        fprintf(stderr, "cvs_rcs: Could not get %s of %s\n", d->ver, path);
+        return 0;
+    }
+    size = rcs_expand(r, d, q->root, path, q->tag, &text, size);
+
+    if (co)
+    {
+        rcs_printf(q->resp, "M U %s/%s\n", dir, name);
+    }
+
+    gmtime_r(&d->when, &tm);
+    rcs_printf(q->resp, "Mod-time %d %s %d %02d:%02d:%02d -0000\n",
+               tm.tm_mday, rcs_months[tm.tm_mon], tm.tm_year + 1900,
+               tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+    rcs_printf(q->resp, "Created %s/\n%s\n/%s/%s///%s%s\nu=rw,g=r,o=r\n%d\n",
+               dir, path, name, d->ver, (co && q->tag[0]) ? "T" : "",
+               co ? q->tag : "", size);
+    rcs_put(q->resp, text, size);
+
+    free(text);
+    return 1;
+}
+
+/* Add the log of a file to a response, the way "cvs log" (with the name of
+ * the working file) or "cvs rlog" (without) shows it
+ */
+static void rcs_put_log(cvs_buff *b, rcs_file *r, char *path, char *working)
+{
+    rcs_delta *d;
+    vcfs_ver branch;
+    char *msg;
+    char *line;
+    char *nl;
+    char *p;
+    int len;
+    int n;
+    int i;
+
+    rcs_printf(b, "M \nM RCS file: %s\n", path);
+    if (working != NULL)
+    {
+        rcs_printf(b, "M Working file: %s\n", working);
+    }
+    rcs_printf(b, "M head: %s\nM branch:%s%s\nM locks: strict\n"
+               "M access list:\nM symbolic names:\n", r->head,
+               r->branch[0] ? " " : "", r->branch);
+
+    for (i = 0; i < r->nsyms; i++)
+    {
+        rcs_printf(b, "M \t%s: %s\n", r->syms[i].tag, r->syms[i].ver);
+    }
+
+    rcs_printf(b, "M keyword substitution: %s\n"
+               "M total revisions: %d;\tselected revisions: %d\n"
+               "M description:\n", r->expand[0] ? r->expand : "kv",
+               r->ndeltas, r->ndeltas);
+
+    for (i = 0; i < r->ndeltas; i++)
+    {
+        d = &r->deltas[i];
+
+        rcs_printf(b, "M ----------------------------\nM revision %s\n"
+                   "M date: %s;  author: %s;  state: %s;\n", d->ver, d->date,
+                   d->author, d->state);
+
+        /* The log shows branch numbers, not where they start */
+        if (d->branches[0] != '\0')
+        {
+            rcs_printf(b, "M branches:");
+            for (p = d->branches; sscanf(p, "%15s%n", branch, &n) == 1;
+                 p += n)
+            {
+                *strrchr(branch, '.') = '\0';
+                rcs_printf(b, "  %s;", branch);
+            }
+            rcs_printf(b, "\n");
+        }
+
+        len = (d->log != NULL) ? rcs_unquote(d->log, d->log_len, &msg) :
+            rcs_unquote("", 0, &msg);
+        if (len == 0 || !strcmp(msg, "\n"))
+        {
+            rcs_printf(b, "M *** empty log message ***\n");
+        }
+        for (line = msg; line < msg + len; line = nl + 1)
+        {
+            nl = strchr(line, '\n');
+            if (nl == NULL)
+            {
+                nl = msg + len;
+            }
+            *nl = '\0';
+            rcs_printf(b, "M %s\n", line);
+        }
+        free(msg);
+    }
+
+    rcs_printf(b, "M ================================================"
+               "=============================\n");
+}
+
+/* For sorting names */
+static int rcs_name_cmp(const void *a, const void *b)
+{
+    return strcmp(*(char **)a, *(char **)b);
+}
+
+/* Get a sorted list of what is in a directory of the repository. Returns
+ * how many there are, with a malloc'ed list of malloc'ed names in *names.
+ */
+static int rcs_list(char *root, char *dir, char ***names)
+{
+    vcfs_path path;
+    struct dirent *e;
+    DIR *dp;
+    int max = 16;
+    int n = 0;
+
+    *names = (char **)malloc(max * sizeof(char *));
+
+    snprintf(path, sizeof(path), "%s/%s", root, dir);
+    dp = opendir(path);
+    if (dp == NULL)
+    {
+        return 0;
+    }
+
+    while ((e = readdir(dp)) != NULL)
+    {
+        if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, ".."))
+        {
+            continue;
+        }
+
+        if (n == max)
+        {
+            max *= 2;
+            *names = (char **)realloc(*names, max * sizeof(char *));
+        }
+        (*names)[n++] = strdup(e->d_name);
+    }
+    closedir(dp);
+
+    qsort(*names, n, sizeof(char *), rcs_name_cmp);
+
+    return n;
+}
+
+/* Free a list from rcs_list() */
+static void rcs_free_list(char **names, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        free(names[i]);
+    }
+    free(names);
+}
+
+/* Go through a directory of the repository and everything under it: the
+ * directory itself, its RCS files, the ones in its Attic, then the
+ * directories in it, the order the server goes through them for "co"
+ */
+static void rcs_walk(rcs_req *q, char *dir, rcs_visit visit)
+{
+    vcfs_path path;
+    vcfs_path sub;
+    vcfs_name name;
+    struct stat st;
+    char **names;
+    int attic;
+    int len;
+    int n;
+    int i;
+
+    visit(q, dir, NULL, 0);
+
+    for (attic = 0; attic < 2; attic++)
+    {
+        snprintf(sub, sizeof(sub), attic ? "%s/Attic" : "%s", dir);
+        n = rcs_list(q->root, sub, &names);
+
+        for (i = 0; i < n; i++)
+        {
+            len = strlen(names[i]);
+            snprintf(path, sizeof(path), "%s/%s/%s", q->root, sub, names[i]);
+
+            if (len > 2 && len - 2 < sizeof(name) &&
+                !strcmp(names[i] + len - 2, ",v") &&
+                stat(path, &st) == 0 && S_ISREG(st.st_mode))
+            {
+                rcs_copy(name, sizeof(name), names[i], len - 2);
+                visit(q, dir, name, attic);
+            }
+        }
+
+        rcs_free_list(names, n);
+    }
+
+    n = rcs_list(q->root, dir, &names);
+
+    for (i = 0; i < n; i++)
+    {
+        snprintf(path, sizeof(path), "%s/%s/%s", q->root, dir, names[i]);
+
+        if (strcmp(names[i], "Attic") && strcmp(names[i], "CVS") &&
+            stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+        {
+            snprintf(sub, sizeof(sub), "%s/%s", dir, names[i]);
+            rcs_walk(q, sub, visit);
+        }
+    }
+
+    rcs_free_list(names, n);
+}
+
+/* The path of an RCS file rcs_walk() found */
+static void rcs_walk_path(rcs_req *q, char *dir, char *name, int attic,
+                          vcfs_path path)
+{
+    snprintf(path, sizeof(vcfs_path), "%s/%s/%s%s,v", q->root, dir,
+             attic ? "Attic/" : "", name);
+}
+
+/* Check out a file for "co" */
+static void rcs_co_visit(rcs_req *q, char *dir, char *name, int attic)
+{
+    vcfs_path path;
+    rcs_file *r;
+    rcs_delta *d;
+
+    if (name == NULL)
+    {
+        rcs_printf(q->resp, "E cvs server: Updating %s\n", dir);
+        return;
+    }
+
+    rcs_walk_path(q, dir, name, attic, path);
+    r = rcs_open(path);
+    if (r == NULL)
+    {
+        return;
+    }
+
+    d = rcs_select(r, q->tag);
+    if (!rcs_dead(d))
+    {
+        rcs_put_file(q, r, d, dir, name, path, 1);
+    }
+
+    rcs_close(r);
+}
+
+/* See if a file has changed, for "rdiff -s" */
+static void rcs_rdiff_visit(rcs_req *q, char *dir, char *name, int attic)
+{
+    vcfs_path path;
+    rcs_file *r;
+    rcs_delta *from;
+    rcs_delta *to;
+
+    if (name == NULL)
+    {
+        return;
+    }
+
+    rcs_walk_path(q, dir, name, attic, path);
+    r = rcs_open(path);
+    if (r == NULL)
+    {
+        return;
+    }
+
+    from = rcs_at(r, q->since);
+    to = rcs_select(r, q->tag);
+
+    if (!rcs_dead(to) && rcs_dead(from))
+    {
+        rcs_printf(q->resp, "M File %s/%s is new; current revision %s\n",
+                   dir, name, to->ver);
+    }
+    else if (!rcs_dead(to) && strcmp(from->ver, to->ver))
+    {
+        rcs_printf(q->resp, "M File %s/%s changed from revision %s to %s\n",
+                   dir, name, from->ver, to->ver);
+    }
+    else if (rcs_dead(to) && !rcs_dead(from))
+    {
+        rcs_printf(q->resp, "M File %s/%s is removed; not included in "
+                   "release tag %s\n", dir, name,
+                   q->tag[0] ? q->tag : "HEAD");
+    }
+
+    rcs_close(r);
+}
+
+/* Add the log of a file, for "rlog" */
+static void rcs_rlog_visit(rcs_req *q, char *dir, char *name, int attic)
+{
+    vcfs_path path;
+    rcs_file *r;
+
+    if (name == NULL)
+    {
+        return;
+    }
+
+    rcs_walk_path(q, dir, name, attic, path);
+    r = rcs_open(path);
+    if (r != NULL)
+    {
+        rcs_put_log(q->resp, r, path, NULL);
+        rcs_close(r);
+    }
+}
+
+/* Is this a directory of the repository? */
+static int rcs_is_dir(char *root, char *dir)
+{
+    vcfs_path path;
+    struct stat st;
+
+    snprintf(path, sizeof(path), "%s/%s", root, dir);
+
+    return (stat(path, &st) == 0 && S_ISDIR(st.st_mode));
+}
+
+/* Answer "expand-modules". Modules are just directories here. */
+int cvs_rcs_expand_modules(char *module, cvs_buff **resp)
+{
+    *resp = cvs_get_buff();
+    rcs_printf(*resp, "Module-expansion %s\nok\n", module);
+
+    return 1;
+}
+
+/* Answer "co" for the whole module, at a tag or branch ("" for the head) */
+int cvs_rcs_co(char *root, char *module, char *tag, cvs_buff **resp)
+{
+    rcs_req q;
+
+    *resp = NULL;
+
+    if (!rcs_is_dir(root, module))
+    {
+        fprintf(stderr, "cvs_rcs: There is no %s in %s\n", module, root);
+        return 0;
+    }
+
+    q.resp = cvs_get_buff();
+    q.root = root;
+    q.tag = tag;
+    q.since = 0;
+
+    rcs_walk(&q, module, rcs_co_visit);
+    rcs_printf(q.resp, "ok\n");
+
+    *resp = q.resp;
+    return 1;
+}
+
+/* Answer "rdiff -s -D since" for the whole module. The date is the way
+ * cvs_rdiff_summary() sends it, "1 Jan 2001 00:00:00 -0000".
+ */
+int cvs_rcs_rdiff_summary(char *root, char *module, char *tag, char *since,
+                          cvs_buff **resp)
+{
+    char line[128];
+    rcs_req q;
+
+    *resp = NULL;
+
+    if (!rcs_is_dir(root, module))
+    {
+        return 0;
+    }
+
+    snprintf(line, sizeof(line), "Mod-time %s", since);
+
+    q.resp = cvs_get_buff();
+    q.root = root;
+    q.tag = tag;
+    q.since = cvs_mod_time(line);
+
+    rcs_walk(&q, module, rcs_rdiff_visit);
+    rcs_printf(q.resp, "ok\n");
+
+    *resp = q.resp;
+    return 1;
+}
+
+/* Answer "rlog" for a file or directory */
+int cvs_rcs_rlog(char *root, char *path, cvs_buff **resp)
+{
+    vcfs_path rcs_path;
+    rcs_file *r;
+    rcs_req q;
+
+    q.resp = cvs_get_buff();
+    q.root = root;
+    q.tag = "";
+    q.since = 0;
+
+    if (rcs_is_dir(root, path))
+    {
+        rcs_walk(&q, path, rcs_rlog_visit);
+    }
+    else if ((r = rcs_open_name(root, path, rcs_path)) != NULL)
+    {
+        rcs_put_log(q.resp, r, rcs_path, NULL);
+        rcs_close(r);
+    }
+
+    rcs_printf(q.resp, "ok\n");
+
+    *resp = q.resp;
+    return 1;
+}
+
+/* Answer "rlog" for a list of files */
+int cvs_rcs_rlog_files(char *root, char **paths, int n, cvs_buff **resp)
+{
+    vcfs_path rcs_path;
+    rcs_file *r;
+    int i;
+
+    *resp = cvs_get_buff();
+
+    for (i = 0; i < n; i++)
+    {
+        if ((r = rcs_open_name(root, paths[i], rcs_path)) != NULL)
+        {
+            rcs_put_log(*resp, r, rcs_path, NULL);
+            rcs_close(r);
+        }
+    }
+
+    rcs_printf(*resp, "ok\n");
+
+    return 1;
+}
+
+/* Answer "update -r ver" for one file */
+int cvs_rcs_get_file(char *root, char *name, char *ver, cvs_buff **resp)
+{
+    vcfs_path rcs_path;
+    vcfs_path parent;
+    vcfs_name entry;
+    rcs_file *r;
+    rcs_delta *d;
+    rcs_req q;
+    int found = 0;
+
+    q.resp = cvs_get_buff();
+    q.root = root;
+    q.tag = ver;
+    q.since = 0;
+
+    split_path(name, &parent, &entry);
+
+    r = rcs_open_name(root, name, rcs_path);
+    if (r != NULL)
+    {
+        d = rcs_select(r, ver);
+        found = !rcs_dead(d) &&
+            rcs_put_file(&q, r, d, parent, entry, rcs_path, 0);
+        rcs_close(r);
+    }
+
+    rcs_printf(q.resp, found ? "ok\n" : "error  \n");
+
+    *resp = q.resp;
+    return 1;
+}
+
+/* Answer "log" for one file */
+int cvs_rcs_get_log(char *root, char *name, cvs_buff **resp)
+{
+    vcfs_path rcs_path;
+    vcfs_path parent;
+    vcfs_name entry;
+    rcs_file *r;
+
+    *resp = cvs_get_buff();
+
+    split_path(name, &parent, &entry);
+
+    r = rcs_open_name(root, name, rcs_path);
+    if (r == NULL)
+    {
+        rcs_printf(*resp, "E cvs server: nothing known about %s\nerror  \n",
+                   entry);
+        return 1;
+    }
+
+    rcs_put_log(*resp, r, rcs_path, entry);
+    rcs_close(r);
+    rcs_printf(*resp, "ok\n");
+
+    return 1;
+}
@@ -0,0 +1,184 @@
+/*****************************************************************************
+ * Filename: cvs_rcsdiff.c
+ * This file contains functions to apply the RCS format differences ("diff
+ * -n") that the server sends in an Rcs-diff response, to turn a revision we
+ * already have into the one we asked for.
+ *
+ * A difference is a list of commands, in order of the line they start at:
+ *   dL N   delete N lines, starting at line L
+ *   aL N   add the N lines that follow, after line L
+ * Line numbers are those of the file the difference is applied to. Only the
+ * last line of either file may be missing its newline.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cvs_cmds.h"
+
+
+/* Find where every line of a file starts. Returns the number of lines;
+ * (*lines)[n] is the end of the file.
+ */
+static int cvs_rcsdiff_lines(char *data, int size, char ***lines)
+{
+    int max = 64;
+    int n = 0;
+    char *p = data;
+    char *end = data + size;
+    char *nl;
+
+    *lines = (char **)malloc((max + 1) * sizeof(char *));
+
+    while (p < end)
+    {
+        if (n == max)
+        {
+            max *= 2;
+            *lines = (char **)realloc(*lines, (max + 1) * sizeof(char *));
+        }
+        (*lines)[n++] = p;
+
+        nl = memchr(p, '\n', end - p);
+        p = (nl != NULL) ? nl + 1 : end;
+    }
+    (*lines)[n] = end;
+
+    return n;
+}
+
+/* Make sure there is room for len more bytes of output */
+static void cvs_rcsdiff_grow(char **out, int *max, int used, int len)
+{
+    if (used + len > *max)
+    {
+        while (used + len > *max)
+        {
+            *max *= 2;
+        }
+        *out = (char *)realloc(*out, *max);
+    }
+}
+
+/* Copy the part of a file from one line up to another to the output */
+static void cvs_rcsdiff_copy(char **out, int *max, int *used, char *from,
+                             char *to)
+{
+    cvs_rcsdiff_grow(out, max, *used, to - from);
+    memcpy(*out + *used, from, to - from);
+    *used += to - from;
+}
+
+/* Read the command at the start of a line of a difference. The difference
+ * isn't NUL-terminated, so only what is before the end of the line (or of
+ * the difference) is looked at. Returns 0 if it isn't a command.
+ */
+static int cvs_rcsdiff_cmd(char *p, char *end, char *cmd, int *line,
+                           int *count)
+{
+    char buf[64];
+    char *nl;
+    int n;
+
+    nl = memchr(p, '\n', end - p);
+    n = ((nl != NULL) ? nl : end) - p;
+    if (n >= (int)sizeof(buf))
+    {
+        return 0;
+    }
+
+    memcpy(buf, p, n);
+    buf[n] = '\0';
+
+    return (sscanf(buf, "%c%d %d", cmd, line, count) == 3);
+}
+
+/* Apply a difference to a file. Returns the size of the new file, with a
+ * malloc'ed copy of it in *out, or -1 (and *out NULL) if the difference
+ * doesn't make sense for this file.
+ */
+int cvs_rcsdiff_apply(char *base, int size, char *diff, int len, char **out)
+{
+    char **lines;
+    char *p = diff;
+    char *end = diff + len;
+    char *nl;
+    char cmd;
+    int nlines;
+    int next = 1; /* The first line of base not yet copied or deleted */
+    int max = size + len + 1;
+    int used = 0;
+    int bad = 0;
+    int copy;
+    int line;
+    int count;
+    int i;
+
+    nlines = cvs_rcsdiff_lines(base, size, &lines);
+    *out = (char *)malloc(max);
+
+    while (p < end && !bad)
+    {
+        if (!cvs_rcsdiff_cmd(p, end, &cmd, &line, &count) || count < 0 ||
+            (cmd != 'a' && cmd != 'd'))
+        {
+            bad = 1;
+            break;
+        }
+
+        nl = memchr(p, '\n', end - p);
+        p = (nl != NULL) ? nl + 1 : end;
+
+        /* Copy everything before the change (up to and including line
+         * for an add)
+         */
+        copy = (cmd == 'a') ? line : line - 1;
+        if (copy < next - 1 || copy > nlines ||
+            (cmd == 'd' && line + count - 1 > nlines))
+        {
+            bad = 1;
+            break;
+        }
+
+        cvs_rcsdiff_copy(out, &max, &used, lines[next - 1], lines[copy]);
+        next = copy + 1;
+
+        if (cmd == 'd')
+        {
+            next += count;
+            continue;
+        }
+
+        /* The lines to add follow the command */
+        for (i = 0; i < count; i++)
+        {
+            if (p >= end)
+            {
+                bad = 1;
+                break;
+            }
+
+            nl = memchr(p, '\n', end - p);
+            nl = (nl != NULL) ? nl + 1 : end;
+
+            cvs_rcsdiff_copy(out, &max, &used, p, nl);
+            p = nl;
+        }
+    }
+
+    if (bad)
+    {
+        fprintf(stderr, "cvs_rcsdiff_apply: Bad difference\n");
+        free(lines);
+        free(*out);
+        *out = NULL;
+        return -1;
+    }
+
+    /* And the rest of the file */
+    cvs_rcsdiff_copy(out, &max, &used, lines[next - 1], lines[nlines]);
+
+    free(lines);
+    return used;
+}
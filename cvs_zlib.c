@@ -1,13 +1,72 @@
 /*****************************************************************************
  * Filename: cvs_zlib.c
- * This file contains functions to deal with gzip'ed data read from CVS.
+ * This file contains functions to deal with gzip'ed data read from CVS:
+ * single files sent with gzip-file-contents, and whole connections that
+ * have been compressed with Gzip-stream.
  ****************************************************************************/
 
 
+#include <pthread.h>
 #include <zlib.h>
 
 #include "cvs_cmds.h"
 
+/* A connection compressed with Gzip-stream. Everything after the request
+ * goes through zlib in both directions, flushed at the end of each message
+ * so that neither side waits for more.
+ */
+typedef struct cvs_zstream {
+    int sock;
+    z_stream in;
+    z_stream out;
+    int full; /* The last inflate filled the caller's buffer */
+    unsigned char raw[CVS_READ_SIZE]; /* Read, but not inflated yet */
+    struct cvs_zstream *next;
+} cvs_zstream;
+
+static pthread_mutex_t zstream_lock = PTHREAD_MUTEX_INITIALIZER;
+static cvs_zstream *zstreams = NULL; /* Protected by zstream_lock */
+
+
+/* Find the end of the gzip header at the start of buf. Returns its size,
+ * or -1 if this isn't gzip'ed data we understand.
+ */
+static int cvs_zlib_header_size(unsigned char *buf)
+{
+    int pos;
+
+    /* Check the gzip header */
+    if (buf[0] != 31 || buf[1] != 139)
+    {
+        fprintf(stderr, "gzipped data does not start with gzip identification\n");
+        return -1;
+    }
+    if (buf[2] != 8)
+    {
+        fprintf(stderr, "only the deflate compression method is supported\n");
+        return -1;
+    }
+    
+    pos = 10;
+    if (buf[3] & 4)
+    {
+        pos += buf[pos] + (buf[pos + 1] << 8) + 2;
+    }
+    if (buf[3] & 8)
+    {
+        pos += strlen (buf + pos) + 1;
+    }
+    if (buf[3] & 16)
+    {
+        pos += strlen (buf + pos) + 1;
+    }
+    if (buf[3] & 2)
+    {
+        pos += 2;
+    }
+
+    return pos;
+}
 
 /* Uncompress a cvs data buffer and return the true size of the data */
 int cvs_zlib_inflate_buffer(cvs_buff *input_buff, int in_size, int in_offset, 
@@ -47,36 +106,11 @@ int cvs_zlib_inflate_buffer(cvs_buff *input_buff, int in_size, int in_offset,
         return 0;
     }
 
-    /* Check the gzip header */
-    if (buf[0] != 31 || buf[1] != 139)
-    {
-        fprintf(stderr, "gzipped data does not start with gzip identification\n");
-        return 0;
-    }
-    if (buf[2] != 8)
+    if ((pos = cvs_zlib_header_size(buf)) < 0)
     {
-        fprintf(stderr, "only the deflate compression method is supported\n");
         return 0;
     }
     
-    pos = 10;
-    if (buf[3] & 4)
-    {
-        pos += buf[pos] + (buf[pos + 1] << 8) + 2;
-    }
-    if (buf[3] & 8)
-    {
-        pos += strlen (buf + pos) + 1;
-    }
-    if (buf[3] & 16)
-    {
-        pos += strlen (buf + pos) + 1;
-    }
-    if (buf[3] & 2)
-    {
-        pos += 2;
-    }
-    
     stream.next_in = (Bytef *)buf + pos;
     stream.avail_in = in_size - pos;
     
@@ -129,3 +163,249 @@ int cvs_zlib_inflate_buffer(cvs_buff *input_buff, int in_size, int in_offset,
     
 }
                             
+/* Uncompress a whole gzip'ed file from a cvs data buffer into a malloc'ed
+ * buffer. Returns the size of the uncompressed data, or -1 on error.
+ */
+int cvs_zlib_inflate_all(cvs_buff *input_buff, int in_size, char **output)
+{
+    z_stream stream;
+    int status;
+    int size;
+    unsigned char *buf = (input_buff->data + input_buff->cookie);
+    int pos;
+    int limit;
+    char *out;
+
+    if ((pos = cvs_zlib_header_size(buf)) < 0)
+    {
+        return -1;
+    }
+
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = 0;
+    stream.next_in = (Bytef *)buf + pos;
+    stream.avail_in = in_size - pos;
+
+    /* Undocumented feature: negative argument makes zlib skip the gzip header */
+    status = inflateInit2(&stream, -15);
+    if (status != Z_OK)
+    {
+        printf("error is %d\n", status);
+        return -1;
+    }
+
+    /* Source files usually shrink to a quarter or so */
+    limit = 4 * in_size + 1024;
+    out = malloc(limit);
+
+    do
+    {
+        if (stream.total_out == limit)
+        {
+            /* The output buffer is full */
+            limit *= 2;
+            out = realloc(out, limit);
+        }
+
+        stream.next_out = (Bytef *)out + stream.total_out;
+        stream.avail_out = limit - stream.total_out;
+
+        status = inflate(&stream, Z_NO_FLUSH);
+    } while (status == Z_OK);
+
+    if (status != Z_STREAM_END)
+    {
+        fprintf(stderr, "zlib error! %d, %s\n", status, stream.msg);
+        inflateEnd(&stream);
+        free(out);
+        return -1;
+    }
+
+    size = stream.total_out;
+    inflateEnd(&stream);
+
+    *output = out;
+    return size;
+}
+
+/* Find the compressed stream on a connection. Returns NULL if it isn't
+ * compressed.
+ */
+static cvs_zstream *cvs_zlib_stream_find(int sock)
+{
+    cvs_zstream *z;
+
+    pthread_mutex_lock(&zstream_lock);
+    for (z = zstreams; z != NULL && z->sock != sock; z = z->next)
+        ;
+    pthread_mutex_unlock(&zstream_lock);
+
+    return z;
+}
+
+/* Compress everything on a connection from now on, at the given level.
+ * The caller has already sent the Gzip-stream request. Returns -1 if zlib
+ * can't be set up.
+ */
+int cvs_zlib_stream_start(int sock, int level)
+{
+    cvs_zstream *z;
+
+    z = (cvs_zstream *)malloc(sizeof(cvs_zstream));
+    memset(z, 0, sizeof(cvs_zstream));
+    z->sock = sock;
+
+    if (inflateInit(&z->in) != Z_OK)
+    {
+        fprintf(stderr, "zlib error! %s\n", z->in.msg);
+        free(z);
+        return -1;
+    }
+
+    if (deflateInit(&z->out, level) != Z_OK)
+    {
+        fprintf(stderr, "zlib error! %s\n", z->out.msg);
+        inflateEnd(&z->in);
+        free(z);
+        return -1;
+    }
+
+    pthread_mutex_lock(&zstream_lock);
+    z->next = zstreams;
+    zstreams = z;
+    pthread_mutex_unlock(&zstream_lock);
+
+    return 0;
+}
+
+/* Forget the compressed stream on a connection that is being closed */
+void cvs_zlib_stream_end(int sock)
+{
+    cvs_zstream **p;
+    cvs_zstream *z;
+
+    pthread_mutex_lock(&zstream_lock);
+    for (p = &zstreams; *p != NULL && (*p)->sock != sock; p = &(*p)->next)
+        ;
+    z = *p;
+    if (z != NULL)
+    {
+        *p = z->next;
+    }
+    pthread_mutex_unlock(&zstream_lock);
+
+    if (z != NULL)
+    {
+        inflateEnd(&z->in);
+        deflateEnd(&z->out);
+        free(z);
+    }
+}
+
+/* Is the connection compressed? */
+int cvs_zlib_stream_on(int sock)
+{
+    return (cvs_zlib_stream_find(sock) != NULL);
+}
+
+/* Is there data we have already read from the connection that hasn't been
+ * handed out yet? If so, there may be nothing more to poll() for.
+ */
+int cvs_zlib_stream_pending(int sock)
+{
+    cvs_zstream *z = cvs_zlib_stream_find(sock);
+
+    return (z != NULL && (z->in.avail_in > 0 || z->full));
+}
+
+/* Send len bytes of msg on a connection, compressing them if it is
+ * compressed. Returns -1 if the connection is broken.
+ */
+int cvs_zlib_stream_send(int sock, char *msg, int len)
+{
+    cvs_zstream *z;
+    unsigned char buf[CVS_READ_SIZE];
+    int size;
+    int sent;
+    int n;
+
+    z = cvs_zlib_stream_find(sock);
+    if (z == NULL)
+    {
+        return send(sock, msg, len, MSG_NOSIGNAL);
+    }
+
+    z->out.next_in = (Bytef *)msg;
+    z->out.avail_in = len;
+
+    do
+    {
+        z->out.next_out = buf;
+        z->out.avail_out = sizeof(buf);
+
+        if (deflate(&z->out, Z_SYNC_FLUSH) == Z_STREAM_ERROR)
+        {
+            fprintf(stderr, "zlib error! %s\n", z->out.msg);
+            return -1;
+        }
+
+        size = sizeof(buf) - z->out.avail_out;
+        for (sent = 0; sent < size; sent += n)
+        {
+            n = send(sock, buf + sent, size - sent, MSG_NOSIGNAL);
+            if (n < 0)
+            {
+                return -1;
+            }
+        }
+    } while (z->out.avail_out == 0);
+
+    return len;
+}
+
+/* Read up to len bytes from a connection, uncompressing them if it is
+ * compressed. Like recv(), returns 0 when the server has closed the
+ * connection and -1 on error.
+ */
+int cvs_zlib_stream_recv(int sock, char *buf, int len)
+{
+    cvs_zstream *z;
+    int status = Z_OK;
+    int n;
+
+    z = cvs_zlib_stream_find(sock);
+    if (z == NULL)
+    {
+        return recv(sock, buf, len, 0);
+    }
+
+    z->in.next_out = (Bytef *)buf;
+    z->in.avail_out = len;
+
+    /* A read can give us nothing but the end of the last flush */
+    while (z->in.avail_out == len && status != Z_STREAM_END)
+    {
+        if (z->in.avail_in == 0)
+        {
+            n = recv(sock, z->raw, sizeof(z->raw), 0);
+            if (n <= 0)
+            {
+                return n;
+            }
+
+            z->in.next_in = z->raw;
+            z->in.avail_in = n;
+        }
+
+        status = inflate(&z->in, Z_SYNC_FLUSH);
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)
+        {
+            fprintf(stderr, "zlib error! %d, %s\n", status, z->in.msg);
+            return -1;
+        }
+    }
+
+    z->full = (z->in.avail_out == 0);
+    return len - z->in.avail_out;
+}
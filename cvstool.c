@@ -108,6 +108,13 @@ void cvstool_do_help()
     printf("%s:   lsver -l        List all of the versions of this file with more information\n", 
            PROG_NAME);
     printf("%s:   lsver -p        List the previous version of this file\n", PROG_NAME);
+    printf("%s:   update -t TAG   Change this file, or every file in this directory,\n",
+           PROG_NAME);
+    printf("%s:                   to the version with the given tag\n", PROG_NAME);
+    printf("%s:   update -r REV   Change this file, or every file in this directory,\n",
+           PROG_NAME);
+    printf("%s:                   to the given revision\n", PROG_NAME);
+    printf("%s:   update -d       Pick up any changes made to the repository\n", PROG_NAME);
     
     /* This should be last */
     printf("%s:   help            Prints out this help message\n", PROG_NAME);
@@ -147,6 +154,11 @@ void cvstool_error_msg(cvstool_status status, char *arg)
         fprintf(stderr, "%s: The given does not exist for this file\n",
                 PROG_NAME);
         break;
+
+    case CVSTOOL_NOVER:
+        fprintf(stderr, "%s: The given revision does not exist for this file\n",
+                PROG_NAME);
+        break;
         
     default:
         fprintf(stderr, "%s: Unspecified error\n", PROG_NAME);
@@ -434,9 +446,11 @@ int cvstool_do_update(char **argv, int argc)
     opterr = 0;
     
     args.options = 0;
+    args.ver = "";
+    args.tag = "";
     
     /* Get all options for the 'update' command */
-    while ((opt = getopt(argc, argv, "dv:t:")) != -1)
+    while ((opt = getopt(argc, argv, "dv:r:t:")) != -1)
     {
         switch (opt)
         {
@@ -446,6 +460,7 @@ int cvstool_do_update(char **argv, int argc)
             break;
         }
         case 'v':
+        case 'r':
         {
             args.options |= CVSTOOL_UPDATE_VER;
             args.ver = strdup(optarg);
@@ -496,13 +511,6 @@ int cvstool_do_update(char **argv, int argc)
     }
     else
     {
-        if (args.options & CVSTOOL_UPDATE_VER)
-        {
-            /* Can only update a particular file to a version */
-            cvstool_usage("No filename specified");
-            exit(1);
-        }
-        
         /* The user wants to update the entire project */
         args.path = strdup("");
     }
@@ -12,7 +12,22 @@
 #include <assert.h>
 
 int cvstool_get_author_date(vcfs_ventry *v, char **date, char **author);
-bool cvstool_validate_tag(vcfs_ventry *v, const char *tag, char **ver);
+
+/* Add a version to the end of an lsver result */
+static cvstool_ver_info **cvstool_add_ver(cvstool_ver_info **versp, char *ver,
+                                          char *date, char *author)
+{
+    cvstool_ver_info *vers;
+
+    vers = *versp = (cvstool_ver_info *)malloc(sizeof(cvstool_ver_info));
+    vers->ver = strdup(ver);
+    vers->date = strdup(date ? date : "");
+    vers->author = strdup(author ? author : "");
+    vers->tag = strdup("");
+    vers->next = NULL;
+
+    return &vers->next;
+}
 
 cvstool_ls_resp *
 cvstool_ls_1(cvstool_ls_args *argp, struct svc_req *rqstp)
@@ -88,18 +103,22 @@ cvstool_ls_1(cvstool_ls_args *argp, struct svc_req *rqstp)
     else if (v->type == NFDIR)
     {
         int count = 0;
+        int i;
         vcfs_ventry *entry;
         cvstool_dirent *dirent, **direntp;
         
         direntp = &(result.dirents);
         
         /* List an entire directory */
-        for (entry = v->dirent; entry != NULL; entry = entry->next)
+        for (i = 0; i < v->nents; i++)
         {
             vcfs_path parent;
             vcfs_name name;
             
-            if (entry->type != NFREG || strchr(entry->name, ','))
+            entry = v->dirent[i];
+            
+            if (entry == NULL || entry->type != NFREG ||
+                strchr(entry->name, ','))
                 continue;
             
             split_path(entry->name, &parent, &name);
@@ -159,10 +178,15 @@ cvstool_lsver_1(cvstool_lsver_args *argp, struct svc_req *rqstp)
 	static cvstool_lsver_resp  result;
     vcfs_fileid *id;
     vcfs_ventry *v;
-    cvs_buff *resp;
-    char *ver, *author, *date;
+    vcfs_path name;
+    vcfs_index *x;
+    vcfs_hist *h;
+    vcfs_rev *r;
     int count = 0;
-    cvstool_ver_info *vers, **versp;
+    int file = -1;
+    int i;
+    int n;
+    cvstool_ver_info **versp;
     
     /* Free previous result */
     xdr_free((xdrproc_t)xdr_cvstool_lsver_resp, (caddr_t)&result);
@@ -189,36 +213,67 @@ cvstool_lsver_1(cvstool_lsver_args *argp, struct svc_req *rqstp)
     }
     
     versp = &(result.vers);
+    vcfs_view_real(v->name, name);
     
-    cvs_get_log(v->name, &resp);
+    /* The index will do unless the file has moved on since it was built */
+    x = vcfs_index_get();
+    if (x != NULL)
+    {
+        file = vcfs_index_file(x, name);
+        if (file >= 0 && vcfs_index_find(x, file, v->ver) < 0)
+        {
+            file = -1;
+        }
+    }
     
-    while(TRUE)
+    if (file >= 0)
     {
-        vers = *versp = (cvstool_ver_info *)malloc(sizeof(cvstool_ver_info));
-        
-        if (cvs_get_log_info(resp, &vers->ver, &vers->date, 
-                             &vers->author, NULL) == 0)
+        for (i = 0; i < x->file_nrevs[file]; i++)
         {
-            /* We've read all the versions we can */
-            break;
+            if ((argp->options & CVSTOOL_LSVER_PRE) && i != 1)
+            {
+                /* Only return the predecessor */
+                continue;
+            }
+            
+            n = x->file_rev[file] + i;
+            versp = cvstool_add_ver(versp, x->rev_ver[n],
+                                    x->strs + x->rev_date[n],
+                                    x->strs + x->rev_author[n]);
+            count++;
         }
-        vers->tag = strdup("");
-        vers->next = NULL;
-        versp = &vers->next;
         
-        if ((argp->options & CVSTOOL_LSVER_PRE) && count == 1)
+        *versp = NULL;
+        
+        result.num_resp = count;
+        result.status = CVSTOOL_OK;
+        return &result;
+    }
+    
+    h = vcfs_hist_get(name);
+    
+    if (h == NULL)
+    {
+        result.status = CVSTOOL_CVSERR;
+        return &result;
+    }
+    
+    for (i = 0; i < h->nrevs; i++)
+    {
+        if ((argp->options & CVSTOOL_LSVER_PRE) && i != 1)
         {
-            /* We just read the predecessor, only return it */
-            result.vers = vers;
-            break;
+            /* Only return the predecessor */
+            continue;
         }
-   
+        
+        r = &h->revs[i];
+        versp = cvstool_add_ver(versp, r->ver, r->date, r->author);
         count++;
     }
     
     *versp = NULL;
     
-    cvs_free_buff(resp);
+    vcfs_hist_release(h);
 
     result.num_resp = count;
     result.status = CVSTOOL_OK;
@@ -226,140 +281,346 @@ cvstool_lsver_1(cvstool_lsver_args *argp, struct svc_req *rqstp)
 	return &result;
 }
 
-cvstool_update_resp *
-cvstool_update_1(cvstool_update_args *argp, struct svc_req *rqstp)
+/* A file being switched to another revision by 'cvstool update' */
+typedef struct cvstool_target {
+    vcfs_ventry *v;
+    int found; /* Whether the file has the tag or revision */
+    vcfs_ver ver;
+    time_t when; /* When ver was committed */
+} cvstool_target;
+
+/* Add every file under a directory (or just the file) to a list of files
+ * to update
+ */
+static void cvstool_collect(vcfs_ventry *v, cvstool_target **t, int *n,
+                            int *max)
 {
-    static cvstool_update_resp  result;
-    vcfs_fileid *id;
-    vcfs_ventry *v = NULL;
-    vcfs_path parent;
-    vcfs_name name;
+    int i;
 
-    ASSERT(argp->path != NULL, "NULL path");
-    
-    if (strcmp(argp->path, ""))
+    if (vcfs_view_real(v->name, NULL))
     {
-        /* Update a single file */
-        /* TODO: Update entire directory */
-        id = (vcfs_fileid *)lookup_fh_name(argp->path);
-        
-        if (id == NULL)
-        {
-            result.status = CVSTOOL_NOENT;
-            return &result;
-        }
-        
-        v = id->ventry;
-        
-        ASSERT(v != NULL, "NULL ventry");
-        ASSERT(v->type == NFREG, "TEMP: Only update files");
+        /* Views of other tags stay on their tag */
+        return;
+    }
 
-        if (argp->options & CVSTOOL_UPDATE_TAG)
+    if (v->type == NFDIR)
+    {
+        for (i = 0; i < v->nents; i++)
         {
-            /* We are updating to a tag */
-            char *ver;
-            
-            if (cvstool_validate_tag(v, argp->tag, &ver))
+            if (v->dirent[i] != NULL)
             {
-                /* Update the version and tag of this ventry */
-                strncpy(v->tag, argp->tag, sizeof(v->tag));
-                strncpy(v->ver, ver, sizeof(v->ver));
-                free(ver);
-                result.status = CVSTOOL_OK;
-            }
-            else
-            {
-                /* Not a valid tag for this file */
-                result.status = CVSTOOL_NOTAG;
+                cvstool_collect(v->dirent[i], t, n, max);
             }
         }
+        return;
     }
-    
-    return &result;
+
+    if (v->type != NFREG || strchr(v->name, ','))
+    {
+        return;
+    }
+
+    if (*n == *max)
+    {
+        *max = *max ? *max * 2 : 64;
+        *t = (cvstool_target *)realloc(*t, *max * sizeof(cvstool_target));
+    }
+
+    memset(&(*t)[*n], 0, sizeof(cvstool_target));
+    (*t)[*n].v = v;
+    (*n)++;
 }
 
-/* Get the author and date of a file version */
-int cvstool_get_author_date(vcfs_ventry *v, char **date, char **author)
+static int cvstool_target_cmp(const void *a, const void *b)
 {
-    int n;
-    cvs_buff *resp;
-    
-    cvs_get_status(v->name, v->ver, &resp);
-    
-    n = cvs_get_log_info(resp, NULL, date, author, NULL);
-    
-    cvs_free_buff(resp);
+    return strcmp(((cvstool_target *)a)->v->name,
+                  ((cvstool_target *)b)->v->name);
+}
+
+/* Work out what a file should be switched to from an index: the revision
+ * itself, or what the tag stands for (the newest revision on the branch for
+ * a branch tag), unless the file had been removed by then. Returns 0 if
+ * the index doesn't know.
+ */
+static int cvstool_resolve_index(vcfs_index *x, int file,
+                                 cvstool_update_args *argp, cvstool_target *t)
+{
+    int i;
+    int r;
 
-    return n;
+    if (file < 0)
+    {
+        return 0;
+    }
+
+    if (argp->options & CVSTOOL_UPDATE_TAG)
+    {
+        i = vcfs_index_tag(x, file, argp->tag);
+        if (i < 0)
+        {
+            return 0;
+        }
+
+        r = vcfs_index_rev(x, file, x->tag_ver[i]);
+        if (r >= 0 && !strcmp(x->strs + x->rev_state[r], "dead"))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        r = vcfs_index_find(x, file, argp->ver);
+    }
+
+    if (r < 0)
+    {
+        return 0;
+    }
+
+    memcpy(t->ver, x->rev_ver[r], sizeof(vcfs_ver));
+    t->when = x->rev_when[r];
+    t->found = 1;
+    return 1;
 }
 
-/* Validate that the given tag is valid for the given ventry. If so, *ver 
- * points to the version number that the tag represents.
+/* Find out what every file should be switched to. The index answers for
+ * most of them, and one "rlog" of the whole thing answers for the rest.
+ * Returns 0 if the server couldn't be asked.
  */
-bool cvstool_validate_tag(vcfs_ventry *v, const char *tag, char **ver)
+static int cvstool_resolve(char *path, cvstool_update_args *argp,
+                           cvstool_target *t, int n)
 {
+    cvstool_target key;
+    cvstool_target *found;
+    vcfs_ventry kv;
+    vcfs_index *x;
+    vcfs_hist *h;
     cvs_buff *resp;
-    char *beg;
-    int n;
-    char *line;
-    bool found_beg = FALSE;
+    int missing = 0;
+    int i;
 
-    ASSERT(v != NULL, "Can't validate tag of a NULL ventry");
-    
-    cvs_get_status_tags(v, &resp);
-    
-    if (resp == NULL)
+    x = vcfs_index_get();
+
+    for (i = 0; i < n; i++)
     {
-        return FALSE;
+        if (x == NULL ||
+            !cvstool_resolve_index(x, vcfs_index_file(x, t[i].v->name), argp,
+                                   &t[i]))
+        {
+            missing++;
+        }
     }
-    
-    /* Look for a line beginning with 'Existing Tags', then look at the
-     * following lines for the given tag.
+
+    if (missing == 0)
+    {
+        return 1;
+    }
+
+    /* Either the index isn't ready, or the tag or revision is newer than
+     * it, or these files really don't have it
      */
-    while ((n = cvs_buff_read_line(resp, &line)) > 0)
+    cvs_rlog(path, &resp);
+    if (resp == NULL)
+    {
+        return 0;
+    }
+
+    key.v = &kv;
+
+    for (;;)
     {
-        if (!found_beg)
+        h = (vcfs_hist *)calloc(1, sizeof(vcfs_hist));
+
+        if (cvs_parse_log(resp, h) < 0)
         {
-            /* No other line in this response should have "Tags:" in it */
-            beg = strstr(line, "Tags:");
-            if (beg != NULL)
-            {
-                /* Found the line */
-                found_beg = TRUE;
-            }
+            vcfs_hist_free(h);
+            break;
         }
-        else
+
+        strcpy(kv.name, h->name);
+        found = bsearch(&key, t, n, sizeof(cvstool_target),
+                        cvstool_target_cmp);
+
+        if (found != NULL && !found->found)
         {
-            /* This will work as long as the tag name is not "revision"
-             * or "branch"... but who would do that??
-             */
-            beg = strstr(line, tag);
-            if (beg != NULL)
-            {
-                /* Found it! Now get the related version */
-                char *end;
-                int len;
-
-                beg = strchr(line, ':');
-                ASSERT(beg != NULL, "Weird response from cvs status -v");
-                beg += 2;
-                
-                end = strchr(line, ')');
-                ASSERT(end != NULL && beg < end, "Weird response from cvs status -v");
-                
-                len = end - beg;
-                
-                *ver = malloc(len + 1);
-                strncpy(*ver, beg, len);
-                (*ver)[len] = '\0';
-                free(line);
-                return TRUE;
-            }
+            x = vcfs_index_hist(h);
+            cvstool_resolve_index(x, 0, argp, found);
+            vcfs_index_free(x);
+        }
+        vcfs_hist_free(h);
+    }
+
+    cvs_free_buff(resp);
+    return 1;
+}
+
+/* Switch a file or a whole directory to a tag or revision, in a single
+ * change to the namespace. Files that don't have the tag or revision are
+ * left as they are.
+ */
+static cvstool_status cvstool_switch(cvstool_update_args *argp)
+{
+    cvstool_target *t = NULL;
+    vcfs_ventry *v;
+    vcfs_blob *b;
+    char *tag;
+    int n = 0;
+    int max = 0;
+    int found = 0;
+    int changed = 0;
+    int i;
+
+    if (strcmp(argp->path, ""))
+    {
+        vcfs_fileid *id = lookup_fh_name(argp->path);
+
+        if (id == NULL)
+        {
+            return CVSTOOL_NOENT;
+        }
+        v = id->ventry;
+        ASSERT(v != NULL, "NULL ventry");
+    }
+    else
+    {
+        v = vcfs_ns_root();
+    }
+
+    cvstool_collect(v, &t, &n, &max);
+    qsort(t, n, sizeof(cvstool_target), cvstool_target_cmp);
+
+    if (!cvstool_resolve(strcmp(argp->path, "") ? argp->path : NULL, argp,
+                         t, n))
+    {
+        free(t);
+        return CVSTOOL_CVSERR;
+    }
+
+    tag = (argp->options & CVSTOOL_UPDATE_TAG) ? argp->tag : "";
+
+    vcfs_ns_begin();
+
+    for (i = 0; i < n; i++)
+    {
+        if (!t[i].found)
+        {
+            continue;
+        }
+        found++;
+
+        if (!strcmp(t[i].v->ver, t[i].ver) && !strcmp(t[i].v->tag, tag))
+        {
+            continue;
+        }
+
+        v = vcfs_ns_edit(t[i].v->name);
+        if (v == NULL)
+        {
+            continue;
+        }
+
+        strncpy(v->ver, t[i].ver, sizeof(v->ver) - 1);
+        strncpy(v->tag, tag, sizeof(v->tag) - 1);
+
+        v->mtime = t[i].when;
+
+        /* If we already have this revision we know how big it is; if not,
+         * the size is put right when it is first read
+         */
+        b = vcfs_cache_get(v->name, v->ver);
+        if (b != NULL)
+        {
+            v->size = b->size;
+            vcfs_cache_release(b);
+        }
+
+        changed++;
+    }
+
+    vcfs_ns_commit();
+
+    DEBUG(DEBUG_M, "[cvstool_switch] %s: %d of %d files have it, %d changed",
+          argp->path, found, n, changed);
+
+    free(t);
+
+    if (found == 0)
+    {
+        return (argp->options & CVSTOOL_UPDATE_TAG) ? CVSTOOL_NOTAG :
+            CVSTOOL_NOVER;
+    }
+
+    return CVSTOOL_OK;
+}
+
+cvstool_update_resp *
+cvstool_update_1(cvstool_update_args *argp, struct svc_req *rqstp)
+{
+    static cvstool_update_resp  result;
+
+    ASSERT(argp->path != NULL, "NULL path");
+
+    result.status = CVSTOOL_OK;
+
+    if (argp->options & CVSTOOL_UPDATE_DYNAMIC)
+    {
+        /* Pick up whatever has changed in the repository */
+        if (vcfs_refresh() < 0)
+        {
+            result.status = CVSTOOL_CVSERR;
+            return &result;
         }
-        
-        free(line);
     }
     
-    return FALSE;
+    if (argp->options & (CVSTOOL_UPDATE_TAG | CVSTOOL_UPDATE_VER))
+    {
+        /* Switch a file, a directory, or the whole project */
+        result.status = cvstool_switch(argp);
+    }
+    
+    return &result;
 }
 
+/* Get the author and date of a file version */
+int cvstool_get_author_date(vcfs_ventry *v, char **date, char **author)
+{
+    vcfs_path name;
+    vcfs_index *x;
+    vcfs_hist *h;
+    vcfs_rev *r = NULL;
+    int file;
+    int n;
+    
+    vcfs_view_real(v->name, name);
+    
+    x = vcfs_index_get();
+    if (x != NULL)
+    {
+        file = vcfs_index_file(x, name);
+        n = (file >= 0) ? vcfs_index_find(x, file, v->ver) : -1;
+        
+        if (n >= 0)
+        {
+            *date = strdup(x->strs + x->rev_date[n]);
+            *author = strdup(x->strs + x->rev_author[n]);
+            return 1;
+        }
+    }
+    
+    h = vcfs_hist_get(name);
+    
+    if (h != NULL)
+    {
+        r = vcfs_hist_find(h, v->ver);
+    }
+    
+    *date = strdup((r != NULL && r->date != NULL) ? r->date : "");
+    *author = strdup((r != NULL && r->author != NULL) ? r->author : "");
+    
+    if (h != NULL)
+    {
+        vcfs_hist_release(h);
+    }
+
+    return (r != NULL);
+}
@@ -0,0 +1,483 @@
+/*
+ * NFS version 3, from RFC 1813. Only what vcfsd needs is here: the
+ * procedures that look at the filesystem are described in full, and the
+ * ones that would change it just get enough of a reply to say that it's
+ * read only. Their arguments are never looked at.
+ */
+
+%#include "nfs_redefines.h"
+
+const NFS3_FHSIZE = 64;
+const NFS3_COOKIEVERFSIZE = 8;
+const NFS3_CREATEVERFSIZE = 8;
+const NFS3_WRITEVERFSIZE = 8;
+
+typedef unsigned hyper uint64;
+typedef hyper int64;
+typedef unsigned int uint32;
+typedef int int32;
+typedef string filename3<>;
+typedef string nfspath3<>;
+typedef uint64 fileid3;
+typedef uint64 cookie3;
+typedef opaque cookieverf3[NFS3_COOKIEVERFSIZE];
+typedef uint32 uid3;
+typedef uint32 gid3;
+typedef uint64 size3;
+typedef uint64 offset3;
+typedef uint32 mode3;
+typedef uint32 count3;
+
+enum nfsstat3 {
+	NFS3_OK = 0,
+	NFS3ERR_PERM = 1,
+	NFS3ERR_NOENT = 2,
+	NFS3ERR_IO = 5,
+	NFS3ERR_NXIO = 6,
+	NFS3ERR_ACCES = 13,
+	NFS3ERR_EXIST = 17,
+	NFS3ERR_XDEV = 18,
+	NFS3ERR_NODEV = 19,
+	NFS3ERR_NOTDIR = 20,
+	NFS3ERR_ISDIR = 21,
+	NFS3ERR_INVAL = 22,
+	NFS3ERR_FBIG = 27,
+	NFS3ERR_NOSPC = 28,
+	NFS3ERR_ROFS = 30,
+	NFS3ERR_MLINK = 31,
+	NFS3ERR_NAMETOOLONG = 63,
+	NFS3ERR_NOTEMPTY = 66,
+	NFS3ERR_DQUOT = 69,
+	NFS3ERR_STALE = 70,
+	NFS3ERR_REMOTE = 71,
+	NFS3ERR_BADHANDLE = 10001,
+	NFS3ERR_NOT_SYNC = 10002,
+	NFS3ERR_BAD_COOKIE = 10003,
+	NFS3ERR_NOTSUPP = 10004,
+	NFS3ERR_TOOSMALL = 10005,
+	NFS3ERR_SERVERFAULT = 10006,
+	NFS3ERR_BADTYPE = 10007,
+	NFS3ERR_JUKEBOX = 10008
+};
+
+enum ftype3 {
+	NF3REG = 1,
+	NF3DIR = 2,
+	NF3BLK = 3,
+	NF3CHR = 4,
+	NF3LNK = 5,
+	NF3SOCK = 6,
+	NF3FIFO = 7
+};
+
+struct specdata3 {
+	uint32 specdata1;
+	uint32 specdata2;
+};
+
+struct nfs_fh3 {
+	opaque data<NFS3_FHSIZE>;
+};
+
+struct nfstime3 {
+	uint32 seconds;
+	uint32 nseconds;
+};
+
+struct fattr3 {
+	ftype3 type;
+	mode3 mode;
+	uint32 nlink;
+	uid3 uid;
+	gid3 gid;
+	size3 size;
+	size3 used;
+	specdata3 rdev;
+	uint64 fsid;
+	fileid3 fileid;
+	nfstime3 atime;
+	nfstime3 mtime;
+	nfstime3 ctime;
+};
+
+union post_op_attr switch (bool attributes_follow) {
+case TRUE:
+	fattr3 attributes;
+case FALSE:
+	void;
+};
+
+struct wcc_attr {
+	size3 size;
+	nfstime3 mtime;
+	nfstime3 ctime;
+};
+
+union pre_op_attr switch (bool attributes_follow) {
+case TRUE:
+	wcc_attr attributes;
+case FALSE:
+	void;
+};
+
+struct wcc_data {
+	pre_op_attr before;
+	post_op_attr after;
+};
+
+union post_op_fh3 switch (bool handle_follows) {
+case TRUE:
+	nfs_fh3 handle;
+case FALSE:
+	void;
+};
+
+struct diropargs3 {
+	nfs_fh3 dir;
+	filename3 name;
+};
+
+/* GETATTR */
+struct GETATTR3resok {
+	fattr3 obj_attributes;
+};
+
+union GETATTR3res switch (nfsstat3 status) {
+case NFS3_OK:
+	GETATTR3resok resok;
+default:
+	void;
+};
+
+/* LOOKUP */
+struct LOOKUP3resok {
+	nfs_fh3 object;
+	post_op_attr obj_attributes;
+	post_op_attr dir_attributes;
+};
+
+struct LOOKUP3resfail {
+	post_op_attr dir_attributes;
+};
+
+union LOOKUP3res switch (nfsstat3 status) {
+case NFS3_OK:
+	LOOKUP3resok resok;
+default:
+	LOOKUP3resfail resfail;
+};
+
+/* ACCESS */
+const ACCESS3_READ = 0x0001;
+const ACCESS3_LOOKUP = 0x0002;
+const ACCESS3_MODIFY = 0x0004;
+const ACCESS3_EXTEND = 0x0008;
+const ACCESS3_DELETE = 0x0010;
+const ACCESS3_EXECUTE = 0x0020;
+
+struct ACCESS3args {
+	nfs_fh3 object;
+	uint32 access;
+};
+
+struct ACCESS3resok {
+	post_op_attr obj_attributes;
+	uint32 access;
+};
+
+struct ACCESS3resfail {
+	post_op_attr obj_attributes;
+};
+
+union ACCESS3res switch (nfsstat3 status) {
+case NFS3_OK:
+	ACCESS3resok resok;
+default:
+	ACCESS3resfail resfail;
+};
+
+/* READLINK */
+struct READLINK3resok {
+	post_op_attr symlink_attributes;
+	nfspath3 data;
+};
+
+struct READLINK3resfail {
+	post_op_attr symlink_attributes;
+};
+
+union READLINK3res switch (nfsstat3 status) {
+case NFS3_OK:
+	READLINK3resok resok;
+default:
+	READLINK3resfail resfail;
+};
+
+/* READ */
+struct READ3args {
+	nfs_fh3 file;
+	offset3 offset;
+	count3 count;
+};
+
+struct READ3resok {
+	post_op_attr file_attributes;
+	count3 count;
+	bool eof;
+	opaque data<>;
+};
+
+struct READ3resfail {
+	post_op_attr file_attributes;
+};
+
+union READ3res switch (nfsstat3 status) {
+case NFS3_OK:
+	READ3resok resok;
+default:
+	READ3resfail resfail;
+};
+
+/* What SETATTR, WRITE, CREATE, MKDIR, SYMLINK, MKNOD, REMOVE, RMDIR and
+ * COMMIT all send back when they fail */
+struct WCC3res {
+	nfsstat3 status;
+	wcc_data wcc;
+};
+
+/* RENAME */
+struct RENAME3res {
+	nfsstat3 status;
+	wcc_data fromdir_wcc;
+	wcc_data todir_wcc;
+};
+
+/* LINK */
+struct LINK3res {
+	nfsstat3 status;
+	post_op_attr file_attributes;
+	wcc_data linkdir_wcc;
+};
+
+/* READDIR */
+struct READDIR3args {
+	nfs_fh3 dir;
+	cookie3 cookie;
+	cookieverf3 cookieverf;
+	count3 count;
+};
+
+struct entry3 {
+	fileid3 fileid;
+	filename3 name;
+	cookie3 cookie;
+	entry3 *nextentry;
+};
+
+struct dirlist3 {
+	entry3 *entries;
+	bool eof;
+};
+
+struct READDIR3resok {
+	post_op_attr dir_attributes;
+	cookieverf3 cookieverf;
+	dirlist3 reply;
+};
+
+struct READDIR3resfail {
+	post_op_attr dir_attributes;
+};
+
+union READDIR3res switch (nfsstat3 status) {
+case NFS3_OK:
+	READDIR3resok resok;
+default:
+	READDIR3resfail resfail;
+};
+
+/* READDIRPLUS */
+struct READDIRPLUS3args {
+	nfs_fh3 dir;
+	cookie3 cookie;
+	cookieverf3 cookieverf;
+	count3 dircount;
+	count3 maxcount;
+};
+
+struct entryplus3 {
+	fileid3 fileid;
+	filename3 name;
+	cookie3 cookie;
+	post_op_attr name_attributes;
+	post_op_fh3 name_handle;
+	entryplus3 *nextentry;
+};
+
+struct dirlistplus3 {
+	entryplus3 *entries;
+	bool eof;
+};
+
+struct READDIRPLUS3resok {
+	post_op_attr dir_attributes;
+	cookieverf3 cookieverf;
+	dirlistplus3 reply;
+};
+
+struct READDIRPLUS3resfail {
+	post_op_attr dir_attributes;
+};
+
+union READDIRPLUS3res switch (nfsstat3 status) {
+case NFS3_OK:
+	READDIRPLUS3resok resok;
+default:
+	READDIRPLUS3resfail resfail;
+};
+
+/* FSSTAT */
+struct FSSTAT3resok {
+	post_op_attr obj_attributes;
+	size3 tbytes;
+	size3 fbytes;
+	size3 abytes;
+	size3 tfiles;
+	size3 ffiles;
+	size3 afiles;
+	uint32 invarsec;
+};
+
+struct FSSTAT3resfail {
+	post_op_attr obj_attributes;
+};
+
+union FSSTAT3res switch (nfsstat3 status) {
+case NFS3_OK:
+	FSSTAT3resok resok;
+default:
+	FSSTAT3resfail resfail;
+};
+
+/* FSINFO */
+const FSF3_LINK = 0x0001;
+const FSF3_SYMLINK = 0x0002;
+const FSF3_HOMOGENEOUS = 0x0008;
+const FSF3_CANSETTIME = 0x0010;
+
+struct FSINFO3resok {
+	post_op_attr obj_attributes;
+	uint32 rtmax;
+	uint32 rtpref;
+	uint32 rtmult;
+	uint32 wtmax;
+	uint32 wtpref;
+	uint32 wtmult;
+	uint32 dtpref;
+	size3 maxfilesize;
+	nfstime3 time_delta;
+	uint32 properties;
+};
+
+struct FSINFO3resfail {
+	post_op_attr obj_attributes;
+};
+
+union FSINFO3res switch (nfsstat3 status) {
+case NFS3_OK:
+	FSINFO3resok resok;
+default:
+	FSINFO3resfail resfail;
+};
+
+/* PATHCONF */
+struct PATHCONF3resok {
+	post_op_attr obj_attributes;
+	uint32 linkmax;
+	uint32 name_max;
+	bool no_trunc;
+	bool chown_restricted;
+	bool case_insensitive;
+	bool case_preserving;
+};
+
+struct PATHCONF3resfail {
+	post_op_attr obj_attributes;
+};
+
+union PATHCONF3res switch (nfsstat3 status) {
+case NFS3_OK:
+	PATHCONF3resok resok;
+default:
+	PATHCONF3resfail resfail;
+};
+
+program NFS3_PROGRAM {
+	version NFS_V3 {
+		void
+		NFSPROC3_NULL(void) = 0;
+
+		GETATTR3res
+		NFSPROC3_GETATTR(nfs_fh3) = 1;
+
+		WCC3res
+		NFSPROC3_SETATTR(void) = 2;
+
+		LOOKUP3res
+		NFSPROC3_LOOKUP(diropargs3) = 3;
+
+		ACCESS3res
+		NFSPROC3_ACCESS(ACCESS3args) = 4;
+
+		READLINK3res
+		NFSPROC3_READLINK(nfs_fh3) = 5;
+
+		READ3res
+		NFSPROC3_READ(READ3args) = 6;
+
+		WCC3res
+		NFSPROC3_WRITE(void) = 7;
+
+		WCC3res
+		NFSPROC3_CREATE(void) = 8;
+
+		WCC3res
+		NFSPROC3_MKDIR(void) = 9;
+
+		WCC3res
+		NFSPROC3_SYMLINK(void) = 10;
+
+		WCC3res
+		NFSPROC3_MKNOD(void) = 11;
+
+		WCC3res
+		NFSPROC3_REMOVE(void) = 12;
+
+		WCC3res
+		NFSPROC3_RMDIR(void) = 13;
+
+		RENAME3res
+		NFSPROC3_RENAME(void) = 14;
+
+		LINK3res
+		NFSPROC3_LINK(void) = 15;
+
+		READDIR3res
+		NFSPROC3_READDIR(READDIR3args) = 16;
+
+		READDIRPLUS3res
+		NFSPROC3_READDIRPLUS(READDIRPLUS3args) = 17;
+
+		FSSTAT3res
+		NFSPROC3_FSSTAT(nfs_fh3) = 18;
+
+		FSINFO3res
+		NFSPROC3_FSINFO(nfs_fh3) = 19;
+
+		PATHCONF3res
+		NFSPROC3_PATHCONF(nfs_fh3) = 20;
+
+		WCC3res
+		NFSPROC3_COMMIT(void) = 21;
+	} = 3;
+} = 100003;
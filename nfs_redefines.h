@@ -20,6 +20,29 @@
 #define nfsproc_rmdir_2_svc nfsproc_rmdir_2
 #define nfsproc_readdir_2_svc nfsproc_readdir_2
 #define nfsproc_statfs_2_svc nfsproc_statfs_2
+//#define nfs_program_3 
+#define nfsproc3_null_3_svc nfsproc3_null_3
+#define nfsproc3_getattr_3_svc nfsproc3_getattr_3
+#define nfsproc3_setattr_3_svc nfsproc3_setattr_3
+#define nfsproc3_lookup_3_svc nfsproc3_lookup_3
+#define nfsproc3_access_3_svc nfsproc3_access_3
+#define nfsproc3_readlink_3_svc nfsproc3_readlink_3
+#define nfsproc3_read_3_svc nfsproc3_read_3
+#define nfsproc3_write_3_svc nfsproc3_write_3
+#define nfsproc3_create_3_svc nfsproc3_create_3
+#define nfsproc3_mkdir_3_svc nfsproc3_mkdir_3
+#define nfsproc3_symlink_3_svc nfsproc3_symlink_3
+#define nfsproc3_mknod_3_svc nfsproc3_mknod_3
+#define nfsproc3_remove_3_svc nfsproc3_remove_3
+#define nfsproc3_rmdir_3_svc nfsproc3_rmdir_3
+#define nfsproc3_rename_3_svc nfsproc3_rename_3
+#define nfsproc3_link_3_svc nfsproc3_link_3
+#define nfsproc3_readdir_3_svc nfsproc3_readdir_3
+#define nfsproc3_readdirplus_3_svc nfsproc3_readdirplus_3
+#define nfsproc3_fsstat_3_svc nfsproc3_fsstat_3
+#define nfsproc3_fsinfo_3_svc nfsproc3_fsinfo_3
+#define nfsproc3_pathconf_3_svc nfsproc3_pathconf_3
+#define nfsproc3_commit_3_svc nfsproc3_commit_3
 //#define adm_program_2 
 #define admproc_null_2_svc admproc_null_2
 #define admproc_attach_2_svc admproc_attach_2
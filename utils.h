@@ -2,6 +2,7 @@
 #define _UTILS_H_ 1
 
 #include <stdarg.h>
+#include <unistd.h>
 #include "vcfs.h"
 
 
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/file.h>
 #include <sys/socket.h>
@@ -6,6 +7,7 @@
 #include <netdb.h>
 #include <rpc/rpc.h>
 #include <sys/time.h>
+#include <time.h>
 #include <signal.h>
 #include <termios.h>
 #include <unistd.h>
@@ -14,6 +16,7 @@
 #include "vcfs.h"
 #include "cvs_cmds.h"
 #include "cvstool.h"
+#include "vcfs_rpc.h"
 #include "utils.h"
 
 #ifndef CVS_PASSWORD_FILE 
@@ -27,9 +30,11 @@ void usage(char *msg);
    file (if it exists) */
 char* get_cvs_passwd_from_file(char *user, char *hostname);
 
+/* Our version of svc_run(), which also refreshes the tree */
+void vcfs_svc_run(int interval);
+
 struct in_addr validhost;
 
-void nfs_program_2();
 extern void cvstool_program_1(struct svc_req *rqstp, register SVCXPRT *transp);
 
 char *progname;
@@ -39,35 +44,51 @@ int main(int argc, char **argv)
     int port;
     struct hostent *hp;
     struct sockaddr_in sin;
-    int svrsock;
-    SVCXPRT *tp;
+    int svrsocks[VCFS_MAX_UDP_SOCKS];
+    int nsocks = 1;
+    int i;
+    int tcpsock;
+    int one = 1;
+    int rcvbuf = VCFS_RPC_RCVBUF;
     char *pword = NULL;
     register SVCXPRT *transp;
     char *module;
     char *root;
     char *hostname;
     char *user;
-    bool use_gzip = TRUE;
+    int gzip_level = CVS_GZIP_LEVEL;
+    int method = CVS_METHOD_PSERVER;
     char *tag = NULL;
     int opt;
     bool check_cvspass = TRUE;
+    int refresh = 0;
+    int workers = VCFS_DEFAULT_WORKERS;
 
     progname = argv[0];
     port = VCFS_PORT;
 
-    if (argc < 5) {
+    if (argc < 3) {
         usage(NULL);
         exit(1);
     }
     
     /* Get command options */
     opterr = 0;
-    while ((opt = getopt(argc, argv, "int:")) != -1)
+    while ((opt = getopt(argc, argv, "ilnr:t:u:w:z:")) != -1)
     {
         switch (opt)
         {
         case 'n':
-            use_gzip = FALSE;
+            gzip_level = 0;
+            break;
+
+        case 'z':
+            gzip_level = atoi(optarg);
+            if (gzip_level < 0 || gzip_level > 9)
+            {
+                usage("Invalid compression level.");
+                exit(1);
+            }
             break;
             
         case 't':
@@ -77,6 +98,37 @@ int main(int argc, char **argv)
         case 'i':
             check_cvspass = FALSE;
             break;
+
+        case 'l':
+            method = CVS_METHOD_RCS;
+            break;
+
+        case 'r':
+            refresh = atoi(optarg);
+            if (refresh <= 0)
+            {
+                usage("Invalid refresh interval.");
+                exit(1);
+            }
+            break;
+
+        case 'u':
+            nsocks = atoi(optarg);
+            if (nsocks <= 0 || nsocks > VCFS_MAX_UDP_SOCKS)
+            {
+                usage("Invalid number of UDP sockets.");
+                exit(1);
+            }
+            break;
+
+        case 'w':
+            workers = atoi(optarg);
+            if (workers <= 0 || workers > VCFS_MAX_WORKERS)
+            {
+                usage("Invalid number of worker threads.");
+                exit(1);
+            }
+            break;
             
         default:
             usage("Invalid option.");
@@ -85,19 +137,40 @@ int main(int argc, char **argv)
         
     }
     
-    /* Get the four required arguments */
-    if (optind + 4 > argc)
+    /* A :fork: (or :local:) root needs no host or user, we start a cvs
+     * server of our own
+     */
+    if (method == CVS_METHOD_PSERVER && optind < argc &&
+        (!strncmp(argv[optind], ":fork:", 6) ||
+         !strncmp(argv[optind], ":local:", 7)))
+    {
+        method = CVS_METHOD_FORK;
+    }
+    
+    /* Get the four required arguments, or just the repository and project
+     * if there is nobody to log in to
+     */
+    if (optind + (method == CVS_METHOD_PSERVER ? 4 : 2) > argc)
     {
         usage(NULL);
         exit(1);
     }
     
-    hostname = argv[optind++];
+    hostname = (method == CVS_METHOD_PSERVER) ? argv[optind++] : "localhost";
     root = argv[optind++];
     module = argv[optind++];
-    user = argv[optind];
+    user = (method == CVS_METHOD_PSERVER) ? argv[optind] : "";
     
-    if (check_cvspass)
+    if (method != CVS_METHOD_PSERVER)
+    {
+        /* Leave the method off the root */
+        if (root[0] == ':' && strchr(root + 1, ':') != NULL)
+        {
+            root = strchr(root + 1, ':') + 1;
+        }
+        pword = "";
+    }
+    else if (check_cvspass)
     {
         /* Try to get the cvs password from the .cvspass file */
         pword = get_cvs_passwd_from_file(user, hostname);
@@ -128,23 +201,53 @@ int main(int argc, char **argv)
 	validhost.s_addr = sin.sin_addr.s_addr;
 	sin.sin_port = htons(port);
     
-	if ((svrsock = socket(AF_INET,SOCK_DGRAM,0)) < 0) {
-        perror("error creating socket");
-        exit(1);
+	/* Each UDP socket gets its own dispatcher, and the kernel spreads
+	 * the clients between them */
+	for (i = 0; i < nsocks; i++) {
+	    if ((svrsocks[i] = socket(AF_INET,SOCK_DGRAM,0)) < 0) {
+            perror("error creating socket");
+            exit(1);
+	    }
+
+	    if (nsocks > 1 &&
+	        setsockopt(svrsocks[i], SOL_SOCKET, SO_REUSEPORT, &one,
+	                   sizeof(one)) != 0) {
+            perror("error sharing socket");
+            exit(1);
+	    }
+
+	    /* Room for a burst of calls while the dispatcher catches up */
+	    setsockopt(svrsocks[i], SOL_SOCKET, SO_RCVBUF, &rcvbuf,
+	               sizeof(rcvbuf));
+
+	    if (bind(svrsocks[i],(struct sockaddr *)&sin,sizeof(sin)) != 0) {
+            perror("error binding to socket");
+            exit(1);
+	    }
 	}
-    
-	if (bind(svrsock,(struct sockaddr *)&sin,sizeof(sin)) != 0) {
-        perror("error binding to socket");
+
+	/* NFS over TCP uses the same port */
+	if ((tcpsock = socket(AF_INET,SOCK_STREAM,0)) < 0) {
+        perror("error creating tcp socket");
         exit(1);
 	}
-    
-	if ((tp = svcudp_create(svrsock)) == NULL) {
-        fprintf(stderr,"Unable to create UDP RPC Service\n");
+
+	setsockopt(tcpsock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	if (bind(tcpsock,(struct sockaddr *)&sin,sizeof(sin)) != 0 ||
+	    listen(tcpsock, SOMAXCONN) != 0) {
+        perror("error binding to tcp socket");
         exit(1);
 	}
-	
-	/* register the service */
-    if (!svc_register(tp, NFS_PROGRAM, NFS_VERSION, nfs_program_2, IPPROTO_UDP)) {
+    
+	/* register the service. Requests on svrsocks and tcpsock are read
+	 * by vcfs_rpc.c, not by svc_run() */
+    pmap_unset(NFS_PROGRAM, NFS_VERSION);
+    pmap_unset(NFS_PROGRAM, NFS_V3);
+    if (!pmap_set(NFS_PROGRAM, NFS_VERSION, IPPROTO_UDP, port) ||
+        !pmap_set(NFS_PROGRAM, NFS_V3, IPPROTO_UDP, port) ||
+        !pmap_set(NFS_PROGRAM, NFS_VERSION, IPPROTO_TCP, port) ||
+        !pmap_set(NFS_PROGRAM, NFS_V3, IPPROTO_TCP, port)) {
 	    fprintf(stderr,"Unable to register vcfsd NFS server\n");
 	    exit(1);
 	}
@@ -175,10 +278,10 @@ int main(int argc, char **argv)
     GID = getgid();
     
     cvs_init_session(hostname, root, module, user, 
-                     pword, VCFS_ROOT, use_gzip, tag);
+                     pword, VCFS_ROOT, gzip_level, method, tag);
     
-    if (cvs_pserver_connect() < 0) {
-        fprintf(stderr, "Authentication on CVS server failed\n");
+    if (method != CVS_METHOD_RCS && cvs_connect() < 0) {
+        fprintf(stderr, "Could not connect to the CVS server\n");
         exit(1);
     }
     
@@ -189,11 +292,65 @@ int main(int argc, char **argv)
         exit(1);
     }
 
-    printf("CVS project %s successfully mounted\n", argv[3]);
-	svc_run();
+    printf("CVS project %s successfully mounted\n", module);
+    vcfs_index_start();
+    vcfs_rpc_start(svrsocks, nsocks, tcpsock, workers);
+	vcfs_svc_run(refresh);
     exit(1);
 }
 
+/* Wait for cvstool requests, just like svc_run(). If interval is non-zero,
+ * wake up every interval seconds and pick up any changes that have been
+ * made to the repository since the last time we looked.
+ */
+void vcfs_svc_run(int interval)
+{
+    fd_set readfds;
+    struct timeval tv;
+    time_t next_refresh;
+
+    next_refresh = time(NULL) + interval;
+
+    for (;;)
+    {
+        readfds = svc_fdset;
+        tv.tv_sec = next_refresh - time(NULL);
+        tv.tv_usec = 0;
+
+        if (tv.tv_sec < 0)
+        {
+            tv.tv_sec = 0;
+        }
+
+        switch (select(FD_SETSIZE, &readfds, NULL, NULL,
+                       interval > 0 ? &tv : NULL))
+        {
+        case -1:
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("vcfs_svc_run: select failed");
+            return;
+
+        case 0:
+            break;
+
+        default:
+            /* Requests see one version of the namespace */
+            vcfs_ns_enter();
+            svc_getreqset(&readfds);
+            vcfs_ns_exit();
+        }
+
+        if (interval > 0 && time(NULL) >= next_refresh)
+        {
+            vcfs_refresh();
+            next_refresh = time(NULL) + interval;
+        }
+    }
+}
+
 /* Returns the password for this pserver from the cvs password file
  * (if it exists), NULL otherwise
  */
@@ -323,10 +480,19 @@ void usage(char *msg)
         fprintf(stderr, "%s: %s\n", progname, msg);
     }
     
-    fprintf(stderr, "Usage: %s [OPTION] HOSTNAME CVSROOT PROJECT USERNAME\n\n",
+    fprintf(stderr, "Usage: %s [OPTION] HOSTNAME CVSROOT PROJECT USERNAME\n",
             progname);
-    fprintf(stderr, "-n\tDon't gzip file contents\n");
+    fprintf(stderr, "       %s [OPTION] :fork:CVSROOT PROJECT\n", progname);
+    fprintf(stderr, "       %s -l [OPTION] CVSROOT PROJECT\n\n", progname);
+    fprintf(stderr, "-n\tDon't compress what the server sends (the same as -z 0)\n");
     fprintf(stderr, "-t TAG\tLoad the version of the repository specified by TAG, which is either a branch or tag name\n");
     fprintf(stderr, "-i\tDon't look for password in .cvspass file\n");
+    fprintf(stderr, "-l\tRead the RCS files in CVSROOT directly, instead of using a pserver\n");
+    fprintf(stderr, "-r SECS\tCheck the repository for changes every SECS seconds\n");
+    fprintf(stderr, "-u NUM\tRead NFS requests from NUM UDP sockets (default 1)\n");
+    fprintf(stderr, "-w NUM\tUse NUM threads to serve NFS requests, at most %d (default %d)\n",
+            VCFS_MAX_WORKERS, VCFS_DEFAULT_WORKERS);
+    fprintf(stderr, "-z LEVEL\tCompress the connection to the server at LEVEL, 1-9 (default %d)\n",
+            CVS_GZIP_LEVEL);
 }
 
@@ -28,11 +28,17 @@ typedef char vcfs_path[NFS_MAXPATHLEN];
 typedef char vcfs_ver[VCFS_VER_LEN];
 typedef char vcfs_tag[VCFS_TAG_LEN];
 
-/* The filehandle we use to communciate with NFS */
+/* The filehandle we use to communciate with NFS. It fills a version 2
+ * handle. Handles of version extended names also say what they are a
+ * version of, so they can be made again if they have been dropped (see
+ * vcfs_ext.c); key is then the hash key of the base file.
+ */
 typedef struct vcfs_fhdata {
     unsigned int magic;
     int id;
     int key;
+    int base; /* The id of the file a version extended name is a version of */
+    vcfs_ver ver; /* and which revision of it */
 } vcfs_fhdata;
 
 /* Hash table entry for every file and directory */
@@ -41,6 +47,7 @@ typedef struct vcfs_fileid {
     int hash_key;
     vcfs_path name;
     int virtual;
+    unsigned long gen; /* Namespace generation this copy was made in */
     struct vcfs_fileid *next;
     struct vcfs_ventry *ventry; /* NULL if not a virtual file */
 } vcfs_fileid;
@@ -55,11 +62,26 @@ typedef struct vcfs_ventry {
     unsigned int mode;
     vcfs_ver ver;
     vcfs_tag tag;
-    unsigned int ctime;
-    struct vcfs_ventry *next; /* Next ventry in the current directory */
-    struct vcfs_ventry *dirent; /* A list of dir entries if this is a dir */
+    time_t mtime; /* When it, or anything in it, last changed */
+    unsigned long gen; /* Namespace generation this copy was made in */
+    struct vcfs_ventry **dirent; /* The dir entries if this is a dir */
+    int nents;
+    int maxents;
+    int nfree; /* Slots in dirent left empty by removed entries */
+    unsigned char *bloom; /* The names in a dir, maxents bytes of bloom filter */
+    int lazy; /* A view directory that hasn't been filled in yet */
 } vcfs_ventry;
 
+/* One version of the whole namespace. Once published, a namespace and
+ * everything reachable from it is never modified (see vcfs_ns.c).
+ */
+#define VCFS_HASH_SIZE 1024
+typedef struct vcfs_ns {
+    unsigned long gen;
+    vcfs_fileid *file_hash[VCFS_HASH_SIZE];
+    vcfs_ventry *root; /* Top directory of the project */
+} vcfs_ns;
+
 /* TODO: Move these */
 int UID, GID;
 
@@ -69,18 +91,138 @@ typedef union fh_ut {
 	struct vcfs_fhdata fh;
 } fh_ut;
 
-/* We want to ask the server for file contents as infrequently as possible.
- * Grab 512K of a file at a time. For bigger files, we have to ask the
- * server for the ENTIRE file for each 512K chunk we grab!
- * TBD: Is this really true? Make cache size bigger?
+/* A whole revision of a file, as fetched from the server. These are kept
+ * in a cache (see vcfs_cache.c), and are never changed once they are in it.
  */
-#define READ_CACHE_SIZE 512 * 1024
-typedef struct vcfs_read_cachent {
-    char data[READ_CACHE_SIZE];
-    int id;
-    int start;
+typedef struct vcfs_blob {
+    vcfs_path name;
+    vcfs_ver ver;
+    char *data;
     int size;
-} vcfs_read_cachent;
+    time_t mtime; /* When it was committed, 0 if the server didn't say */
+    int refs; /* Threads using this right now */
+    struct vcfs_blob *hnext; /* Hash chain */
+    struct vcfs_blob *prev; /* LRU list, most recently used first */
+    struct vcfs_blob *next;
+} vcfs_blob;
+
+/* One revision of a file, as "cvs log" describes it */
+typedef struct vcfs_rev {
+    vcfs_ver ver;
+    char *date; /* As the server wrote it */
+    time_t when;
+    char *author;
+    char *state;
+    char *branches; /* Branches that start here, separated by spaces */
+    char *msg;
+} vcfs_rev;
+
+/* A symbolic name, and the revision or branch it stands for */
+typedef struct vcfs_symname {
+    char *tag;
+    vcfs_ver ver;
+} vcfs_symname;
+
+/* The history of a file, as fetched from the server. These are kept in a
+ * cache (see vcfs_hist.c), and are never changed once they are in it.
+ */
+typedef struct vcfs_hist {
+    vcfs_path name;
+    vcfs_ver head;
+    vcfs_rev *revs; /* Newest first, the way the server lists them */
+    int nrevs;
+    vcfs_symname *tags;
+    int ntags;
+    int bytes; /* About how much memory all of this takes */
+    int refs; /* Threads using this right now */
+    int stale; /* Forgotten, but somebody is still using it */
+    struct vcfs_hist *hnext; /* Hash chain */
+    struct vcfs_hist *prev; /* LRU list, most recently used first */
+    struct vcfs_hist *next;
+} vcfs_hist;
+
+/* How much file history we try to keep around */
+#define VCFS_HIST_MAX (4 * 1024 * 1024)
+
+/* The revisions and symbolic names of every file in the module, read from
+ * one "rlog" when we start (see vcfs_index.c). It is kept as columns
+ * rather than a structure per revision: file i has the revisions
+ * file_rev[i] to file_rev[i] + file_nrevs[i] - 1 (newest first) and the
+ * tags file_tag[i] to file_tag[i] + file_ntags[i] - 1. Strings are
+ * offsets into strs, and author, state and tag names are only stored
+ * once. Nothing but file_stale is changed once it has been built.
+ */
+typedef struct vcfs_index {
+    int nfiles;
+    int *file_name;
+    int *file_rev;
+    int *file_nrevs;
+    int *file_tag;
+    int *file_ntags;
+    char *file_stale; /* Changed since the index was built */
+    int *file_next; /* Hash chain, -1 at the end */
+    int file_hash[VCFS_HASH_SIZE];
+
+    int nrevs;
+    vcfs_ver *rev_ver;
+    time_t *rev_when;
+    int *rev_date; /* As the server wrote it */
+    int *rev_author;
+    int *rev_state;
+
+    int ntags;
+    int *tag_name;
+    vcfs_ver *tag_ver;
+    int *tag_file;
+    int *tag_order; /* Every tag, sorted by name and then by file */
+
+    char *strs;
+    int str_len;
+
+    time_t built; /* When we asked for the rlog it was made from */
+} vcfs_index;
+
+/* How much file data we try to keep around */
+#define VCFS_CACHE_MAX (64 * 1024 * 1024)
+
+/* vcfs_read() returns this when the request has to wait for the file */
+#define VCFS_READ_DEFERRED -2
+
+/* How many bits of a directory's bloom filter each name sets */
+#define VCFS_BLOOM_HASHES 3
+
+/* How many missing version extended names we remember, and for how many
+ * seconds
+ */
+#define VCFS_NEG_SIZE 256
+#define VCFS_NEG_TIMEOUT 60
+
+/* The directory at the top of the project that other tags can be seen
+ * in, as .tags/TAG/... (see vcfs_view.c). It isn't listed by READDIR.
+ */
+#define VCFS_TAGS_DIR ".tags"
+
+/* The same for views of the trunk at other dates, as .at/DATE/... */
+#define VCFS_AT_DIR ".at"
+
+/* How many version extended names (foo.c,1.3) are kept at once. Their ids
+ * are VCFS_EXT_ID and up, out of the way of the vinodes.
+ */
+#define VCFS_EXT_MAX 1024
+#define VCFS_EXT_ID 0x40000000
+
+/* Where a READDIR has got to in a directory. The position is the cookie
+ * the client is given: 0 is the start, 1 and 2 come after "." and "..",
+ * and 3 + i comes after the directory's entry i. Entries never move in a
+ * directory (see remove_ventry()), so a cookie still means the same place
+ * after the directory has changed.
+ */
+typedef struct vcfs_dir_cursor {
+    vcfs_fileid *dir;
+    unsigned long pos;
+} vcfs_dir_cursor;
+
+struct vcfs_req;
 
 
 /* Function declarations */
@@ -96,7 +238,85 @@ vcfs_ventry *create_ventry(vcfs_path name, int size, ftype type,
 			    unsigned int mode, char *ver, time_t t, char *tag);
 vcfs_fileid *lookuph(vcfs_fileid *d, char *name, vcfs_fhdata *fh);
 vcfs_fileid *lookup_fh_name(vcfs_path name);
-int vcfs_read(char *buff, vcfs_fhdata *fh, int count, int offset);
+int vcfs_read(vcfs_fhdata *fh, int count, int offset, struct svc_req *rp,
+              vcfs_ventry *attr);
+void vcfs_fix_attrs(char *name, char *ver, int size, time_t mtime);
+int vcfs_resolve_version(vcfs_ventry *v, char *sym, vcfs_ver ver);
+void remove_fh(vcfs_fileid *f);
+void remove_ventry(vcfs_ventry *v);
+void free_vinode(int id);
+void vcfs_dir_seek(vcfs_dir_cursor *c, vcfs_fileid *dir, unsigned long cookie);
+int vcfs_dir_next(vcfs_dir_cursor *c, char **name, int *fileid,
+                  vcfs_ventry **v);
+int vcfs_bloom_test(vcfs_ventry *d, char *name);
+
+/* Versioned namespace (vcfs_ns.c) */
+#define VCFS_NS_MAX_READERS 64 /* The most threads that can read it */
+vcfs_ns *vcfs_ns_enter();
+void vcfs_ns_exit();
+vcfs_ns *vcfs_ns_get();
+vcfs_ns *vcfs_ns_begin();
+void vcfs_ns_commit();
+vcfs_ventry *vcfs_ns_edit(char *name);
+vcfs_fileid *vcfs_ns_edit_fh(vcfs_fileid *f);
+void vcfs_ns_set_root(vcfs_ventry *v);
+vcfs_ventry *vcfs_ns_root();
+void vcfs_ns_retire(void *p);
+
+/* File contents (vcfs_cache.c) */
+vcfs_blob *vcfs_cache_get(char *name, char *ver);
+vcfs_blob *vcfs_cache_put(char *name, char *ver, char *data, int size,
+                          time_t mtime);
+void vcfs_cache_release(vcfs_blob *b);
+vcfs_blob *vcfs_cache_fetch(char *name, char *ver);
+void vcfs_cache_fix(char *name, vcfs_blob *b);
+int vcfs_cache_fetch_async(char *name, char *ver, struct vcfs_req *req,
+                           vcfs_blob **b);
+
+/* File histories (vcfs_hist.c) */
+vcfs_hist *vcfs_hist_get(char *name);
+void vcfs_hist_release(vcfs_hist *h);
+vcfs_rev *vcfs_hist_find(vcfs_hist *h, char *ver);
+void vcfs_hist_free(vcfs_hist *h);
+void vcfs_hist_forget(char *name);
+
+/* Module-wide revision index (vcfs_index.c) */
+void vcfs_index_start();
+vcfs_index *vcfs_index_get();
+int vcfs_index_file(vcfs_index *x, char *name);
+int vcfs_index_find(vcfs_index *x, int file, char *ver);
+int vcfs_index_tag(vcfs_index *x, int file, char *tag);
+int vcfs_index_tagged(vcfs_index *x, char *tag, int *first);
+int vcfs_index_rev(vcfs_index *x, int file, char *sym);
+int vcfs_index_at(vcfs_index *x, int file, time_t when);
+vcfs_index *vcfs_index_read(char *path);
+vcfs_index *vcfs_index_hist(vcfs_hist *h);
+void vcfs_index_free(vcfs_index *x);
+void vcfs_index_forget(char *name);
+
+/* Views of other tags and dates (vcfs_view.c) */
+int vcfs_view_real(char *name, vcfs_path real);
+vcfs_fileid *vcfs_view_lookup(vcfs_fileid *d, char *name);
+vcfs_fileid *vcfs_view_fill(vcfs_fileid *d);
+int vcfs_view_date(char *name, time_t *when);
+
+/* Version extended names (vcfs_ext.c) */
+vcfs_fileid *vcfs_ext_get(vcfs_fileid *base, char *ver, int id);
+vcfs_fileid *vcfs_ext_handle(vcfs_fhdata *fh);
+void vcfs_ext_fix(char *name, char *ver, int size, time_t mtime);
+
+/* Names that don't exist (vcfs_neg.c) */
+int vcfs_neg_check(char *name);
+void vcfs_neg_add(char *name);
+void vcfs_neg_clear();
+
+/* NFS attributes (vcfs_nfs.c) */
+int get_vattr(vcfs_ventry *v, fattr *f);
+void rootgetattr(struct fattr *f);
+
+/* Dynamic refresh (vcfs_refresh.c) */
+void vcfs_refresh_set_sync(time_t t);
+int vcfs_refresh();
 
     
 #endif
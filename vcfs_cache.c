@@ -0,0 +1,610 @@
+/****************************************************************************
+ * File: vcfs_cache.c
+ * A cache of file contents. Files are fetched from the server whole, and
+ * kept by name and revision. The contents of a revision never change, so a
+ * cached file never has to be thrown away because it is out of date, and
+ * any number of threads can read it at once. Each thread holds a reference
+ * while it is using a file; when the cache gets too big, the least
+ * recently used files that nobody is using are freed.
+ *
+ * NFS requests for a file that isn't here don't wait for it. The request is
+ * put aside on a list of requests waiting for that file, and a fetcher
+ * thread gets it from the server. When it arrives, everything that was
+ * waiting is run again. Requests for the same file share one fetch.
+ *
+ * Files are often given a size before anyone has fetched them, which is
+ * only a guess. Reading one finds out the truth, but the namespace can't
+ * be changed under the readers looking at it, so the fetcher thread puts
+ * it right in a transaction of its own whenever it has nothing to fetch.
+ ***************************************************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "vcfs.h"
+#include "vcfs_rpc.h"
+#include "cvs_cmds.h"
+#include "utils.h"
+
+/* A file we are getting from the server, and the requests waiting for it */
+typedef struct cache_fetch {
+    vcfs_path name;
+    vcfs_ver ver;
+    vcfs_req *waiters;
+    struct cache_fetch *next;
+} cache_fetch;
+
+/* A file in the namespace that has the wrong size or mtime */
+typedef struct cache_fix {
+    vcfs_path name;
+    vcfs_ver ver;
+    int size;
+    time_t mtime;
+    struct cache_fix *next;
+} cache_fix;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Everything below is protected by cache_lock */
+static vcfs_blob *cache_hash[VCFS_HASH_SIZE];
+static vcfs_blob *cache_head = NULL; /* Most recently used */
+static vcfs_blob *cache_tail = NULL; /* Least recently used */
+static long cache_bytes = 0;
+
+/* Files to fetch, oldest first. The one being fetched stays at the head
+ * until it arrives, so more requests can wait for it.
+ */
+static cache_fetch *fetch_head = NULL;
+static cache_fetch **fetch_tail = &fetch_head;
+static pthread_cond_t fetch_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t fetch_once = PTHREAD_ONCE_INIT;
+
+/* Files to put right */
+static cache_fix *fix_head = NULL;
+
+/* Find a file in the hash table */
+static vcfs_blob *cache_find(char *name, char *ver)
+{
+    vcfs_blob *b;
+
+    for (b = cache_hash[hash(name)]; b != NULL; b = b->hnext)
+    {
+        if (!strcmp(b->name, name) && !strcmp(b->ver, ver))
+        {
+            return b;
+        }
+    }
+
+    return NULL;
+}
+
+/* Take a file off the LRU list */
+static void cache_unlink(vcfs_blob *b)
+{
+    if (b->prev != NULL)
+    {
+        b->prev->next = b->next;
+    }
+    else
+    {
+        cache_head = b->next;
+    }
+
+    if (b->next != NULL)
+    {
+        b->next->prev = b->prev;
+    }
+    else
+    {
+        cache_tail = b->prev;
+    }
+}
+
+/* Put a file at the front of the LRU list */
+static void cache_push(vcfs_blob *b)
+{
+    b->prev = NULL;
+    b->next = cache_head;
+
+    if (cache_head != NULL)
+    {
+        cache_head->prev = b;
+    }
+    else
+    {
+        cache_tail = b;
+    }
+    cache_head = b;
+}
+
+/* Free files nobody is using until the cache is small enough */
+static void cache_evict()
+{
+    vcfs_blob *b;
+    vcfs_blob *prev;
+    vcfs_blob **p;
+
+    for (b = cache_tail; b != NULL && cache_bytes > VCFS_CACHE_MAX; b = prev)
+    {
+        prev = b->prev;
+
+        if (b->refs > 0)
+        {
+            continue;
+        }
+
+        for (p = &cache_hash[hash(b->name)]; *p != b; p = &(*p)->hnext)
+            ;
+        *p = b->hnext;
+
+        cache_unlink(b);
+        cache_bytes -= b->size;
+
+        DEBUG(DEBUG_H, "[vcfs_cache] evicted %s,%s", b->name, b->ver);
+        free(b->data);
+        free(b);
+    }
+}
+
+/* Look for a revision of a file in the cache. Returns it with a reference
+ * held, or NULL if it isn't there.
+ */
+vcfs_blob *vcfs_cache_get(char *name, char *ver)
+{
+    vcfs_blob *b;
+
+    pthread_mutex_lock(&cache_lock);
+
+    b = cache_find(name, ver);
+    if (b != NULL)
+    {
+        b->refs++;
+        cache_unlink(b);
+        cache_push(b);
+    }
+
+    pthread_mutex_unlock(&cache_lock);
+
+    return b;
+}
+
+/* Add a revision of a file to the hash table and LRU list, unless it is
+ * already there. Must be called with cache_lock held.
+ */
+static vcfs_blob *cache_insert(char *name, char *ver, char *data, int size,
+                               time_t mtime)
+{
+    vcfs_blob *b;
+    int h;
+
+    b = cache_find(name, ver);
+    if (b != NULL)
+    {
+        free(data);
+        b->refs++;
+        cache_unlink(b);
+        cache_push(b);
+    }
+    else
+    {
+        b = (vcfs_blob *)malloc(sizeof(vcfs_blob));
+        strncpy(b->name, name, sizeof(b->name));
+        strncpy(b->ver, ver, sizeof(b->ver));
+        b->data = data;
+        b->size = size;
+        b->mtime = mtime;
+        b->refs = 1;
+
+        h = hash(name);
+        b->hnext = cache_hash[h];
+        cache_hash[h] = b;
+        cache_push(b);
+        cache_bytes += size;
+
+        cache_evict();
+    }
+
+    return b;
+}
+
+/* Add a revision of a file to the cache. The cache takes over the (malloc'ed)
+ * data. If somebody else already added the same revision, theirs is used and
+ * ours is freed. Returns the cached file with a reference held.
+ */
+vcfs_blob *vcfs_cache_put(char *name, char *ver, char *data, int size,
+                          time_t mtime)
+{
+    vcfs_blob *b;
+
+    pthread_mutex_lock(&cache_lock);
+    b = cache_insert(name, ver, data, size, mtime);
+    pthread_mutex_unlock(&cache_lock);
+
+    return b;
+}
+
+/* Done with a cached file */
+void vcfs_cache_release(vcfs_blob *b)
+{
+    pthread_mutex_lock(&cache_lock);
+
+    ASSERT(b->refs > 0, "Releasing a file nobody is using");
+    b->refs--;
+
+    if (b->refs == 0 && cache_bytes > VCFS_CACHE_MAX)
+    {
+        cache_evict();
+    }
+
+    pthread_mutex_unlock(&cache_lock);
+}
+
+/* How far apart two revisions are: 0 for the same revision, 1 for the
+ * next one along the same branch, and so on. Revisions on different
+ * branches are further apart than any two on the same one.
+ */
+static int cache_distance(char *a, char *b)
+{
+    char *dot_a = strrchr(a, '.');
+    char *dot_b = strrchr(b, '.');
+    int d;
+
+    if (dot_a == NULL || dot_b == NULL || dot_a - a != dot_b - b ||
+        strncmp(a, b, dot_a - a))
+    {
+        return 1000000;
+    }
+
+    d = atoi(dot_a + 1) - atoi(dot_b + 1);
+    return (d < 0) ? -d : d;
+}
+
+/* Find the cached revision of a file closest to ver, to fetch the
+ * difference from instead of the whole file. Returns it with a reference
+ * held, or NULL if there isn't one.
+ */
+static vcfs_blob *cache_neighbour(char *name, char *ver)
+{
+    vcfs_blob *b;
+    vcfs_blob *best = NULL;
+    int best_d = 0;
+    int d;
+
+    pthread_mutex_lock(&cache_lock);
+
+    for (b = cache_hash[hash(name)]; b != NULL; b = b->hnext)
+    {
+        if (strcmp(b->name, name) || !strcmp(b->ver, ver))
+        {
+            continue;
+        }
+
+        d = cache_distance(b->ver, ver);
+        if (best == NULL || d < best_d)
+        {
+            best = b;
+            best_d = d;
+        }
+    }
+
+    if (best != NULL)
+    {
+        best->refs++;
+    }
+
+    pthread_mutex_unlock(&cache_lock);
+
+    return best;
+}
+
+/* Get a revision of a file from the server. If we have another revision of
+ * it, only the difference is fetched. Returns its size, with the
+ * (malloc'ed) contents in *data and its commit time in *mtime, or -1 if we
+ * couldn't get it.
+ */
+static int cache_read_server(char *name, char *ver, char **data,
+                             time_t *mtime)
+{
+    cvs_buff *resp;
+    vcfs_blob *have;
+    int size = -1;
+
+    vcfs_rpc_flush();
+
+    have = cache_neighbour(name, ver);
+    if (have != NULL)
+    {
+        cvs_get_file(name, ver, have->ver, &resp);
+        if (resp != NULL)
+        {
+            size = cvs_read_file(resp, data, mtime, have->data, have->size);
+            cvs_free_buff(resp);
+        }
+
+        if (size >= 0)
+        {
+            DEBUG(DEBUG_M, "[vcfs_cache] fetched %s,%s from %s",
+                  name, ver, have->ver);
+        }
+        vcfs_cache_release(have);
+    }
+
+    if (size >= 0)
+    {
+        return size;
+    }
+
+    cvs_get_file(name, ver, NULL, &resp);
+    if (resp == NULL)
+    {
+        return -1;
+    }
+
+    size = cvs_read_file(resp, data, mtime, NULL, 0);
+    cvs_free_buff(resp);
+
+    if (size < 0)
+    {
+        fprintf(stderr, "vcfs_cache: Could not get %s,%s from server\n",
+                name, ver);
+        return -1;
+    }
+
+    DEBUG(DEBUG_M, "[vcfs_cache] fetched %s,%s (%d bytes)", name, ver, size);
+
+    return size;
+}
+
+/* Get a revision of a file, from the cache if it's there and from the
+ * server if it isn't. Returns it with a reference held, or NULL if the
+ * server couldn't give it to us.
+ */
+vcfs_blob *vcfs_cache_fetch(char *name, char *ver)
+{
+    vcfs_blob *b;
+    char *data;
+    int size;
+    time_t mtime;
+
+    b = vcfs_cache_get(name, ver);
+    if (b != NULL)
+    {
+        return b;
+    }
+
+    size = cache_read_server(name, ver, &data, &mtime);
+    if (size < 0)
+    {
+        return NULL;
+    }
+
+    return vcfs_cache_put(name, ver, data, size, mtime);
+}
+
+/* Put right the files on a list, all in one change to the namespace */
+static void cache_apply_fixes(cache_fix *fix)
+{
+    cache_fix *next;
+
+    vcfs_ns_begin();
+
+    for (; fix != NULL; fix = next)
+    {
+        next = fix->next;
+        vcfs_fix_attrs(fix->name, fix->ver, fix->size, fix->mtime);
+        free(fix);
+    }
+
+    vcfs_ns_commit();
+}
+
+/* Fetch files for requests that are waiting on them */
+static void *cache_fetcher(void *arg)
+{
+    cache_fetch *f;
+    cache_fix *fix;
+    vcfs_blob *b;
+    vcfs_req *req;
+    vcfs_req *next;
+    char *data;
+    int size;
+    time_t mtime;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&cache_lock);
+        while (fetch_head == NULL && fix_head == NULL)
+        {
+            pthread_cond_wait(&fetch_cond, &cache_lock);
+        }
+
+        /* Requests waiting for files come first */
+        if (fetch_head == NULL)
+        {
+            fix = fix_head;
+            fix_head = NULL;
+            pthread_mutex_unlock(&cache_lock);
+
+            cache_apply_fixes(fix);
+            continue;
+        }
+
+        f = fetch_head;
+        pthread_mutex_unlock(&cache_lock);
+
+        size = cache_read_server(f->name, f->ver, &data, &mtime);
+
+        pthread_mutex_lock(&cache_lock);
+
+        b = NULL;
+        if (size >= 0)
+        {
+            b = cache_insert(f->name, f->ver, data, size, mtime);
+        }
+
+        /* Nobody else can join the wait once it's off the list */
+        fetch_head = f->next;
+        if (fetch_head == NULL)
+        {
+            fetch_tail = &fetch_head;
+        }
+
+        /* Give each waiting request a reference of its own, so the file
+         * can't be evicted before it gets to run.
+         */
+        for (req = f->waiters; req != NULL; req = req->next)
+        {
+            req->blob = b;
+            if (b != NULL)
+            {
+                b->refs++;
+            }
+        }
+        if (b != NULL)
+        {
+            b->refs--;
+        }
+
+        pthread_mutex_unlock(&cache_lock);
+
+        for (req = f->waiters; req != NULL; req = next)
+        {
+            next = req->next;
+            vcfs_rpc_resume(req);
+        }
+
+        free(f);
+    }
+
+    return NULL;
+}
+
+/* Start the fetcher thread */
+static void cache_start_fetcher()
+{
+    pthread_t tid;
+
+    if (pthread_create(&tid, NULL, cache_fetcher, NULL) != 0)
+    {
+        perror("vcfs_cache: Could not start fetcher");
+        exit(1);
+    }
+    pthread_detach(tid);
+}
+
+/* Note that a file in the namespace has the wrong size or mtime for the
+ * revision it is, which has been fetched. The fetcher thread puts it right
+ * soon.
+ */
+void vcfs_cache_fix(char *name, vcfs_blob *b)
+{
+    cache_fix *fix;
+
+    pthread_once(&fetch_once, cache_start_fetcher);
+
+    pthread_mutex_lock(&cache_lock);
+
+    for (fix = fix_head; fix != NULL; fix = fix->next)
+    {
+        if (!strcmp(fix->name, name))
+        {
+            break;
+        }
+    }
+
+    if (fix == NULL)
+    {
+        fix = (cache_fix *)malloc(sizeof(cache_fix));
+        strncpy(fix->name, name, sizeof(fix->name));
+        fix->next = fix_head;
+        fix_head = fix;
+        pthread_cond_signal(&fetch_cond);
+    }
+
+    strncpy(fix->ver, b->ver, sizeof(fix->ver));
+    fix->size = b->size;
+    fix->mtime = b->mtime;
+
+    pthread_mutex_unlock(&cache_lock);
+}
+
+/* Get a revision of a file for an NFS request without holding up the
+ * thread running it. Returns 1 and the file (with a reference held) in *b
+ * if it's in the cache. Otherwise the request is put aside to be run again
+ * once the file has been fetched, and we return 0; the caller must give up
+ * the request without touching it again. Returns -1 if the request has
+ * already waited, and the file couldn't be fetched.
+ */
+int vcfs_cache_fetch_async(char *name, char *ver, vcfs_req *req,
+                           vcfs_blob **b)
+{
+    cache_fetch *f;
+
+    if (req->waited)
+    {
+        /* We've been run again, the fetcher left us the file */
+        *b = req->blob;
+        req->blob = NULL;
+        req->waited = 0;
+
+        if (*b != NULL && !strcmp((*b)->name, name) && !strcmp((*b)->ver, ver))
+        {
+            return 1;
+        }
+        if (*b != NULL)
+        {
+            /* The file changed revision while we were waiting */
+            vcfs_cache_release(*b);
+        }
+        else
+        {
+            return -1;
+        }
+    }
+
+    pthread_once(&fetch_once, cache_start_fetcher);
+
+    pthread_mutex_lock(&cache_lock);
+
+    *b = cache_find(name, ver);
+    if (*b != NULL)
+    {
+        (*b)->refs++;
+        cache_unlink(*b);
+        cache_push(*b);
+        pthread_mutex_unlock(&cache_lock);
+        return 1;
+    }
+
+    /* Wait with anybody else who wants this file */
+    for (f = fetch_head; f != NULL; f = f->next)
+    {
+        if (!strcmp(f->name, name) && !strcmp(f->ver, ver))
+        {
+            break;
+        }
+    }
+
+    if (f == NULL)
+    {
+        f = (cache_fetch *)malloc(sizeof(cache_fetch));
+        strncpy(f->name, name, sizeof(f->name));
+        strncpy(f->ver, ver, sizeof(f->ver));
+        f->waiters = NULL;
+        f->next = NULL;
+
+        *fetch_tail = f;
+        fetch_tail = &f->next;
+        pthread_cond_signal(&fetch_cond);
+    }
+
+    req->next = f->waiters;
+    f->waiters = req;
+
+    pthread_mutex_unlock(&cache_lock);
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+/****************************************************************************
+ * File: vcfs_drc.c
+ * The duplicate request cache. An NFS client using UDP sends a call again
+ * if it doesn't hear back soon enough, and a READ that has to wait on the
+ * CVS server takes a lot longer than that. Without this, every copy would
+ * be run from scratch, piling more work on the server just when it is
+ * slow.
+ *
+ * Calls are remembered by client address, XID, version and procedure. A
+ * copy of a call that is still being worked on is dropped; a copy of one
+ * that was answered recently gets the same answer again, without being
+ * run. Calls over TCP don't need any of this.
+ ***************************************************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vcfs_rpc.h"
+#include "utils.h"
+
+#define DRC_IN_PROGRESS 1
+#define DRC_DONE 2
+
+/* One call we have seen */
+typedef struct drc_entry {
+    struct sockaddr_in addr;
+    u_long xid;
+    u_long vers;
+    u_long proc;
+    int state; /* 0 if the slot is free */
+    time_t when; /* When it was answered */
+    char *reply;
+    int len;
+    struct drc_entry *hnext;
+} drc_entry;
+
+static pthread_mutex_t drc_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Everything below is protected by drc_lock. Slots are reused in turn,
+ * skipping calls that are still being worked on.
+ */
+static drc_entry drc_slots[VCFS_DRC_SIZE];
+static drc_entry *drc_hash[VCFS_DRC_SIZE];
+static int drc_next = 0;
+
+static int drc_bucket(u_long xid)
+{
+    return xid % VCFS_DRC_SIZE;
+}
+
+/* Is this entry for the same call as the request? */
+static int drc_match(drc_entry *e, vcfs_req *req)
+{
+    return e->xid == req->xid &&
+        e->vers == req->svc.rq_vers &&
+        e->proc == req->svc.rq_proc &&
+        e->addr.sin_addr.s_addr == req->addr.sin_addr.s_addr &&
+        e->addr.sin_port == req->addr.sin_port;
+}
+
+static drc_entry *drc_find(vcfs_req *req)
+{
+    drc_entry *e;
+
+    for (e = drc_hash[drc_bucket(req->xid)]; e != NULL; e = e->hnext)
+    {
+        if (drc_match(e, req))
+        {
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+/* Empty a slot */
+static void drc_remove(drc_entry *e)
+{
+    drc_entry **p;
+
+    for (p = &drc_hash[drc_bucket(e->xid)]; *p != e; p = &(*p)->hnext)
+        ;
+    *p = e->hnext;
+
+    free(e->reply);
+    e->reply = NULL;
+    e->state = 0;
+}
+
+/* Find a slot for a new call. Returns NULL if every slot is busy */
+static drc_entry *drc_alloc()
+{
+    drc_entry *e;
+    int i;
+
+    for (i = 0; i < VCFS_DRC_SIZE; i++)
+    {
+        e = &drc_slots[drc_next];
+        drc_next = (drc_next + 1) % VCFS_DRC_SIZE;
+
+        if (e->state == DRC_IN_PROGRESS)
+        {
+            continue;
+        }
+
+        if (e->state == DRC_DONE)
+        {
+            drc_remove(e);
+        }
+
+        return e;
+    }
+
+    return NULL;
+}
+
+/* Check a call that has just come in over UDP. Returns VCFS_DRC_NEW if it
+ * should be run, VCFS_DRC_IN_PROGRESS if it is a copy of one we're still
+ * working on, and VCFS_DRC_DONE if we have already answered it; then the
+ * answer is copied to the request's buffer (req->len bytes) to be sent
+ * again.
+ */
+int vcfs_drc_check(vcfs_req *req)
+{
+    drc_entry *e;
+    int ret;
+    int h;
+
+    pthread_mutex_lock(&drc_lock);
+
+    e = drc_find(req);
+
+    if (e != NULL && e->state == DRC_DONE &&
+        time(NULL) - e->when > VCFS_DRC_TIMEOUT)
+    {
+        /* Too old to be a resend, the client must be reusing XIDs */
+        drc_remove(e);
+        e = NULL;
+    }
+
+    if (e != NULL)
+    {
+        ret = VCFS_DRC_IN_PROGRESS;
+        if (e->state == DRC_DONE)
+        {
+            memcpy(req->buf, e->reply, e->len);
+            req->len = e->len;
+            ret = VCFS_DRC_DONE;
+        }
+
+        DEBUG(DEBUG_M, "[vcfs_drc_check] duplicate of xid %lu (%s)",
+              req->xid, ret == VCFS_DRC_DONE ? "answered" : "in progress");
+
+        pthread_mutex_unlock(&drc_lock);
+        return ret;
+    }
+
+    e = drc_alloc();
+
+    if (e != NULL)
+    {
+        e->addr = req->addr;
+        e->xid = req->xid;
+        e->vers = req->svc.rq_vers;
+        e->proc = req->svc.rq_proc;
+        e->state = DRC_IN_PROGRESS;
+
+        h = drc_bucket(e->xid);
+        e->hnext = drc_hash[h];
+        drc_hash[h] = e;
+    }
+
+    pthread_mutex_unlock(&drc_lock);
+    return VCFS_DRC_NEW;
+}
+
+/* Remember the answer to a call that came in over UDP. The reply is the
+ * first req->len bytes of the request's buffer. Successful READs are
+ * forgotten instead, see below.
+ */
+void vcfs_drc_done(vcfs_req *req)
+{
+    drc_entry *e;
+
+    pthread_mutex_lock(&drc_lock);
+
+    e = drc_find(req);
+
+    if (e != NULL && (req->len <= 0 || req->read_len > 0))
+    {
+        /* No reply went out, so there's nothing to send again. The data
+         * of a READ isn't in the buffer; it's cheap enough to just read
+         * it from the cache again.
+         */
+        drc_remove(e);
+    }
+    else if (e != NULL && e->state == DRC_IN_PROGRESS)
+    {
+        e->reply = (char *)malloc(req->len);
+        memcpy(e->reply, req->buf, req->len);
+        e->len = req->len;
+        e->when = time(NULL);
+        e->state = DRC_DONE;
+    }
+
+    pthread_mutex_unlock(&drc_lock);
+}
@@ -0,0 +1,319 @@
+/****************************************************************************
+ * File: vcfs_ext.c
+ * The files behind version extended names (foo.c,1.3). Build tools and
+ * code review scripts look up thousands of these, so instead of staying in
+ * the namespace forever they are kept here, VCFS_EXT_MAX at most, and the
+ * least recently used one is dropped to make room for a new one.
+ *
+ * Each slot has an id of its own, VCFS_EXT_ID + the slot, which whatever is
+ * in the slot uses. Their filehandles also say which file they are a
+ * version of and which revision, so a handle to one that has been dropped
+ * (or whose slot now holds something else) just makes it again, in the
+ * same slot so that it keeps its id.
+ *
+ * They are all kept under the numeric revision, whatever name they were
+ * looked up by, so foo.c,REL_2 and foo.c,1.7 are the same file. Nothing
+ * here is changed in place: entries are replaced, and dropped ones freed,
+ * within a namespace transaction, so that readers can go on using the
+ * copy they found until they are done with it (see vcfs_ns.c).
+ ***************************************************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vcfs.h"
+#include "utils.h"
+
+/* One slot */
+typedef struct ext_entry {
+    vcfs_fileid *f; /* NULL if the slot is free */
+    int base; /* The id of the file it is a version of */
+    struct ext_entry *hnext; /* Hash chain */
+    struct ext_entry *prev; /* LRU list, most recently used first */
+    struct ext_entry *next;
+} ext_entry;
+
+static pthread_mutex_t ext_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Everything below is protected by ext_lock */
+static ext_entry ext_slots[VCFS_EXT_MAX];
+static ext_entry *ext_hash[VCFS_HASH_SIZE];
+static ext_entry *ext_head = NULL;
+static ext_entry *ext_tail = NULL;
+static int ext_used = 0;
+static int ext_cursor = 0; /* Where to start looking for a free slot */
+
+/* Find an entry by name */
+static ext_entry *ext_find(char *name)
+{
+    ext_entry *e;
+
+    for (e = ext_hash[hash(name)]; e != NULL; e = e->hnext)
+    {
+        if (!strcmp(e->f->name, name))
+        {
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+/* Take an entry off the LRU list */
+static void ext_unlink(ext_entry *e)
+{
+    if (e->prev != NULL)
+    {
+        e->prev->next = e->next;
+    }
+    else
+    {
+        ext_head = e->next;
+    }
+
+    if (e->next != NULL)
+    {
+        e->next->prev = e->prev;
+    }
+    else
+    {
+        ext_tail = e->prev;
+    }
+}
+
+/* Put an entry at the front of the LRU list */
+static void ext_push(ext_entry *e)
+{
+    e->prev = NULL;
+    e->next = ext_head;
+
+    if (ext_head != NULL)
+    {
+        ext_head->prev = e;
+    }
+    else
+    {
+        ext_tail = e;
+    }
+    ext_head = e;
+}
+
+/* Empty a slot. Must be called from within a transaction. */
+static void ext_drop(ext_entry *e)
+{
+    ext_entry **p;
+
+    for (p = &ext_hash[e->f->hash_key]; *p != e; p = &(*p)->hnext)
+        ;
+    *p = e->hnext;
+
+    ext_unlink(e);
+    ext_used--;
+
+    DEBUG(DEBUG_M, "[vcfs_ext] dropped %s", e->f->name);
+
+    vcfs_ns_retire(e->f->ventry);
+    vcfs_ns_retire(e->f);
+    e->f = NULL;
+}
+
+/* Pick the slot for a new entry: the one asked for, or a free one, or the
+ * least recently used one. Whatever is in it is dropped.
+ */
+static ext_entry *ext_slot(int id)
+{
+    ext_entry *e;
+    int i;
+
+    if (id >= VCFS_EXT_ID && id < VCFS_EXT_ID + VCFS_EXT_MAX)
+    {
+        e = &ext_slots[id - VCFS_EXT_ID];
+    }
+    else if (ext_used < VCFS_EXT_MAX)
+    {
+        for (i = ext_cursor; ext_slots[i].f != NULL;
+             i = (i + 1) % VCFS_EXT_MAX)
+            ;
+        ext_cursor = (i + 1) % VCFS_EXT_MAX;
+        e = &ext_slots[i];
+    }
+    else
+    {
+        e = ext_tail;
+    }
+
+    if (e->f != NULL)
+    {
+        ext_drop(e);
+    }
+
+    return e;
+}
+
+/* Make the fileid and ventry for a version of a file */
+static vcfs_fileid *ext_make(char *name, int id, char *ver, int size,
+                             time_t mtime)
+{
+    vcfs_fileid *f;
+    vcfs_ventry *v;
+
+    v = (vcfs_ventry *)calloc(1, sizeof(vcfs_ventry));
+    strcpy(v->name, name);
+    v->id = id;
+    v->size = size;
+    v->type = NFREG;
+    strncpy(v->ver, ver, VCFS_VER_LEN - 1);
+    v->mtime = mtime;
+
+    f = (vcfs_fileid *)calloc(1, sizeof(vcfs_fileid));
+    strcpy(f->name, name);
+    f->id = id;
+    f->hash_key = hash(name);
+    f->virtual = 1;
+    f->ventry = v;
+
+    return f;
+}
+
+/* Get the file for a revision (a number, not a tag) of a file, making it
+ * if we don't have it. If it has to be made and id is the id of a slot, it
+ * goes in that slot.
+ */
+vcfs_fileid *vcfs_ext_get(vcfs_fileid *base, char *ver, int id)
+{
+    vcfs_path name;
+    vcfs_path real;
+    vcfs_fileid *f;
+    ext_entry *e;
+    vcfs_blob *b;
+    time_t mtime = 0;
+    int size;
+
+    snprintf(name, sizeof(name), "%s,%s", base->name, ver);
+
+    pthread_mutex_lock(&ext_lock);
+
+    e = ext_find(name);
+    if (e != NULL)
+    {
+        ext_unlink(e);
+        ext_push(e);
+        f = e->f;
+    }
+
+    pthread_mutex_unlock(&ext_lock);
+
+    if (e != NULL)
+    {
+        return f;
+    }
+
+    /* If we already have that revision we know its size and when it was
+     * committed; otherwise vcfs_read() fills them in later.
+     */
+    size = (base->ventry != NULL) ? base->ventry->size : 0;
+    vcfs_view_real(base->name, real);
+    b = vcfs_cache_get(real, ver);
+    if (b != NULL)
+    {
+        size = b->size;
+        mtime = b->mtime;
+        vcfs_cache_release(b);
+    }
+
+    vcfs_ns_begin();
+    pthread_mutex_lock(&ext_lock);
+
+    /* Unless somebody beat us to it */
+    e = ext_find(name);
+    if (e != NULL)
+    {
+        ext_unlink(e);
+    }
+    else
+    {
+        e = ext_slot(id);
+        e->f = ext_make(name, VCFS_EXT_ID + (e - ext_slots), ver, size, mtime);
+        e->base = base->id;
+        e->hnext = ext_hash[e->f->hash_key];
+        ext_hash[e->f->hash_key] = e;
+        ext_used++;
+    }
+    ext_push(e);
+    f = e->f;
+
+    pthread_mutex_unlock(&ext_lock);
+    vcfs_ns_commit();
+
+    return f;
+}
+
+/* Find the file a version extended filehandle is for, making it again if
+ * it has been dropped. Returns NULL if the file it is a version of has
+ * gone.
+ */
+vcfs_fileid *vcfs_ext_handle(vcfs_fhdata *fh)
+{
+    vcfs_fileid *base;
+    vcfs_fileid *f = NULL;
+    ext_entry *e;
+
+    if (fh->id < VCFS_EXT_ID || fh->id >= VCFS_EXT_ID + VCFS_EXT_MAX ||
+        memchr(fh->ver, '\0', sizeof(fh->ver)) == NULL)
+    {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&ext_lock);
+
+    e = &ext_slots[fh->id - VCFS_EXT_ID];
+    if (e->f != NULL && e->base == fh->base &&
+        !strcmp(e->f->ventry->ver, fh->ver))
+    {
+        ext_unlink(e);
+        ext_push(e);
+        f = e->f;
+    }
+
+    pthread_mutex_unlock(&ext_lock);
+
+    if (f != NULL)
+    {
+        return f;
+    }
+
+    base = find_fh("", fh->base, fh->key);
+    if (base == NULL || base->ventry == NULL || base->ventry->type != NFREG)
+    {
+        return NULL;
+    }
+
+    DEBUG(DEBUG_M, "[vcfs_ext] making %s,%s again", base->name, fh->ver);
+
+    return vcfs_ext_get(base, fh->ver, fh->id);
+}
+
+/* Put right how big a version is, and when it was committed, once it has
+ * been read. Must be called from within a transaction.
+ */
+void vcfs_ext_fix(char *name, char *ver, int size, time_t mtime)
+{
+    ext_entry *e;
+    vcfs_fileid *f;
+
+    pthread_mutex_lock(&ext_lock);
+
+    e = ext_find(name);
+    if (e != NULL && !strcmp(e->f->ventry->ver, ver))
+    {
+        f = e->f;
+        e->f = ext_make(f->name, f->id, ver, size,
+                        (mtime != 0) ? mtime : f->ventry->mtime);
+        vcfs_ns_retire(f->ventry);
+        vcfs_ns_retire(f);
+    }
+
+    pthread_mutex_unlock(&ext_lock);
+}
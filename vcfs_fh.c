@@ -4,9 +4,12 @@
  * structures. We keep a hash table of all pathnames in the filesystem, 
  * represented by vcfs_fileid's. Each vcfs_fileid contains a pointer to a
  * vcfs_ventry, which contains file attributes for regular files and
- * a directory listing for directories.
+ * a directory listing for directories. The hash table and the ventries
+ * belong to a version of the namespace (see vcfs_ns.c); anything that
+ * changes them has to do so inside a transaction.
  ***************************************************************************/
 
+#include <ctype.h>
 #include <dirent.h>
 #include <sys/types.h>
 #include <sys/file.h>
@@ -18,27 +21,20 @@
 #include <time.h>
 
 #include "vcfs.h"
+#include "vcfs_rpc.h"
 #include "cvs_cmds.h"
 #include "utils.h"
 
-/* Our hash table of file ids */
-vcfs_fileid *file_hash[1024];
-
-/* Our virtual cvs project */
-vcfs_ventry *ventry_list;
-
 /* This is the fileid for the root */
-vcfs_fileid root_node = {0, 0, {'\0'}, 0, NULL, NULL};
+vcfs_fileid root_node = {0, 0, {'\0'}, 0, 0, NULL, NULL};
 static fh_ut root_handle; 
 
-/* Stuff for the vinode bitmap */
-#define NUM_VINODES 256
+/* Stuff for the vinode bitmap. Views of other tags and dates (see
+ * vcfs_view.c) take as many as the files they show, so there are plenty.
+ */
+#define NUM_VINODES 8192
 int vinode_bmap[NUM_VINODES];
 
-/* We cache the most recently read file */
-/* TODO: Make this a lot better */
-static vcfs_read_cachent *read_cache;
-
 /* Debug a filehandle */
 void dump_fh(vcfs_fhdata *f)
 {
@@ -92,6 +88,13 @@ int alloc_vinode()
     return 0;
 }
 
+/* Give a vinode number back to the bitmap */
+void free_vinode(int id)
+{
+    id--;
+    vinode_bmap[id / 32] &= ~(1 << (id % 32));
+}
+
 /* Simple hash function */
 int hash(char *s)
 {
@@ -101,10 +104,10 @@ int hash(char *s)
     for (i = 0; i < strlen(s); i++) {
         n += s[i];
     }
-    if (n % 1024 == 0)
+    if (n % VCFS_HASH_SIZE == 0)
         return 7;
     else
-        return n % 1024;
+        return n % VCFS_HASH_SIZE;
 }
 
 /* This function returns a fileid given a vcfs_fhdata */
@@ -121,6 +124,12 @@ vcfs_fileid *get_fh(vcfs_fhdata *h)
         return &root_node;
     }
  
+    /* Version extended names aren't in the namespace */
+    if (h->id >= VCFS_EXT_ID)
+    {
+        return vcfs_ext_handle(h);
+    }
+    
     /* We didn't want the root */
     ret = find_fh("fake string", h->id, h->key);
     
@@ -135,7 +144,7 @@ vcfs_fileid *find_fh(char *name, int id, int key)
     
     bucket = key;
     
-    i = file_hash[bucket];
+    i = vcfs_ns_get()->file_hash[bucket];
     while (i != NULL)
     {
         if (i->id == id)
@@ -159,6 +168,8 @@ vcfs_fileid *create_fh(vcfs_path name, int v, vcfs_ventry *vent)
     strcpy(f->name, name);
     f->id = vent->id;
     f->hash_key = hash(f->name);
+    f->virtual = v;
+    f->gen = vcfs_ns_get()->gen;
     f->ventry = vent;
     
     insert_fh(f);
@@ -173,7 +184,7 @@ vcfs_fileid *lookup_fh_name(vcfs_path name)
     
     h = hash(name);
     
-    for (f = file_hash[h]; f != NULL; f = f->next)
+    for (f = vcfs_ns_get()->file_hash[h]; f != NULL; f = f->next)
     {
       if (strcmp(f->name, name) == 0)
       {
@@ -183,6 +194,63 @@ vcfs_fileid *lookup_fh_name(vcfs_path name)
     return NULL;
 }
 
+/* Where a name lands in a directory's bloom filter. The filter has eight
+ * bits for each slot in dirent, so it stays about as full as the directory
+ * grows.
+ */
+static unsigned int bloom_bit(vcfs_ventry *d, char *name, int i)
+{
+    unsigned int h = 2166136261u;
+    char *base;
+
+    base = strrchr(name, '/');
+    for (base = (base != NULL) ? base + 1 : name; *base != '\0'; base++)
+    {
+        h = (h ^ (unsigned char)*base) * 16777619u;
+    }
+
+    return (h + i * ((h >> 16) | 1)) % (d->maxents * 8);
+}
+
+/* Note a name in a directory's bloom filter */
+static void bloom_add(vcfs_ventry *d, char *name)
+{
+    unsigned int bit;
+    int i;
+
+    for (i = 0; i < VCFS_BLOOM_HASHES; i++)
+    {
+        bit = bloom_bit(d, name, i);
+        d->bloom[bit / 8] |= 1 << (bit % 8);
+    }
+}
+
+/* Might the directory have something called name in it? Returns 0 only
+ * if it definitely doesn't.
+ */
+int vcfs_bloom_test(vcfs_ventry *d, char *name)
+{
+    unsigned int bit;
+    int i;
+
+    if (d->bloom == NULL)
+    {
+        /* Nothing has ever been put in it */
+        return 0;
+    }
+
+    for (i = 0; i < VCFS_BLOOM_HASHES; i++)
+    {
+        bit = bloom_bit(d, name, i);
+        if (!(d->bloom[bit / 8] & (1 << (bit % 8))))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
 /* TODO - This should return something, it could fail */
 void insert_ventry(vcfs_ventry *v)
 {
@@ -190,6 +258,7 @@ void insert_ventry(vcfs_ventry *v)
     vcfs_name entry;
     vcfs_fileid *f;
     vcfs_ventry *p;
+    int i;
     
     ASSERT(v != NULL, "Inserting a NULL ventry");
 
@@ -209,10 +278,39 @@ void insert_ventry(vcfs_ventry *v)
                 parent);
         return;
     }
-    p = f->ventry;
+    p = vcfs_ns_edit(parent);
+
+    if (p->nfree > 0)
+    {
+        /* Fill in a hole left by a removed entry */
+        for (i = 0; p->dirent[i] != NULL; i++)
+            ;
+        p->dirent[i] = v;
+        p->nfree--;
+        bloom_add(p, v->name);
+        return;
+    }
     
-    v->next = p->dirent;
-    p->dirent = v;
+    if (p->nents == p->maxents)
+    {
+        /* This copy of the directory is ours, we can grow it. The bloom
+         * filter grows with it, so it has to be filled in again.
+         */
+        p->maxents = (p->maxents == 0) ? 16 : 2 * p->maxents;
+        p->dirent = (vcfs_ventry **)realloc(p->dirent, 
+                                            p->maxents * sizeof(vcfs_ventry *));
+        free(p->bloom);
+        p->bloom = (unsigned char *)calloc(p->maxents, 1);
+        for (i = 0; i < p->nents; i++)
+        {
+            if (p->dirent[i] != NULL)
+            {
+                bloom_add(p, p->dirent[i]->name);
+            }
+        }
+    }
+    p->dirent[p->nents++] = v;
+    bloom_add(p, v->name);
     
     return;
 }
@@ -234,9 +332,14 @@ vcfs_ventry *create_ventry(vcfs_path name, int size, ftype type,
     {
         strncpy(v->ver, ver, VCFS_VER_LEN);
     }
-    v->ctime = t;
-    v->next = NULL;
+    v->mtime = t;
+    v->gen = vcfs_ns_get()->gen;
     v->dirent = NULL;
+    v->nents = 0;
+    v->maxents = 0;
+    v->nfree = 0;
+    v->bloom = NULL;
+    v->lazy = 0;
     if (tag != NULL)
     {
         strncpy(v->tag, tag, VCFS_TAG_LEN);
@@ -251,13 +354,216 @@ vcfs_ventry *create_ventry(vcfs_path name, int size, ftype type,
     
 }
 
+/* Take a file out of the cache */
+void remove_fh(vcfs_fileid *f)
+{
+    vcfs_ns *ns = vcfs_ns_get();
+    vcfs_fileid *prev = NULL;
+    vcfs_fileid *i;
+
+    ASSERT(f != NULL, "Removing a NULL fileid");
+
+    for (i = ns->file_hash[f->hash_key]; i != NULL; i = i->next)
+    {
+        if (i == f)
+        {
+            if (prev == NULL)
+            {
+                ns->file_hash[f->hash_key] = f->next;
+            }
+            else
+            {
+                vcfs_ns_edit_fh(prev)->next = f->next;
+            }
+            vcfs_ns_retire(f);
+            return;
+        }
+        prev = i;
+    }
+}
+
+/* Drop a ventry and everything under it, without touching its parent */
+static void drop_ventry(vcfs_ventry *v)
+{
+    vcfs_fileid *f;
+    int i;
+
+    for (i = 0; i < v->nents; i++)
+    {
+        if (v->dirent[i] != NULL)
+        {
+            drop_ventry(v->dirent[i]);
+        }
+    }
+
+    f = lookup_fh_name(v->name);
+    if (f != NULL)
+    {
+        remove_fh(f);
+    }
+
+    free_vinode(v->id);
+    vcfs_ns_retire(v->dirent);
+    vcfs_ns_retire(v->bloom);
+    vcfs_ns_retire(v);
+}
+
+/* Remove a ventry (and everything under it, if it is a directory) from the
+ * tree, along with its fileid.
+ */
+void remove_ventry(vcfs_ventry *v)
+{
+    vcfs_path parent;
+    vcfs_name entry;
+    vcfs_ventry *p;
+    int i;
+
+    ASSERT(v != NULL, "Removing a NULL ventry");
+
+    /* Unlink it from the parent's directory listing */
+    split_path(v->name, &parent, &entry);
+    p = vcfs_ns_edit(parent);
+
+    if (p != NULL)
+    {
+        for (i = 0; i < p->nents; i++)
+        {
+            if (p->dirent[i] == v)
+            {
+                /* Leave a hole rather than move everything after it, so
+                 * READDIR cookies stay where they were
+                 */
+                p->dirent[i] = NULL;
+                p->nfree++;
+                break;
+            }
+        }
+    }
+
+    drop_ventry(v);
+}
+
+/* Start reading a directory at the place a READDIR cookie points to */
+void vcfs_dir_seek(vcfs_dir_cursor *c, vcfs_fileid *dir, unsigned long cookie)
+{
+    c->dir = vcfs_view_fill(dir);
+    c->pos = cookie;
+}
+
+/* Get the next entry of a directory the way READDIR sees it: ".", "..",
+ * then everything in it except version extended names. Returns 0 if there
+ * are no more. The name points into the namespace, and v is set to the
+ * ventry of the entry, or NULL for "." and "..". Afterwards c->pos is the
+ * entry's cookie.
+ */
+int vcfs_dir_next(vcfs_dir_cursor *c, char **name, int *fileid,
+                  vcfs_ventry **v)
+{
+    vcfs_fileid *h = c->dir;
+    vcfs_ventry *root = vcfs_ns_root();
+    vcfs_ventry *temp;
+    vcfs_fileid *p;
+    vcfs_path parent;
+    vcfs_name entry;
+    char *base;
+
+    *v = NULL;
+
+    if (c->pos == 0)
+    {
+        *name = ".";
+        *fileid = (h->id == 0) ? 1 : h->id;
+        c->pos++;
+        return 1;
+    }
+
+    if (c->pos == 1)
+    {
+        *name = "..";
+
+        if (h->id == 0 || (h->ventry != NULL && h->ventry->id == root->id))
+        {
+            /* The parent is the root */
+            *fileid = 1;
+        }
+        else
+        {
+            split_path(h->name, &parent, &entry);
+            p = lookup_fh_name(parent);
+
+            ASSERT(p != NULL, "The direntry doesn't have a parent");
+            *fileid = p->id;
+        }
+
+        c->pos++;
+        return 1;
+    }
+
+    if (h->id == 0)
+    {
+        /* The root dir only has the project in it */
+        if (c->pos > 2)
+        {
+            return 0;
+        }
+
+        *name = root->name;
+        *fileid = root->id;
+        *v = root;
+        c->pos++;
+        return 1;
+    }
+
+    if (h->ventry == NULL)
+    {
+        return 0;
+    }
+
+    while (c->pos - 2 < h->ventry->nents)
+    {
+        temp = h->ventry->dirent[c->pos - 2];
+        c->pos++;
+
+        if (temp == NULL)
+        {
+            /* Removed */
+            continue;
+        }
+
+        base = strrchr(temp->name, '/');
+        base = (base != NULL) ? base + 1 : temp->name;
+
+        /* Skip filenames containing a comma - ver extended name */
+        if (strchr(base, ',') != NULL)
+        {
+            continue;
+        }
+        
+        /* The views of other tags and dates are only there if you know
+         * to look
+         */
+        if (h->ventry->id == root->id &&
+            (!strcmp(base, VCFS_TAGS_DIR) || !strcmp(base, VCFS_AT_DIR)))
+        {
+            continue;
+        }
+
+        *name = base;
+        *fileid = temp->id;
+        *v = temp;
+        return 1;
+    }
+
+    return 0;
+}
+
 /* Put a file into the cache */
 void insert_fh(vcfs_fileid *f)
 {
     ASSERT(f != NULL, "Inserting a NULL fileid");
 
-    f->next = file_hash[f->hash_key];
-    file_hash[f->hash_key] = f;
+    f->next = vcfs_ns_get()->file_hash[f->hash_key];
+    vcfs_ns_get()->file_hash[f->hash_key] = f;
 }
 
 /* Lookup a file in the cache */
@@ -266,17 +572,36 @@ vcfs_fileid *lookuph(vcfs_fileid *d, char *name, vcfs_fhdata *fh)
     char path[NFS_MAXPATHLEN];
     vcfs_fileid *f;
     vcfs_path short_name;
+    vcfs_tag sym;
     vcfs_ver ver;
-    int extended = 0;
-    int size;
+    int extended;
 
     ASSERT(name != NULL, "NULL name pointer");
 
+    memset(fh, 0, sizeof(vcfs_fhdata));
     fh->magic = MAGICNUM;
     
-    if (cvs_ver_extended(name, &short_name, &ver))
+    /* Views of other tags appear the first time they are looked in */
+    d = vcfs_view_fill(d);
+    f = vcfs_view_lookup(d, name);
+    if (f != NULL)
+    {
+        fh->id = f->id;
+        fh->key = hash(f->name);
+        return f;
+    }
+    
+    extended = cvs_ver_extended(name, &short_name, &sym);
+    
+    /* Most lookups of names that aren't there stop here */
+    if (d->ventry != NULL && d->ventry->type == NFDIR &&
+        !vcfs_bloom_test(d->ventry, extended ? short_name : name))
+    {
+        return NULL;
+    }
+    
+    if (extended)
     {
-        extended = 1;
         sprintf(path, "%s/%s", d->name, short_name);
     }
     else if (strlen(d->name) != 0)
@@ -303,36 +628,67 @@ vcfs_fileid *lookuph(vcfs_fileid *d, char *name, vcfs_fhdata *fh)
     else
     {
         /* Look for the extended name */
-        if (!vcfs_validate_version(f->ventry, ver))
+        sprintf(path, "%s/%s", d->name, name);
+        
+        if (f->ventry == NULL || f->ventry->type != NFREG ||
+            vcfs_neg_check(path))
         {
-            /* The client asked for a version number that does not exists */
             return NULL;
         }
         
-        sprintf(path, "%s/%s", d->name, name);
+        /* A tag or date is turned into the revision it stands for, so
+         * the contents are shared with every other name for it
+         */
+        if (!vcfs_resolve_version(f->ventry, sym, ver))
+        {
+            /* The client asked for a version that does not exist */
+            vcfs_neg_add(path);
+            return NULL;
+        }
         
-        size = f->ventry->size;
-        f = lookup_fh_name(path);
+        /* These are kept apart from the namespace (see vcfs_ext.c) */
+        fh->key = f->hash_key;
+        fh->base = f->id;
+        strncpy(fh->ver, ver, sizeof(fh->ver) - 1);
         
-        if (f != NULL)
+        f = vcfs_ext_get(f, ver, 0);
+        fh->id = f->id;
+    }
+    
+    return f;
+}
+
+/* Give a directory, and every directory under it, the time of the newest
+ * thing in it. Empty directories keep the time they already have.
+ */
+static time_t set_dir_mtime(vcfs_ventry *d)
+{
+    vcfs_ventry *v;
+    time_t newest = 0;
+    time_t t;
+    int i;
+
+    for (i = 0; i < d->nents; i++)
+    {
+        v = d->dirent[i];
+        if (v == NULL)
         {
-            fh->id = f->id;
-            fh->key = hash(f->name);
+            continue;
         }
-        else
+
+        t = (v->type == NFDIR) ? set_dir_mtime(v) : v->mtime;
+        if (t > newest)
         {
-            vcfs_ventry *v;
-            
-            /* Construct it */
-            v = create_ventry(path, size, NFREG, 0, ver, (time_t)0, NULL);
-            f = create_fh(path, 1, v);
-            
-            fh->id = v->id;
-            fh->key = hash(path);
+            newest = t;
         }
     }
-    
-    return f;
+
+    if (newest != 0)
+    {
+        d->mtime = newest;
+    }
+
+    return d->mtime;
 }
 
 /* Checkout the project from CVS, and build and in-memory representation
@@ -351,12 +707,15 @@ int vcfs_build_project()
     char *line;
     int i;
     time_t current_time;
+    time_t mod_time = 0;
     char ver[16];
     int count = 0;
+    vcfs_ventry *root;
 
     printf("Please wait, loading project...\n");
 
     time(&current_time);
+    vcfs_refresh_set_sync(current_time);
     
     /* Expand the module */
     r = cvs_expand_modules(&expand_buff);
@@ -382,14 +741,20 @@ int vcfs_build_project()
     
     init_vinode_bmap();
     
+    /* The whole project is built in one transaction */
+    vcfs_ns_begin();
+    
     /* Prepare the root dir of the project */
-    ventry_list = (vcfs_ventry *)malloc(sizeof(vcfs_ventry));
+    root = (vcfs_ventry *)malloc(sizeof(vcfs_ventry));
+    memset(root, 0, sizeof(vcfs_ventry));
 
-    ventry_list->id = 3; /* The very top dir is 1 */
-    ventry_list->size = 2048;
-    ventry_list->type = NFDIR;
-    ventry_list->next = NULL;
-    ventry_list->dirent = NULL;
+    root->id = 3; /* The very top dir is 1 */
+    root->size = 2048;
+    root->type = NFDIR;
+    root->mtime = current_time;
+    root->gen = vcfs_ns_get()->gen;
+    root->dirent = NULL;
+    vcfs_ns_set_root(root);
 
     for (i = 0; i < strlen(beg); i++)
     {
@@ -402,8 +767,8 @@ int vcfs_build_project()
             if (count == 0) 
             {
                 /* This is the root dir */
-                strcpy(ventry_list->name, mod_path);
-                create_fh(ventry_list->name, 1, ventry_list);
+                strcpy(root->name, mod_path);
+                create_fh(root->name, 1, root);
             }
             else 
             {
@@ -432,6 +797,7 @@ int vcfs_build_project()
     if (!r)
     {
         /* The repository could not be checked out */
+        vcfs_ns_commit();
         return 0;
     }
     
@@ -450,7 +816,12 @@ int vcfs_build_project()
         memset(path, 0, sizeof(path));
         memset(tag_copy, 0, sizeof(tag_copy));
 
-        if (line[0] == 'E')
+        if (!strncmp(line, "Mod-time ", 9))
+        {
+            /* When the next file was committed */
+            mod_time = cvs_mod_time(line);
+        }
+        else if (line[0] == 'E')
         {
             /* Looks like a directory. 
              * HACK - Everything from line[23] on is the dir name.
@@ -471,10 +842,25 @@ int vcfs_build_project()
             strncpy(path, line + 4, (strlen(line) - 4));
             free(line);
             
-            for (i = 0; i < 2; i++) 
+            /* Skip to the "Created" response, noting the Mod-time if it
+             * comes first, then skip the repository name
+             */
+            while (cvs_buff_read_line(co_buff, &line) > 0)
             {
-                cvs_buff_read_line(co_buff, NULL);
+                if (!strncmp(line, "Created ", 8) ||
+                    !strncmp(line, "Updated ", 8))
+                {
+                    break;
+                }
+                if (!strncmp(line, "Mod-time ", 9))
+                {
+                    mod_time = cvs_mod_time(line);
+                }
+                free(line);
+                line = NULL;
             }
+            free(line);
+            cvs_buff_read_line(co_buff, NULL);
             
             /* Get the version */
             cvs_buff_read_line(co_buff, &line);
@@ -524,7 +910,10 @@ int vcfs_build_project()
                 real_size = size = atoi(line);
             }
 
-            v = create_ventry(path, real_size, NFREG, 0, ver, current_time, tag_copy);
+            /* Servers too old to send Mod-time get the time we mounted */
+            v = create_ventry(path, real_size, NFREG, 0, ver,
+                              mod_time ? mod_time : current_time, tag_copy);
+            mod_time = 0;
             create_fh(path, 1, v);
             fprintf(stderr, "  create file %s\n", path);
             
@@ -535,190 +924,237 @@ int vcfs_build_project()
         free(line);
     }
     
+    /* A directory only changes when something in it does */
+    set_dir_mtime(root);
+    
+    vcfs_ns_commit();
+    
     cvs_free_buff(expand_buff);
     cvs_free_buff(co_buff);
 
-    /* Allocate the read cache */
-    read_cache = malloc(sizeof(vcfs_read_cachent));
-    
     return r;
 }
 
-/* Perform a read. The very simplistic "cache" used here simply
- * slurps up files in large chunks and stores the current chunk for the most
- * recently requested file.
+/* Perform a read. Files are fetched from the server whole and kept in the
+ * cache (see vcfs_cache.c), so reading the rest of the file doesn't have
+ * to go back to the server. The data isn't copied anywhere: the request
+ * holds on to the cached file, and the data is sent straight from it after
+ * the rest of the reply (see rpc_reply()). Returns how much there is, and
+ * the file's attributes for the reply in attr.
  */
-int vcfs_read(char *buff, vcfs_fhdata *fh, int count, int offset)
+int vcfs_read(vcfs_fhdata *fh, int count, int offset, struct svc_req *rp,
+              vcfs_ventry *attr)
 {
-    cvs_buff *resp;
     vcfs_fileid *f;
-    int i;
-    char *line;
-    int size;
+    vcfs_blob *b;
     int len;
-    int cache_end;
-    int partial_read = 0;
-    int cached_read = FALSE;
     vcfs_path filename;
-    vcfs_ver ver;
-    int compressed_offset;
-    bool compressed = FALSE;
+    vcfs_tag sym;
     
     f = get_fh(fh);
     
-    ASSERT(f != NULL, "Reading from a bad filehandle");
+    if (f == NULL || f->ventry == NULL)
+    {
+        /* Probably removed from the repository since the client looked */
+        return -1;
+    }
     
-    /* Adjust the name if it is version extended */
-    if (!cvs_ver_extended(f->name, &filename, &ver))
+    /* Adjust the name if it is version extended, or in a view */
+    if (!cvs_ver_extended(f->name, &filename, &sym))
     {
         strcpy(filename, f->name);
     }
+    vcfs_view_real(filename, filename);
     
-    cache_end = read_cache->start + read_cache->size;
+    /* If the file isn't cached, the request waits for it without
+     * holding up this thread, and is run again once it arrives.
+     */
+    switch (vcfs_cache_fetch_async(filename, f->ventry->ver, VCFS_REQ(rp), &b))
+    {
+    case 0:
+        return VCFS_READ_DEFERRED;
+    case -1:
+        return -1;
+    }
     
-    /* Are we reading from our cache? */
-    if (read_cache->id == f->id)
+    /* Now we know how big the file really is, and when it was committed.
+     * Our reply says so, and the namespace is put right later.
+     */
+    memcpy(attr, f->ventry, sizeof(vcfs_ventry));
+    attr->size = b->size;
+    if (b->mtime != 0)
     {
-        cached_read = TRUE;
+        attr->mtime = b->mtime;
+    }
 
-        if (read_cache->size == READ_CACHE_SIZE && offset + count > cache_end)
-        {
-            /* We are reading beyond our current cache */
-            if (offset < cache_end)
-            {
-                /* Copy what we have into the buffer, go get the rest */
-                partial_read = cache_end - offset;
-                memcpy(buff, read_cache->data + offset, partial_read);
-                count -= partial_read;
-            }
-        }
-        else
-        {
-            /* We have everything we need in cache, return it */
-            
-            memcpy(buff, read_cache->data + offset - read_cache->start, count);
-            len = count;
-            return len;
-        }
+    if (attr->size != f->ventry->size || attr->mtime != f->ventry->mtime)
+    {
+        vcfs_cache_fix(f->name, b);
     }
     
-    /* Populate the cache for the next read to this file */
-    read_cache->id = f->id;
-    
-    cvs_get_file(filename, f->ventry->ver, &resp);
-    
-    for (i = 0; i < 5; i++)
+    if (offset >= b->size)
     {
-        cvs_buff_read_line(resp, NULL);
+        len = 0;
     }
-    
-    cvs_buff_read_line(resp, &line);
-    
-    if (line[0] == 'z')
+    else if (offset + count > b->size)
     {
-        /* This file is compressed */
-        compressed = TRUE;
-        size = atoi(line + 1);
-        
-        /* Get the uncompressed chunk of the file we need to fill the cache */
-        if (cached_read)
-        {
-            compressed_offset = read_cache->start + read_cache->size;
-        }
-        else
-        {
-            compressed_offset = 0;
-        }
-        
-        size = cvs_zlib_inflate_buffer(resp, size, compressed_offset, read_cache->data,
-                                       READ_CACHE_SIZE, TRUE);
+        len = b->size - offset;
     }
     else
     {
-        size = atoi(line);
+        len = count;
     }
-    free(line);
     
-    f->ventry->size = size;
+    if (len > 0)
+    {
+        VCFS_REQ(rp)->read_blob = b;
+        VCFS_REQ(rp)->read_data = b->data + offset;
+        VCFS_REQ(rp)->read_len = len;
+    }
+    else
+    {
+        vcfs_cache_release(b);
+    }
     
-    if (cached_read)
+    return len;
+}
+
+
+/* Put right how big a file is and when it was committed, if it is still
+ * that revision. Must be called from within a transaction.
+ */
+void vcfs_fix_attrs(char *name, char *ver, int size, time_t mtime)
+{
+    vcfs_fileid *f;
+    vcfs_ventry *v;
+
+    f = lookup_fh_name(name);
+    if (f == NULL)
     {
-        /* The file has already been cached, but we need to read more */
-        if (size - read_cache->size > READ_CACHE_SIZE)
-        {
-            size = READ_CACHE_SIZE;
-        }
-        read_cache->start += read_cache->size;
+        /* Version extended names are kept apart */
+        vcfs_ext_fix(name, ver, size, mtime);
+        return;
+    }
+
+    if (f->ventry == NULL || strcmp(f->ventry->ver, ver))
+    {
+        return;
+    }
+
+    v = vcfs_ns_edit(name);
+    v->size = size;
+    if (mtime != 0)
+    {
+        v->mtime = mtime;
+    }
+}
+
+/* Look up what a version, tag or date stands for in a file in an index */
+static int resolve_index(vcfs_index *x, int file, char *sym, time_t when,
+                         vcfs_ver ver)
+{
+    int r;
+    int t;
     
-        if (!compressed)
-        {
-            memcpy(read_cache->data, resp->data + resp->cookie + read_cache->start,
-                   size);
-        }
-        read_cache->size = size;
-        offset -= read_cache->start;
+    if (isdigit((unsigned char)sym[0]))
+    {
+        r = vcfs_index_find(x, file, sym);
     }
     else
     {
-        if (size > READ_CACHE_SIZE)
+        if (sym[0] == '@')
         {
-            size = READ_CACHE_SIZE;
+            r = vcfs_index_at(x, file, when);
         }
-        
-        if (!compressed)
+        else
         {
-            memcpy(read_cache->data, resp->data + resp->cookie, size);
+            t = vcfs_index_tag(x, file, sym);
+            r = (t >= 0) ? vcfs_index_rev(x, file, x->tag_ver[t]) : -1;
         }
         
-        read_cache->size = size;
-        read_cache->start = 0;
-        
+        /* The file had been removed then */
+        if (r >= 0 && !strcmp(x->strs + x->rev_state[r], "dead"))
+        {
+            r = -1;
+        }
     }
     
-    if (offset + count > read_cache->start + read_cache->size)
-    {
-        memcpy(buff + partial_read, (read_cache->data + offset),
-               read_cache->size - offset);
-        len = size - offset;
-    }
-    else
+    if (r < 0)
     {
-        memcpy(buff + partial_read, (read_cache->data + offset), count);
-        len = count + partial_read;
+        return 0;
     }
     
-    //printf("The data we read is %s\n", buff);
-    
-    cvs_free_buff(resp);
-    
-    return len;
+    memcpy(ver, x->rev_ver[r], sizeof(vcfs_ver));
+    return 1;
 }
 
-
-/* Make sure the given version is actually a version of the specified file */
-int vcfs_validate_version(vcfs_ventry *v, char *ver)
+/* Work out which revision of a file what comes after the comma in a
+ * version extended name stands for: a revision (foo.c,1.7), a tag
+ * (foo.c,REL_2, or the newest revision on the branch for a branch tag), or
+ * a date (foo.c,@2001-09-15, the trunk as it was then). The index answers
+ * for most files and the file's history for the rest. Puts the revision in
+ * ver, and returns 0 if the file has no such version.
+ */
+int vcfs_resolve_version(vcfs_ventry *v, char *sym, vcfs_ver ver)
 {
-    cvs_buff *resp;
-    int n;
-    char *next_ver;
-    int valid = 0;
+    vcfs_path name;
+    vcfs_index *x;
+    vcfs_hist *h;
+    time_t when = 0;
+    int found = 0;
+    int tries;
+    int file;
     
-    cvs_get_log(v->name, &resp);
+    if (sym[0] == '@' && !vcfs_view_date(sym + 1, &when))
+    {
+        return 0;
+    }
     
-    while(cvs_get_log_info(resp, &next_ver, NULL, NULL, NULL) > 0)
+    vcfs_view_real(v->name, name);
+    
+    /* The index can't know about anything committed after it was made,
+     * but what it says about earlier dates is all there is to know
+     */
+    x = vcfs_index_get();
+    if (x != NULL && (sym[0] != '@' || x->built > when))
     {
-        if (strcmp(ver, next_ver) == 0)
+        file = vcfs_index_file(x, name);
+        if (file >= 0)
         {
-            /* It's a valid version */
-            valid = 1;
+            found = resolve_index(x, file, sym, when, ver);
+            if (found || sym[0] == '@')
+            {
+                return found;
+            }
         }
-        
-        free(next_ver);
     }
     
-    cvs_free_buff(resp);
-    return valid;
+    for (tries = 0; tries < 2; tries++)
+    {
+        h = vcfs_hist_get(name);
+        if (h == NULL)
+        {
+            return 0;
+        }
+        
+        x = vcfs_index_hist(h);
+        vcfs_hist_release(h);
+        
+        found = resolve_index(x, 0, sym, when, ver);
+        
+        vcfs_index_free(x);
+        
+        /* Tagging a file doesn't change it, so a refresh doesn't make us
+         * forget its history. A tag we haven't heard of might be new.
+         */
+        if (found || sym[0] == '@' || isdigit((unsigned char)sym[0]))
+        {
+            break;
+        }
+        vcfs_hist_forget(name);
+    }
     
+    return found;
 }
 
 
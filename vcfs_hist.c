@@ -0,0 +1,374 @@
+/****************************************************************************
+ * File: vcfs_hist.c
+ * A cache of file histories. The first time anything wants to know about
+ * the revisions of a file (whether foo.c,1.3 exists, what 'cvstool lsver'
+ * or 'cvstool ls -l' should print), the whole log is fetched and parsed
+ * once, and everyone after that gets the parsed copy.
+ *
+ * A history is never changed once it is in the cache. When a refresh finds
+ * that a file has changed, its history is forgotten, and the next person
+ * to ask gets a new one. Like the file cache, each thread holds a reference
+ * while it is using a history, and the least recently used ones that
+ * nobody is using are freed when the cache gets too big.
+ ***************************************************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vcfs.h"
+#include "vcfs_rpc.h"
+#include "cvs_cmds.h"
+#include "utils.h"
+
+/* A history being fetched from the server */
+typedef struct hist_fetch {
+    char *name;
+    int forgotten; /* The file changed while we were fetching it */
+    struct hist_fetch *next;
+} hist_fetch;
+
+static pthread_mutex_t hist_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Everything below is protected by hist_lock */
+static vcfs_hist *hist_hash[VCFS_HASH_SIZE];
+static vcfs_hist *hist_head = NULL; /* Most recently used */
+static vcfs_hist *hist_tail = NULL; /* Least recently used */
+static long hist_bytes = 0;
+static hist_fetch *hist_fetching = NULL;
+
+/* Free a history and everything in it */
+void vcfs_hist_free(vcfs_hist *h)
+{
+    int i;
+
+    for (i = 0; i < h->nrevs; i++)
+    {
+        free(h->revs[i].date);
+        free(h->revs[i].author);
+        free(h->revs[i].state);
+        free(h->revs[i].branches);
+        free(h->revs[i].msg);
+    }
+
+    for (i = 0; i < h->ntags; i++)
+    {
+        free(h->tags[i].tag);
+    }
+
+    free(h->revs);
+    free(h->tags);
+    free(h);
+}
+
+/* Roughly how much memory a history takes */
+static int hist_size(vcfs_hist *h)
+{
+    vcfs_rev *r;
+    int size;
+    int i;
+
+    size = sizeof(vcfs_hist) + h->nrevs * sizeof(vcfs_rev) +
+        h->ntags * sizeof(vcfs_symname);
+
+    for (i = 0; i < h->nrevs; i++)
+    {
+        r = &h->revs[i];
+        size += (r->date ? strlen(r->date) : 0) +
+            (r->author ? strlen(r->author) : 0) +
+            (r->state ? strlen(r->state) : 0) +
+            strlen(r->branches) + strlen(r->msg) + 5;
+    }
+
+    for (i = 0; i < h->ntags; i++)
+    {
+        size += strlen(h->tags[i].tag) + 1;
+    }
+
+    return size;
+}
+
+/* Find a history in the hash table */
+static vcfs_hist *hist_find(char *name)
+{
+    vcfs_hist *h;
+
+    for (h = hist_hash[hash(name)]; h != NULL; h = h->hnext)
+    {
+        if (!strcmp(h->name, name))
+        {
+            return h;
+        }
+    }
+
+    return NULL;
+}
+
+/* Take a history off the LRU list */
+static void hist_unlink(vcfs_hist *h)
+{
+    if (h->prev != NULL)
+    {
+        h->prev->next = h->next;
+    }
+    else
+    {
+        hist_head = h->next;
+    }
+
+    if (h->next != NULL)
+    {
+        h->next->prev = h->prev;
+    }
+    else
+    {
+        hist_tail = h->prev;
+    }
+}
+
+/* Put a history at the front of the LRU list */
+static void hist_push(vcfs_hist *h)
+{
+    h->prev = NULL;
+    h->next = hist_head;
+
+    if (hist_head != NULL)
+    {
+        hist_head->prev = h;
+    }
+    else
+    {
+        hist_tail = h;
+    }
+    hist_head = h;
+}
+
+/* Take a history out of the hash table and LRU list */
+static void hist_remove(vcfs_hist *h)
+{
+    vcfs_hist **p;
+
+    for (p = &hist_hash[hash(h->name)]; *p != h; p = &(*p)->hnext)
+        ;
+    *p = h->hnext;
+
+    hist_unlink(h);
+    hist_bytes -= h->bytes;
+}
+
+/* Free histories nobody is using until the cache is small enough */
+static void hist_evict()
+{
+    vcfs_hist *h;
+    vcfs_hist *prev;
+
+    for (h = hist_tail; h != NULL && hist_bytes > VCFS_HIST_MAX; h = prev)
+    {
+        prev = h->prev;
+
+        if (h->refs > 0)
+        {
+            continue;
+        }
+
+        hist_remove(h);
+
+        DEBUG(DEBUG_H, "[vcfs_hist] evicted %s", h->name);
+        vcfs_hist_free(h);
+    }
+}
+
+/* Get the history of a file from the server. Returns NULL if there isn't
+ * one.
+ */
+static vcfs_hist *hist_read_server(char *name)
+{
+    cvs_buff *resp;
+    vcfs_hist *h;
+    int n;
+
+    vcfs_rpc_flush();
+
+    cvs_get_log(name, &resp);
+    if (resp == NULL)
+    {
+        return NULL;
+    }
+
+    h = (vcfs_hist *)malloc(sizeof(vcfs_hist));
+    memset(h, 0, sizeof(vcfs_hist));
+    strncpy(h->name, name, sizeof(h->name) - 1);
+
+    n = cvs_parse_log(resp, h);
+    cvs_free_buff(resp);
+
+    if (n < 0)
+    {
+        fprintf(stderr, "vcfs_hist: Could not get the log of %s\n", name);
+        vcfs_hist_free(h);
+        return NULL;
+    }
+
+    h->bytes = hist_size(h);
+
+    DEBUG(DEBUG_M, "[vcfs_hist] fetched %s (%d revisions)", name, n);
+
+    return h;
+}
+
+/* Get the history of a file, from the cache if it's there and from the
+ * server if it isn't. Returns it with a reference held, or NULL if the
+ * server couldn't give it to us.
+ */
+vcfs_hist *vcfs_hist_get(char *name)
+{
+    vcfs_hist *h;
+    vcfs_hist *other;
+    hist_fetch fetch;
+    hist_fetch **p;
+    int i;
+
+    pthread_mutex_lock(&hist_lock);
+
+    for (;;)
+    {
+        h = hist_find(name);
+        if (h != NULL)
+        {
+            h->refs++;
+            hist_unlink(h);
+            hist_push(h);
+            pthread_mutex_unlock(&hist_lock);
+            return h;
+        }
+
+        /* Let a refresh tell us if the file changes while we fetch it */
+        fetch.name = name;
+        fetch.forgotten = 0;
+        fetch.next = hist_fetching;
+        hist_fetching = &fetch;
+
+        pthread_mutex_unlock(&hist_lock);
+
+        h = hist_read_server(name);
+
+        pthread_mutex_lock(&hist_lock);
+
+        for (p = &hist_fetching; *p != &fetch; p = &(*p)->next)
+            ;
+        *p = fetch.next;
+
+        if (h == NULL)
+        {
+            pthread_mutex_unlock(&hist_lock);
+            return NULL;
+        }
+
+        if (!fetch.forgotten)
+        {
+            break;
+        }
+
+        /* What we got may be from before the change */
+        DEBUG(DEBUG_M, "[vcfs_hist] %s changed while we fetched it", name);
+        vcfs_hist_free(h);
+    }
+
+    /* If somebody else got it first, use theirs */
+    other = hist_find(name);
+    if (other != NULL)
+    {
+        vcfs_hist_free(h);
+        h = other;
+        hist_unlink(h);
+    }
+    else
+    {
+        i = hash(name);
+        h->hnext = hist_hash[i];
+        hist_hash[i] = h;
+        hist_bytes += h->bytes;
+    }
+
+    h->refs++;
+    hist_push(h);
+    hist_evict();
+
+    pthread_mutex_unlock(&hist_lock);
+
+    return h;
+}
+
+/* Done with a history */
+void vcfs_hist_release(vcfs_hist *h)
+{
+    pthread_mutex_lock(&hist_lock);
+
+    ASSERT(h->refs > 0, "Releasing a history nobody is using");
+    h->refs--;
+
+    if (h->refs == 0 && h->stale)
+    {
+        vcfs_hist_free(h);
+    }
+    else if (h->refs == 0 && hist_bytes > VCFS_HIST_MAX)
+    {
+        hist_evict();
+    }
+
+    pthread_mutex_unlock(&hist_lock);
+}
+
+/* Find a revision in a history. Returns NULL if the file has no such
+ * revision.
+ */
+vcfs_rev *vcfs_hist_find(vcfs_hist *h, char *ver)
+{
+    int i;
+
+    for (i = 0; i < h->nrevs; i++)
+    {
+        if (!strcmp(h->revs[i].ver, ver))
+        {
+            return &h->revs[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Forget the history of a file, it has changed */
+void vcfs_hist_forget(char *name)
+{
+    vcfs_hist *h;
+    hist_fetch *f;
+
+    pthread_mutex_lock(&hist_lock);
+
+    for (f = hist_fetching; f != NULL; f = f->next)
+    {
+        if (!strcmp(f->name, name))
+        {
+            f->forgotten = 1;
+        }
+    }
+
+    h = hist_find(name);
+    if (h != NULL)
+    {
+        hist_remove(h);
+
+        if (h->refs > 0)
+        {
+            /* Freed by the last vcfs_hist_release() */
+            h->stale = 1;
+        }
+        else
+        {
+            vcfs_hist_free(h);
+        }
+    }
+
+    pthread_mutex_unlock(&hist_lock);
+}
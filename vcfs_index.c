@@ -0,0 +1,660 @@
+/****************************************************************************
+ * File: vcfs_index.c
+ * An index of every revision of every file in the module: who committed
+ * it, when, its state, and the symbolic names that point at it. It is
+ * built in the background when we start, from one "rlog" of the whole
+ * module on a connection of its own, so that 'cvstool ls -l' and
+ * 'cvstool lsver' of a big directory don't have to ask the server about
+ * each file in turn.
+ *
+ * The index is never changed once it is built, apart from marking the
+ * files that a refresh has found to be changed since. Those, and files
+ * that are newer than the index, are looked up in the history cache
+ * (vcfs_hist.c) instead, as is everything until the index is ready.
+ *
+ * The symbolic names are also kept sorted by name and file, so finding
+ * what a tag stands for in a file is a binary search.
+ ***************************************************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vcfs.h"
+#include "vcfs_rpc.h"
+#include "cvs_cmds.h"
+#include "utils.h"
+
+/* A file that changed while the index was being built */
+typedef struct index_pending {
+    char *name;
+    struct index_pending *next;
+} index_pending;
+
+/* What we need while filling in an index, and not afterwards */
+typedef struct index_builder {
+    vcfs_index *x;
+    int maxfiles;
+    int maxrevs;
+    int maxtags;
+    int maxstrs;
+    int nshared; /* Strings stored once: authors, states, tag names */
+    int maxshared;
+    int *shared_str;
+    int *shared_next;
+    int shared_hash[VCFS_HASH_SIZE];
+} index_builder;
+
+static pthread_mutex_t index_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Protected by index_lock. The index itself is read without it. */
+static vcfs_index *index_ready = NULL;
+static index_pending *index_changed = NULL;
+static int index_failed = 0;
+
+static int index_bucket(char *s)
+{
+    unsigned int h = 2166136261u;
+
+    while (*s != '\0')
+    {
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    }
+
+    return h % VCFS_HASH_SIZE;
+}
+
+/* Make room for max elements of the given size in a column */
+static void *index_resize(void *p, int max, int size)
+{
+    p = realloc(p, max * size);
+    ASSERT(p != NULL, "Out of memory building the index");
+
+    return p;
+}
+
+/* Copy a string into the index */
+static int index_str(index_builder *b, char *s)
+{
+    vcfs_index *x = b->x;
+    int len = strlen(s) + 1;
+    int off;
+
+    if (x->str_len + len > b->maxstrs)
+    {
+        while (x->str_len + len > b->maxstrs)
+        {
+            b->maxstrs = b->maxstrs ? b->maxstrs * 2 : 64 * 1024;
+        }
+        x->strs = index_resize(x->strs, b->maxstrs, 1);
+    }
+
+    off = x->str_len;
+    memcpy(x->strs + off, s, len);
+    x->str_len += len;
+
+    return off;
+}
+
+/* Copy a string into the index, unless it is already there from an
+ * earlier index_shared()
+ */
+static int index_shared(index_builder *b, char *s)
+{
+    int h;
+    int i;
+
+    if (s == NULL)
+    {
+        s = "";
+    }
+
+    h = index_bucket(s);
+    for (i = b->shared_hash[h]; i >= 0; i = b->shared_next[i])
+    {
+        if (!strcmp(b->x->strs + b->shared_str[i], s))
+        {
+            return b->shared_str[i];
+        }
+    }
+
+    if (b->nshared == b->maxshared)
+    {
+        b->maxshared = b->maxshared ? b->maxshared * 2 : 256;
+        b->shared_str = index_resize(b->shared_str, b->maxshared, sizeof(int));
+        b->shared_next = index_resize(b->shared_next, b->maxshared,
+                                      sizeof(int));
+    }
+
+    i = b->nshared++;
+    b->shared_str[i] = index_str(b, s);
+    b->shared_next[i] = b->shared_hash[h];
+    b->shared_hash[h] = i;
+
+    return b->shared_str[i];
+}
+
+/* Add one file's history to the end of the index */
+static void index_add(index_builder *b, vcfs_hist *h)
+{
+    vcfs_index *x = b->x;
+    vcfs_rev *r;
+    int file;
+    int bucket;
+    int i;
+    int n;
+
+    if (x->nfiles == b->maxfiles)
+    {
+        b->maxfiles = b->maxfiles ? b->maxfiles * 2 : 1024;
+        x->file_name = index_resize(x->file_name, b->maxfiles, sizeof(int));
+        x->file_rev = index_resize(x->file_rev, b->maxfiles, sizeof(int));
+        x->file_nrevs = index_resize(x->file_nrevs, b->maxfiles, sizeof(int));
+        x->file_tag = index_resize(x->file_tag, b->maxfiles, sizeof(int));
+        x->file_ntags = index_resize(x->file_ntags, b->maxfiles, sizeof(int));
+        x->file_stale = index_resize(x->file_stale, b->maxfiles, 1);
+        x->file_next = index_resize(x->file_next, b->maxfiles, sizeof(int));
+    }
+
+    while (x->nrevs + h->nrevs > b->maxrevs)
+    {
+        b->maxrevs = b->maxrevs ? b->maxrevs * 2 : 4096;
+        x->rev_ver = index_resize(x->rev_ver, b->maxrevs, sizeof(vcfs_ver));
+        x->rev_when = index_resize(x->rev_when, b->maxrevs, sizeof(time_t));
+        x->rev_date = index_resize(x->rev_date, b->maxrevs, sizeof(int));
+        x->rev_author = index_resize(x->rev_author, b->maxrevs, sizeof(int));
+        x->rev_state = index_resize(x->rev_state, b->maxrevs, sizeof(int));
+    }
+
+    while (x->ntags + h->ntags > b->maxtags)
+    {
+        b->maxtags = b->maxtags ? b->maxtags * 2 : 4096;
+        x->tag_name = index_resize(x->tag_name, b->maxtags, sizeof(int));
+        x->tag_ver = index_resize(x->tag_ver, b->maxtags, sizeof(vcfs_ver));
+        x->tag_file = index_resize(x->tag_file, b->maxtags, sizeof(int));
+    }
+
+    file = x->nfiles++;
+    x->file_name[file] = index_str(b, h->name);
+    x->file_rev[file] = x->nrevs;
+    x->file_nrevs[file] = h->nrevs;
+    x->file_tag[file] = x->ntags;
+    x->file_ntags[file] = h->ntags;
+    x->file_stale[file] = 0;
+
+    bucket = index_bucket(h->name);
+    x->file_next[file] = x->file_hash[bucket];
+    x->file_hash[bucket] = file;
+
+    for (i = 0; i < h->nrevs; i++)
+    {
+        r = &h->revs[i];
+        n = x->nrevs++;
+
+        memcpy(x->rev_ver[n], r->ver, sizeof(vcfs_ver));
+        x->rev_when[n] = r->when;
+        x->rev_date[n] = index_str(b, r->date ? r->date : "");
+        x->rev_author[n] = index_shared(b, r->author);
+        x->rev_state[n] = index_shared(b, r->state);
+    }
+
+    for (i = 0; i < h->ntags; i++)
+    {
+        n = x->ntags++;
+
+        x->tag_name[n] = index_shared(b, h->tags[i].tag);
+        memcpy(x->tag_ver[n], h->tags[i].ver, sizeof(vcfs_ver));
+        x->tag_file[n] = file;
+    }
+}
+
+/* Compare two tags by name, and then by file. qsort() can't be told
+ * which index it is sorting, so only one is sorted at a time.
+ */
+static pthread_mutex_t index_sort_lock = PTHREAD_MUTEX_INITIALIZER;
+static vcfs_index *index_sorting;
+
+static int index_tag_cmp(const void *a, const void *b)
+{
+    vcfs_index *x = index_sorting;
+    int i = *(const int *)a;
+    int j = *(const int *)b;
+    int c;
+
+    c = strcmp(x->strs + x->tag_name[i], x->strs + x->tag_name[j]);
+    if (c != 0)
+    {
+        return c;
+    }
+
+    return x->tag_file[i] - x->tag_file[j];
+}
+
+/* Start a new, empty index */
+static void index_begin(index_builder *b, time_t built)
+{
+    int i;
+
+    memset(b, 0, sizeof(*b));
+    b->x = (vcfs_index *)calloc(1, sizeof(vcfs_index));
+    b->x->built = built;
+
+    for (i = 0; i < VCFS_HASH_SIZE; i++)
+    {
+        b->x->file_hash[i] = -1;
+        b->shared_hash[i] = -1;
+    }
+}
+
+/* Finish off an index once every file is in it, and sort its tags */
+static vcfs_index *index_end(index_builder *b)
+{
+    vcfs_index *x = b->x;
+    int i;
+
+    free(b->shared_str);
+    free(b->shared_next);
+
+    x->tag_order = (int *)malloc((x->ntags + 1) * sizeof(int));
+    for (i = 0; i < x->ntags; i++)
+    {
+        x->tag_order[i] = i;
+    }
+
+    pthread_mutex_lock(&index_sort_lock);
+    index_sorting = x;
+    qsort(x->tag_order, x->ntags, sizeof(int), index_tag_cmp);
+    pthread_mutex_unlock(&index_sort_lock);
+
+    return x;
+}
+
+/* Read the log of everything under a path (or the whole module if path is
+ * NULL) into a new index. Returns NULL if the server wouldn't give it to
+ * us.
+ */
+vcfs_index *vcfs_index_read(char *path)
+{
+    index_builder b;
+    cvs_buff *resp;
+    vcfs_hist *h;
+    time_t built = time(NULL);
+
+    vcfs_rpc_flush();
+
+    cvs_rlog(path, &resp);
+    if (resp == NULL)
+    {
+        return NULL;
+    }
+
+    index_begin(&b, built);
+
+    for (;;)
+    {
+        h = (vcfs_hist *)calloc(1, sizeof(vcfs_hist));
+
+        if (cvs_parse_log(resp, h) < 0)
+        {
+            vcfs_hist_free(h);
+            break;
+        }
+
+        if (h->name[0] != '\0')
+        {
+            index_add(&b, h);
+        }
+        vcfs_hist_free(h);
+    }
+
+    cvs_free_buff(resp);
+
+    return index_end(&b);
+}
+
+/* Make an index of just one file from its history, so that what a tag or
+ * date stands for in a file that the index can't answer for is worked out
+ * the same way
+ */
+vcfs_index *vcfs_index_hist(vcfs_hist *h)
+{
+    index_builder b;
+
+    index_begin(&b, time(NULL));
+    index_add(&b, h);
+
+    return index_end(&b);
+}
+
+/* Free an index from vcfs_index_read() or vcfs_index_hist() that nobody
+ * else has seen
+ */
+void vcfs_index_free(vcfs_index *x)
+{
+    free(x->file_name);
+    free(x->file_rev);
+    free(x->file_nrevs);
+    free(x->file_tag);
+    free(x->file_ntags);
+    free(x->file_stale);
+    free(x->file_next);
+    free(x->rev_ver);
+    free(x->rev_when);
+    free(x->rev_date);
+    free(x->rev_author);
+    free(x->rev_state);
+    free(x->tag_name);
+    free(x->tag_ver);
+    free(x->tag_file);
+    free(x->tag_order);
+    free(x->strs);
+    free(x);
+}
+
+/* Mark a file in the index as changed. Must hold index_lock. */
+static void index_mark(vcfs_index *x, char *name)
+{
+    int i;
+
+    for (i = x->file_hash[index_bucket(name)]; i >= 0; i = x->file_next[i])
+    {
+        if (!strcmp(x->strs + x->file_name[i], name))
+        {
+            x->file_stale[i] = 1;
+        }
+    }
+}
+
+/* Build the index and hand it over to everyone else */
+static void *index_builder_thread(void *arg)
+{
+    vcfs_index *x;
+    index_pending *p;
+
+    x = vcfs_index_read(NULL);
+
+    pthread_mutex_lock(&index_lock);
+
+    /* Anything a refresh changed while we were reading is out of date */
+    while (index_changed != NULL)
+    {
+        p = index_changed;
+        index_changed = p->next;
+
+        if (x != NULL)
+        {
+            index_mark(x, p->name);
+        }
+        free(p->name);
+        free(p);
+    }
+
+    if (x != NULL)
+    {
+        __sync_synchronize();
+        index_ready = x;
+        printf("vcfs_index: %d files and %d revisions indexed\n",
+               x->nfiles, x->nrevs);
+    }
+    else
+    {
+        index_failed = 1;
+        fprintf(stderr, "vcfs_index: Could not get the log of the module\n");
+    }
+
+    pthread_mutex_unlock(&index_lock);
+
+    return NULL;
+}
+
+/* Start building the index */
+void vcfs_index_start()
+{
+    pthread_t tid;
+
+    if (pthread_create(&tid, NULL, index_builder_thread, NULL) != 0)
+    {
+        perror("vcfs_index: Could not start the index builder");
+        exit(1);
+    }
+    pthread_detach(tid);
+}
+
+/* Get the index, or NULL if it isn't ready yet */
+vcfs_index *vcfs_index_get()
+{
+    vcfs_index *x = index_ready;
+
+    __sync_synchronize();
+    return x;
+}
+
+/* Find a file in the index. Returns -1 if it isn't there, or has changed
+ * since the index was built.
+ */
+int vcfs_index_file(vcfs_index *x, char *name)
+{
+    int i;
+
+    for (i = x->file_hash[index_bucket(name)]; i >= 0; i = x->file_next[i])
+    {
+        if (!strcmp(x->strs + x->file_name[i], name))
+        {
+            return x->file_stale[i] ? -1 : i;
+        }
+    }
+
+    return -1;
+}
+
+/* Find a revision of a file in the index. Returns -1 if the file didn't
+ * have it when the index was built.
+ */
+int vcfs_index_find(vcfs_index *x, int file, char *ver)
+{
+    int i;
+
+    for (i = x->file_rev[file]; i < x->file_rev[file] + x->file_nrevs[file];
+         i++)
+    {
+        if (!strcmp(x->rev_ver[i], ver))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* Find what a tag stands for in a file. Returns its place in the tag
+ * columns, or -1 if the file didn't have the tag when the index was
+ * built. Tags must match exactly.
+ */
+int vcfs_index_tag(vcfs_index *x, int file, char *tag)
+{
+    int lo = 0;
+    int hi = x->ntags - 1;
+    int mid;
+    int i;
+    int c;
+
+    while (lo <= hi)
+    {
+        mid = (lo + hi) / 2;
+        i = x->tag_order[mid];
+
+        c = strcmp(tag, x->strs + x->tag_name[i]);
+        if (c == 0)
+        {
+            c = file - x->tag_file[i];
+        }
+
+        if (c == 0)
+        {
+            return i;
+        }
+        else if (c < 0)
+        {
+            hi = mid - 1;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+
+    return -1;
+}
+
+/* Find every file with a tag. Returns how many there are; they are
+ * tag_order[*first] onwards.
+ */
+int vcfs_index_tagged(vcfs_index *x, char *tag, int *first)
+{
+    int lo = 0;
+    int hi = x->ntags;
+    int mid;
+    int n;
+
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+
+        if (strcmp(x->strs + x->tag_name[x->tag_order[mid]], tag) < 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    *first = lo;
+    for (n = 0; lo + n < x->ntags; n++)
+    {
+        if (strcmp(x->strs + x->tag_name[x->tag_order[lo + n]], tag))
+        {
+            break;
+        }
+    }
+
+    return n;
+}
+
+/* Find the revision of a file that a revision or branch number stands
+ * for: the revision itself, or the newest revision on the branch. Branch
+ * tags are written as "magic" numbers like 1.2.0.4 for the branch 1.2.4,
+ * which is just 1.2 until something is committed on it. Returns -1 if the
+ * file has no such revision.
+ */
+int vcfs_index_rev(vcfs_index *x, int file, char *sym)
+{
+    vcfs_ver branch;
+    char *last;
+    char *p;
+    int dots = 0;
+    int best = -1;
+    int len;
+    int i;
+
+    for (p = sym; *p != '\0'; p++)
+    {
+        dots += (*p == '.');
+    }
+
+    if (dots % 2 == 1 && dots < 3)
+    {
+        return vcfs_index_find(x, file, sym);
+    }
+
+    memset(branch, 0, sizeof(branch));
+    strncpy(branch, sym, sizeof(branch) - 1);
+
+    last = strrchr(branch, '.');
+    if (dots % 2 == 1)
+    {
+        if (last - branch < 2 || strncmp(last - 2, ".0", 2))
+        {
+            return vcfs_index_find(x, file, sym);
+        }
+        memmove(last - 2, last, strlen(last) + 1);
+    }
+
+    /* The newest revision with one more number than the branch */
+    len = strlen(branch);
+    for (i = x->file_rev[file]; i < x->file_rev[file] + x->file_nrevs[file];
+         i++)
+    {
+        if (!strncmp(x->rev_ver[i], branch, len) && x->rev_ver[i][len] == '.' &&
+            strchr(x->rev_ver[i] + len + 1, '.') == NULL &&
+            (best < 0 ||
+             atoi(x->rev_ver[i] + len + 1) > atoi(x->rev_ver[best] + len + 1)))
+        {
+            best = i;
+        }
+    }
+
+    if (best >= 0)
+    {
+        return best;
+    }
+
+    /* Nothing on the branch yet, so it's where the branch starts */
+    last = strrchr(branch, '.');
+    *last = '\0';
+    return (dots % 2 == 1) ? vcfs_index_find(x, file, branch) : -1;
+}
+
+/* Find the revision of a file that was newest on the trunk at a time.
+ * Returns -1 if the file hadn't been added to the trunk by then.
+ */
+int vcfs_index_at(vcfs_index *x, int file, time_t when)
+{
+    char *dot;
+    int best = -1;
+    int i;
+
+    /* Newest first, so the first of two at the same second is newer */
+    for (i = x->file_rev[file]; i < x->file_rev[file] + x->file_nrevs[file];
+         i++)
+    {
+        dot = strchr(x->rev_ver[i], '.');
+        if (dot == NULL || strchr(dot + 1, '.') != NULL ||
+            x->rev_when[i] > when)
+        {
+            continue;
+        }
+
+        if (best < 0 || x->rev_when[i] > x->rev_when[best])
+        {
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+/* A file has changed, stop answering for it */
+void vcfs_index_forget(char *name)
+{
+    index_pending *p;
+
+    pthread_mutex_lock(&index_lock);
+
+    if (index_ready != NULL)
+    {
+        index_mark(index_ready, name);
+    }
+    else if (!index_failed)
+    {
+        p = (index_pending *)malloc(sizeof(index_pending));
+        p->name = strdup(name);
+        p->next = index_changed;
+        index_changed = p;
+    }
+
+    pthread_mutex_unlock(&index_lock);
+}
@@ -0,0 +1,137 @@
+/****************************************************************************
+ * File: vcfs_neg.c
+ * Remembers version extended names (foo.c,1.7) that turned out not to
+ * exist. Finding that out takes a "log" request to the CVS server, and
+ * build tools tend to ask about the same missing name over and over.
+ *
+ * Names are forgotten after VCFS_NEG_TIMEOUT seconds, so a revision
+ * committed since we looked is found eventually even without refreshes,
+ * and all of them are forgotten whenever a refresh changes anything.
+ * Names that aren't in a directory at all never get this far; see the
+ * directory bloom filters in vcfs_fh.c.
+ ***************************************************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vcfs.h"
+#include "utils.h"
+
+/* One name that wasn't there */
+typedef struct neg_entry {
+    char *name; /* NULL if the slot is free */
+    time_t when;
+    struct neg_entry *hnext;
+} neg_entry;
+
+static pthread_mutex_t neg_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Everything below is protected by neg_lock. Slots are reused in turn. */
+static neg_entry neg_slots[VCFS_NEG_SIZE];
+static neg_entry *neg_hash[VCFS_NEG_SIZE];
+static int neg_next = 0;
+
+static int neg_bucket(char *name)
+{
+    unsigned int h = 2166136261u;
+
+    while (*name != '\0')
+    {
+        h = (h ^ (unsigned char)*name++) * 16777619u;
+    }
+
+    return h % VCFS_NEG_SIZE;
+}
+
+/* Empty a slot */
+static void neg_remove(neg_entry *e)
+{
+    neg_entry **p;
+
+    for (p = &neg_hash[neg_bucket(e->name)]; *p != e; p = &(*p)->hnext)
+        ;
+    *p = e->hnext;
+
+    free(e->name);
+    e->name = NULL;
+}
+
+/* Have we been told recently that this name doesn't exist? */
+int vcfs_neg_check(char *name)
+{
+    neg_entry *e;
+    int found = 0;
+
+    pthread_mutex_lock(&neg_lock);
+
+    for (e = neg_hash[neg_bucket(name)]; e != NULL; e = e->hnext)
+    {
+        if (!strcmp(e->name, name))
+        {
+            if (time(NULL) - e->when > VCFS_NEG_TIMEOUT)
+            {
+                neg_remove(e);
+            }
+            else
+            {
+                found = 1;
+            }
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&neg_lock);
+
+    if (found)
+    {
+        DEBUG(DEBUG_M, "[vcfs_neg_check] %s is known not to exist", name);
+    }
+
+    return found;
+}
+
+/* Remember that a name doesn't exist */
+void vcfs_neg_add(char *name)
+{
+    neg_entry *e;
+    int h;
+
+    pthread_mutex_lock(&neg_lock);
+
+    e = &neg_slots[neg_next];
+    neg_next = (neg_next + 1) % VCFS_NEG_SIZE;
+
+    if (e->name != NULL)
+    {
+        neg_remove(e);
+    }
+
+    e->name = strdup(name);
+    e->when = time(NULL);
+
+    h = neg_bucket(name);
+    e->hnext = neg_hash[h];
+    neg_hash[h] = e;
+
+    pthread_mutex_unlock(&neg_lock);
+}
+
+/* Forget everything, the repository has changed */
+void vcfs_neg_clear()
+{
+    int i;
+
+    pthread_mutex_lock(&neg_lock);
+
+    for (i = 0; i < VCFS_NEG_SIZE; i++)
+    {
+        free(neg_slots[i].name);
+        neg_slots[i].name = NULL;
+        neg_hash[i] = NULL;
+    }
+
+    pthread_mutex_unlock(&neg_lock);
+}
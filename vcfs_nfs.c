@@ -15,14 +15,21 @@
 #include <dirent.h>
 #include "nfsproto.h"
 #include "vcfs.h"
+#include "vcfs_rpc.h"
 #include "utils.h"
 
 typedef struct svc_req *SR;
 
+/* The size of a READDIR reply with no entries in it: status, the end of
+ * the list and eof. And the size of an entry, not counting the name.
+ */
+#define READDIR_EMPTY (4 + 4 + 4)
+#define ENTRY_SIZE (4 + 4 + 4 + NFS_COOKIESIZE)
+
 /* Get the attributes of a virtual file */
 int get_vattr(vcfs_ventry *v, fattr *f)
 {
-    nfstime t = {v->ctime, 0};
+    nfstime t = {v->mtime, 0};
         
     if (v->type == NFDIR)
     {
@@ -89,8 +96,8 @@ nfsproc_null_2(ap,rp)
      void *ap;
      SR rp;
 {
-	static int ret=0;
-	return ((void*) &ret);
+	int *ret = &VCFS_REQ(rp)->res.nothing;
+	return ((void *)ret);
 }
 
 
@@ -103,7 +110,7 @@ nfsproc_getattr_2(ap,rp)
      SR rp;
 {
     
-    static attrstat ret;
+    attrstat *ret = &VCFS_REQ(rp)->res.attr;
     vcfs_fileid *f;
     
     //debug("getattr:\n");
@@ -114,22 +121,22 @@ nfsproc_getattr_2(ap,rp)
     {
         if (f->ventry != NULL)
         {
-            get_vattr(f->ventry, &ret.attrstat_u.attributes);
-            ret.status = NFS_OK;
+            get_vattr(f->ventry, &ret->attrstat_u.attributes);
+            ret->status = NFS_OK;
         }
         else
         {
-            rootgetattr(&ret.attrstat_u.attributes);
-            ret.status = NFS_OK;
+            rootgetattr(&ret->attrstat_u.attributes);
+            ret->status = NFS_OK;
         }
     }
     else 
     {
-        ret.status = NFSERR_NOENT;
+        ret->status = NFSERR_NOENT;
     }
     
-    //printf("   result: %d\n", ret.attrstat_u.attributes.fileid);
-    return &ret;
+    //printf("   result: %d\n", ret->attrstat_u.attributes.fileid);
+    return ret;
     
 }
 
@@ -138,10 +145,10 @@ nfsproc_setattr_2(ap,rp)
      sattrargs *ap;
      SR rp;
 {
-	static attrstat ret;
+	attrstat *ret = &VCFS_REQ(rp)->res.attr;
     
-	ret.status = NFSERR_NOENT;
-	return &ret;
+	ret->status = NFSERR_NOENT;
+	return ret;
 
 }
 
@@ -150,9 +157,9 @@ nfsproc_root_2(ap,rp)
      void *ap;
      SR rp;
 {
-	static int ret=0;
+	int *ret = &VCFS_REQ(rp)->res.nothing;
 	
-	return ((void*)&ret);
+	return ((void *)ret);
 }
 
 
@@ -163,7 +170,7 @@ nfsproc_lookup_2(ap,rp)
 {
     vcfs_fileid *parent;
     vcfs_fileid *f;
-    static diropres ret;
+    diropres *ret = &VCFS_REQ(rp)->res.dirop;
     vcfs_fhdata *hand;
     
     //printf("lookup %s in\n",ap->name);
@@ -173,26 +180,26 @@ nfsproc_lookup_2(ap,rp)
     
     if (parent == NULL)
     {
-        ret.status = NFSERR_NOENT;
-        return (&ret);
+        ret->status = NFSERR_NOENT;
+        return ret;
     }
     
-    hand = (vcfs_fhdata *)&ret.diropres_u.diropres.file;
+    hand = (vcfs_fhdata *)&ret->diropres_u.diropres.file;
     f = (vcfs_fileid *)lookuph(parent, ap->name, hand); 
     
     if (f == NULL)
     {
-        ret.status = NFSERR_NOENT;
+        ret->status = NFSERR_NOENT;
         //printf("\tCouldn't find %s...\n", ap->name);
-        return &ret;
+        return ret;
     }
     
     /* We found the file, now get it's attributes and return it */
     ASSERT(f->ventry != NULL, "File does not have a ventry");
-    get_vattr(f->ventry, &ret.diropres_u.diropres.attributes);
+    get_vattr(f->ventry, &ret->diropres_u.diropres.attributes);
     
-    ret.status = NFS_OK;
-    return &ret;
+    ret->status = NFS_OK;
+    return ret;
 }
 
 readlinkres *
@@ -200,9 +207,9 @@ nfsproc_readlink_2(ap,rp)
      nfs_fh *ap;
      SR rp;
 {
-    static readlinkres ret;
-    ret.status = NFSERR_NOENT;
-    return &ret;
+    readlinkres *ret = &VCFS_REQ(rp)->res.readlink;
+    ret->status = NFSERR_NOENT;
+    return ret;
 }
 
 
@@ -210,31 +217,38 @@ nfsproc_readlink_2(ap,rp)
 readres *
 nfsproc_read_2(readargs *ap, SR rp)
 {
-    static readres ret;
-    static char buffer[8192];
+    readres *ret = &VCFS_REQ(rp)->res.read;
+    vcfs_ventry attr;
     int len;
-    vcfs_fileid *h;
-    
-    len = vcfs_read(buffer, (vcfs_fhdata *)&ap->file, ap->count, ap->offset);
     
-    if (len < 0)
+    if (ap->count > NFS_MAXDATA)
     {
-        ret.status = NFSERR_NOENT;
-        return &ret;
+        ap->count = NFS_MAXDATA;
     }
     
-    ret.readres_u.reply.data.data_len = len;
-    ret.readres_u.reply.data.data_val = buffer;
-
-    h = (vcfs_fileid *)get_fh((vcfs_fhdata *)&ap->file);
+    len = vcfs_read((vcfs_fhdata *)&ap->file, ap->count, ap->offset, rp,
+                    &attr);
     
-    if (h != NULL && h->ventry != NULL)
+    if (len == VCFS_READ_DEFERRED)
     {
-        get_vattr(h->ventry, &ret.readres_u.reply.attributes);
+        /* Sent when the file arrives. The request isn't ours any more. */
+        return NULL;
     }
     
-    ret.status = NFS_OK;
-    return &ret;
+    if (len < 0)
+    {
+        ret->status = NFSERR_NOENT;
+        return ret;
+    }
+    
+    /* The data follows the encoded reply, straight from the cache */
+    ret->readres_u.reply.data.data_len = 0;
+    ret->readres_u.reply.data.data_val = NULL;
+
+    get_vattr(&attr, &ret->readres_u.reply.attributes);
+    
+    ret->status = NFS_OK;
+    return ret;
     
 }
 
@@ -244,9 +258,9 @@ nfsproc_writecache_2(ap,rp)
      void *ap;
      SR rp;
 {
-	static int ret;
+	int *ret = &VCFS_REQ(rp)->res.nothing;
 
-	return (void *)(&ret);
+	return (void *)ret;
 }
 
 
@@ -255,10 +269,10 @@ nfsproc_write_2(ap,rp)
      writeargs *ap;
      SR rp;
 {
-	static attrstat ret;
+	attrstat *ret = &VCFS_REQ(rp)->res.attr;
 
-	ret.status = NFSERR_ACCES;
-	return &ret;
+	ret->status = NFSERR_ACCES;
+	return ret;
 
 }
 
@@ -268,10 +282,10 @@ nfsproc_create_2(ap,rp)
      createargs *ap;
      SR rp;
 {
-	static diropres ret;
+	diropres *ret = &VCFS_REQ(rp)->res.dirop;
 
-	ret.status = NFSERR_ACCES;
-	return &ret;
+	ret->status = NFSERR_ACCES;
+	return ret;
 
 }
 
@@ -281,10 +295,10 @@ nfsproc_remove_2(ap,rp)
      diropargs *ap;
      SR rp;
 {
-	static nfsstat ret;
+	nfsstat *ret = &VCFS_REQ(rp)->res.stat;
 
-	ret = NFSERR_ACCES;
-	return &ret;
+	*ret = NFSERR_ACCES;
+	return ret;
 	
 }
 
@@ -294,10 +308,10 @@ nfsproc_rename_2(ap,rp)
      renameargs *ap;
      SR rp;
 {
-	static nfsstat ret;
+	nfsstat *ret = &VCFS_REQ(rp)->res.stat;
 
-	ret = NFSERR_ACCES;
-	return &ret;
+	*ret = NFSERR_ACCES;
+	return ret;
 
 }
 
@@ -307,10 +321,10 @@ nfsproc_link_2(ap,rp)
      linkargs *ap;
      SR rp;
 {
-	static nfsstat ret;
+	nfsstat *ret = &VCFS_REQ(rp)->res.stat;
 
-	ret = NFSERR_ACCES;
-	return &ret;
+	*ret = NFSERR_ACCES;
+	return ret;
 
 }
 
@@ -320,10 +334,10 @@ nfsproc_symlink_2(ap,rp)
      symlinkargs *ap;
      SR rp;
 {
-	static nfsstat ret;
+	nfsstat *ret = &VCFS_REQ(rp)->res.stat;
 
-	ret = NFSERR_NOENT;
-	return &ret;
+	*ret = NFSERR_NOENT;
+	return ret;
 
 }
 
@@ -332,10 +346,10 @@ nfsproc_mkdir_2(ap,rp)
      createargs *ap;
      SR rp;
 {
-	static diropres ret;
+	diropres *ret = &VCFS_REQ(rp)->res.dirop;
 
-	ret.status = NFSERR_ACCES;
-	return &ret;
+	ret->status = NFSERR_ACCES;
+	return ret;
 
 }
 
@@ -345,16 +359,13 @@ nfsproc_rmdir_2(ap,rp)
      diropargs *ap;
      SR rp;
 {
-	static nfsstat ret;
+	nfsstat *ret = &VCFS_REQ(rp)->res.stat;
 
-	ret = NFSERR_ACCES;
-	return &ret;
+	*ret = NFSERR_ACCES;
+	return ret;
 	
 }
 
-/* This is found in cvsfs_fh.c */
-extern vcfs_ventry *ventry_list;
-
 void dump_entries(entry *e)
 {
     entry *next;
@@ -374,160 +385,78 @@ nfsproc_readdir_2(ap,rp)
      readdirargs *ap;
      SR rp;
 {
-
-    static readdirres ret;
-    static entry entrytab[256];	/* TODO: Change to dynamic */
-    static vcfs_name names[256];
+    readdirres *ret = &VCFS_REQ(rp)->res.readdir;
+    entry *entrytab = VCFS_REQ(rp)->entries.v2;
     entry **prev;
-    long cookie;
+    vcfs_dir_cursor c;
     vcfs_fileid *h;
-    vcfs_ventry *temp;
-    vcfs_path parent;
-    vcfs_name entry;
+    vcfs_ventry *v;
+    char *name;
+    u_int cookie;
+    int fileid;
+    int count = 0;
+    int size = READDIR_EMPTY;
+    int max;
 
-    strcpy(names[0], ".");
-    strcpy(names[1], "..");
-    
     h = get_fh((vcfs_fhdata *)&ap->dir);
-    ret.readdirres_u.reply.eof = TRUE;
 
-    prev = &ret.readdirres_u.reply.entries;
-    *prev = NULL;
+    if (h == NULL)
+    {
+        /* Probably removed from the repository since the client looked */
+        ret->status = NFSERR_STALE;
+        return ret;
+    }
 
-    ASSERT(h != NULL, "Trying to read from NULL filehandle");
-    
-    DEBUG(DEBUG_L, "[nfsproc_readdir_2] read %s, cookie is %d\n", 
-          h->ventry->name, (*(long *)ap->cookie));
-    
-    if (h->id == 0)
+    if (h->ventry != NULL && h->ventry->type != NFDIR)
     {
-        /* Read the root dir */
-        entrytab[0].fileid = 1;
-        entrytab[0].name = names[0];
-        cookie = 0;
-        memcpy(entrytab[0].cookie, &cookie, sizeof(long));
-        *prev = &entrytab[0];
-        prev = &entrytab[0].nextentry;
-        entrytab[0].nextentry = NULL;
-        
-        entrytab[1].fileid = 1;
-        cookie = 1;
-        memcpy(entrytab[1].cookie, &cookie, sizeof(long));
-        entrytab[1].name = names[1];
-        *prev = &entrytab[1];
-        prev = &entrytab[1].nextentry;
-        entrytab[1].nextentry = NULL;
-        
-        entrytab[2].fileid = ventry_list->id;
-        cookie = 1;
-        memcpy(entrytab[2].cookie, &cookie, sizeof(long));
-        strcpy(names[2], ventry_list->name);
-        entrytab[2].name = names[2];
-        *prev = &entrytab[2];
-        prev = &entrytab[2].nextentry;
-        entrytab[2].nextentry = NULL;
-        
-        ret.readdirres_u.reply.eof = TRUE;
-        ret.status = NFS_OK;
-        return &ret;
+        ret->status = NFSERR_NOTDIR;
+        return ret;
     }
-    
-    if (*ap->cookie == 0)
+
+    /* The cookie is ours, it's just the position in the directory */
+    memcpy(&cookie, ap->cookie, sizeof(cookie));
+
+    DEBUG(DEBUG_L, "[nfsproc_readdir_2] read %s, cookie is %u\n", 
+          h->name, cookie);
+
+    max = ap->count;
+    if (max > NFS_MAXDATA)
     {
-        /* Return . (ap->dir) */
-        entrytab[0].fileid = h->id;
-        entrytab[0].name = names[0];
-        cookie = h->id;
-        memcpy(entrytab[0].cookie, &cookie, sizeof(nfscookie));
-        *prev = &entrytab[0];
-        prev = &entrytab[0].nextentry;
-        entrytab[0].nextentry = NULL;
-        
-        /* Return .. */
-        if (h->ventry != NULL && h->ventry == ventry_list)
-        {
-            /* The parent is the root */
-            entrytab[1].fileid = 1;
-            cookie = 0;
-            memcpy(entrytab[1].cookie, &cookie, sizeof(long));
-            entrytab[1].name = names[1];
-            *prev = &entrytab[1];
-            prev = &entrytab[1].nextentry;
-            entrytab[1].nextentry = NULL;
-        }
-        else
-        {
-            /* Get the parent */
-            vcfs_fileid *p;
-            
-            split_path(h->name, &parent, &entry);
-            p = (vcfs_fileid *)lookup_fh_name(parent);
-            
-            ASSERT(p != NULL, "The direntry doesn't have a parent");
-            
-            entrytab[1].fileid = p->id;
-            cookie = 1;
-            memcpy(entrytab[1].cookie, &cookie, sizeof(long));
-            entrytab[1].name = names[1];
-            *prev = &entrytab[1];
-            prev = &entrytab[1].nextentry;
-            entrytab[1].nextentry = NULL;
-        }
+        max = NFS_MAXDATA;
     }
-    
-    ret.readdirres_u.reply.eof = TRUE;
-    /* Now get the rest of the files */
-    if (h->ventry != NULL)
+
+    prev = &ret->readdirres_u.reply.entries;
+    *prev = NULL;
+    ret->readdirres_u.reply.eof = TRUE;
+
+    vcfs_dir_seek(&c, h, cookie);
+
+    while (vcfs_dir_next(&c, &name, &fileid, &v))
     {
-        int count = 0;
-        int j = 2;
-        cookie = 2;
-        
-        if (*ap->cookie == 0)
+        /* Only return as much as the client asked for, but always at least
+         * one entry, there's no way to tell it that's too small
+         */
+        size += ENTRY_SIZE + RNDUP(strlen(name));
+        if ((size > max && count > 0) || count == VCFS_READDIR_MAX)
         {
-            count = 2;
+            ret->readdirres_u.reply.eof = FALSE;
+            break;
         }
 
-        for (temp = h->ventry->dirent; temp != NULL; temp = temp->next)
-        {
-            split_path(temp->name, &parent, &entry);
-            
-            /* Skip entries until we reach the cookie */
-            if (*(long *)ap->cookie > 0 && (cookie - 1) < *(long *)ap->cookie)
-            {
-                cookie++;
-                j++;
-                continue;
-            }
-
-            /* Skip filenames containing a comma - ver extended name */
-            if (strrchr(entry, ','))
-                continue;
-            
-            entrytab[count].fileid = temp->id;
-            cookie = j; 
-            memcpy(entrytab[count].cookie, &cookie, sizeof(nfscookie));
-            strcpy(names[count], entry);
-            entrytab[count].name = names[count];
-            *prev = &entrytab[count];
-            prev = &entrytab[count].nextentry;
-            entrytab[count].nextentry = NULL;
-
-            count++;
-            j++;
-            
-            /* Only return 256 entries at a time */
-            if (count == 256)
-            {
-                ret.readdirres_u.reply.eof = FALSE;
-                break;
-            }
-        }
+        entrytab[count].fileid = fileid;
+        entrytab[count].name = name;
+        cookie = c.pos;
+        memcpy(entrytab[count].cookie, &cookie, sizeof(nfscookie));
+        entrytab[count].nextentry = NULL;
+        *prev = &entrytab[count];
+        prev = &entrytab[count].nextentry;
+
+        count++;
     }
     
-    //dump_entries(ret.readdirres_u.reply.entries);
-    ret.status = NFS_OK;
-    return &ret;
+    //dump_entries(ret->readdirres_u.reply.entries);
+    ret->status = NFS_OK;
+    return ret;
 }
 
 statfsres *
@@ -535,10 +464,10 @@ nfsproc_statfs_2(ap,rp)
     nfs_fh *ap;
     SR rp;
 {
-	static statfsres ret;
+	statfsres *ret = &VCFS_REQ(rp)->res.statfs;
 
-	ret.status = NFSERR_NOENT;
-	return &ret;
+	ret->status = NFSERR_NOENT;
+	return ret;
 
 }
 
@@ -0,0 +1,631 @@
+/****************************************************************************
+ * Filename: vcfs_nfs3.c
+ * The NFS version 3 side of the server. It works from the same namespace,
+ * filehandles and file cache as version 2 (see vcfs_nfs.c); what version 3
+ * buys us is bigger READs, 64 bit sizes and cookies, and READDIRPLUS,
+ * which hands back the attributes and handles of a whole directory at
+ * once instead of making the client LOOKUP every name in it.
+ *
+ * Our handles are the same 32 bytes as in version 2. Anything else the
+ * client gives us (like the handle mountd made for the mount point) is
+ * taken to be the root, just as it is in version 2.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <rpc/rpc.h>
+#include "nfs3proto.h"
+#include "vcfs.h"
+#include "vcfs_rpc.h"
+#include "utils.h"
+
+typedef struct svc_req *SR;
+
+/* The size of a READDIR reply with no entries in it: status, directory
+ * attributes, cookie verifier, the end of the list and eof */
+#define READDIR3_EMPTY (4 + 4 + 84 + NFS3_COOKIEVERFSIZE + 4 + 4)
+
+/* The size of an entry in a READDIR reply, not counting the name, and
+ * what a READDIRPLUS entry adds to that */
+#define ENTRY3_SIZE (4 + 8 + 4 + 8)
+#define ENTRYPLUS3_EXTRA (4 + 84 + 4 + 4 + NFS_FHSIZE)
+
+/* Pad a version 3 filehandle out to a version 2 one */
+static void fh3_to_fh(nfs_fh3 *fh3, nfs_fh *fh)
+{
+    int len = fh3->data.data_len;
+
+    if (len > NFS_FHSIZE)
+    {
+        len = NFS_FHSIZE;
+    }
+
+    memset(fh, 0, sizeof(nfs_fh));
+    memcpy(fh, fh3->data.data_val, len);
+}
+
+/* Look up a version 3 filehandle */
+static vcfs_fileid *get_fh3(nfs_fh3 *fh3)
+{
+    nfs_fh fh;
+
+    fh3_to_fh(fh3, &fh);
+    return get_fh((vcfs_fhdata *)&fh);
+}
+
+/* Get the version 3 attributes of a file, or of the root dir if v is NULL */
+static void get_vattr3(vcfs_ventry *v, fattr3 *f)
+{
+    fattr a;
+
+    if (v != NULL)
+    {
+        get_vattr(v, &a);
+    }
+    else
+    {
+        rootgetattr(&a);
+    }
+
+    f->type = (a.type == NFDIR) ? NF3DIR : NF3REG;
+    f->mode = a.mode & 07777;
+    f->nlink = a.nlink;
+    f->uid = a.uid;
+    f->gid = a.gid;
+    f->size = a.size;
+    f->used = (size3)a.blocks * 512;
+    f->rdev.specdata1 = 0;
+    f->rdev.specdata2 = 0;
+    f->fsid = a.fsid;
+    f->fileid = a.fileid;
+    f->atime.seconds = a.atime.seconds;
+    f->atime.nseconds = a.atime.useconds * 1000;
+    f->mtime.seconds = a.mtime.seconds;
+    f->mtime.nseconds = a.mtime.useconds * 1000;
+    f->ctime.seconds = a.ctime.seconds;
+    f->ctime.nseconds = a.ctime.useconds * 1000;
+}
+
+/* Fill in the attributes that follow a result, if we know the file */
+static void get_post_op_attr(vcfs_fileid *f, post_op_attr *p)
+{
+    if (f == NULL)
+    {
+        p->attributes_follow = FALSE;
+        return;
+    }
+
+    p->attributes_follow = TRUE;
+    get_vattr3(f->ventry, &p->post_op_attr_u.attributes);
+}
+
+/* Is this a directory? The root has no ventry */
+static int is_dir3(vcfs_fileid *f)
+{
+    return f->ventry == NULL || f->ventry->type == NFDIR;
+}
+
+/* What we send back for anything that would change the filesystem */
+static WCC3res *rofs3(SR rp)
+{
+    WCC3res *ret = &VCFS_REQ(rp)->res.wcc3;
+
+    ret->status = NFS3ERR_ROFS;
+    ret->wcc.before.attributes_follow = FALSE;
+    ret->wcc.after.attributes_follow = FALSE;
+    return ret;
+}
+
+
+void *
+nfsproc3_null_3(void *ap, SR rp)
+{
+    int *ret = &VCFS_REQ(rp)->res.nothing;
+    return ((void *)ret);
+}
+
+GETATTR3res *
+nfsproc3_getattr_3(nfs_fh3 *ap, SR rp)
+{
+    GETATTR3res *ret = &VCFS_REQ(rp)->res.getattr3;
+    vcfs_fileid *f;
+
+    f = get_fh3(ap);
+
+    if (f == NULL)
+    {
+        ret->status = NFS3ERR_STALE;
+        return ret;
+    }
+
+    get_vattr3(f->ventry, &ret->GETATTR3res_u.resok.obj_attributes);
+    ret->status = NFS3_OK;
+    return ret;
+}
+
+WCC3res *
+nfsproc3_setattr_3(void *ap, SR rp)
+{
+    return rofs3(rp);
+}
+
+LOOKUP3res *
+nfsproc3_lookup_3(diropargs3 *ap, SR rp)
+{
+    LOOKUP3res *ret = &VCFS_REQ(rp)->res.lookup3;
+    nfs_fh *hand = &VCFS_REQ(rp)->handles[0];
+    vcfs_fileid *parent;
+    vcfs_fileid *f;
+
+    parent = get_fh3(&ap->dir);
+
+    if (parent == NULL)
+    {
+        ret->status = NFS3ERR_STALE;
+        ret->LOOKUP3res_u.resfail.dir_attributes.attributes_follow = FALSE;
+        return ret;
+    }
+
+    memset(hand, 0, sizeof(nfs_fh));
+    f = lookuph(parent, ap->name, (vcfs_fhdata *)hand);
+
+    if (f == NULL)
+    {
+        ret->status = NFS3ERR_NOENT;
+        get_post_op_attr(parent,
+                         &ret->LOOKUP3res_u.resfail.dir_attributes);
+        return ret;
+    }
+
+    ASSERT(f->ventry != NULL, "File does not have a ventry");
+
+    ret->LOOKUP3res_u.resok.object.data.data_len = NFS_FHSIZE;
+    ret->LOOKUP3res_u.resok.object.data.data_val = (char *)hand;
+    get_post_op_attr(f, &ret->LOOKUP3res_u.resok.obj_attributes);
+    get_post_op_attr(parent, &ret->LOOKUP3res_u.resok.dir_attributes);
+
+    ret->status = NFS3_OK;
+    return ret;
+}
+
+ACCESS3res *
+nfsproc3_access_3(ACCESS3args *ap, SR rp)
+{
+    ACCESS3res *ret = &VCFS_REQ(rp)->res.access3;
+    vcfs_fileid *f;
+    uint32 allowed;
+
+    f = get_fh3(&ap->object);
+
+    if (f == NULL)
+    {
+        ret->status = NFS3ERR_STALE;
+        ret->ACCESS3res_u.resfail.obj_attributes.attributes_follow = FALSE;
+        return ret;
+    }
+
+    /* Everything is read only */
+    allowed = ACCESS3_READ;
+    if (is_dir3(f))
+    {
+        allowed |= ACCESS3_LOOKUP;
+    }
+
+    get_post_op_attr(f, &ret->ACCESS3res_u.resok.obj_attributes);
+    ret->ACCESS3res_u.resok.access = ap->access & allowed;
+    ret->status = NFS3_OK;
+    return ret;
+}
+
+READLINK3res *
+nfsproc3_readlink_3(nfs_fh3 *ap, SR rp)
+{
+    READLINK3res *ret = &VCFS_REQ(rp)->res.readlink3;
+
+    /* There are no symlinks */
+    get_post_op_attr(get_fh3(ap),
+                     &ret->READLINK3res_u.resfail.symlink_attributes);
+    ret->status = NFS3ERR_INVAL;
+    return ret;
+}
+
+READ3res *
+nfsproc3_read_3(READ3args *ap, SR rp)
+{
+    READ3res *ret = &VCFS_REQ(rp)->res.read3;
+    nfs_fh fh;
+    vcfs_fileid *h;
+    vcfs_ventry attr;
+    int count;
+    int len;
+
+    fh3_to_fh(&ap->file, &fh);
+    h = get_fh((vcfs_fhdata *)&fh);
+
+    if (h == NULL)
+    {
+        ret->status = NFS3ERR_STALE;
+        ret->READ3res_u.resfail.file_attributes.attributes_follow = FALSE;
+        return ret;
+    }
+
+    if (is_dir3(h))
+    {
+        ret->status = NFS3ERR_ISDIR;
+        get_post_op_attr(h, &ret->READ3res_u.resfail.file_attributes);
+        return ret;
+    }
+
+    count = ap->count;
+    if (ap->count > VCFS_NFS3_MAXDATA)
+    {
+        count = VCFS_NFS3_MAXDATA;
+    }
+
+    if (ap->offset > 0x7fffffff)
+    {
+        /* Our files are never that big */
+        memcpy(&attr, h->ventry, sizeof(vcfs_ventry));
+        len = 0;
+    }
+    else
+    {
+        len = vcfs_read((vcfs_fhdata *)&fh, count, (int)ap->offset, rp,
+                        &attr);
+    }
+
+    if (len == VCFS_READ_DEFERRED)
+    {
+        /* Sent when the file arrives. The request isn't ours any more. */
+        return NULL;
+    }
+
+    if (len < 0)
+    {
+        ret->status = NFS3ERR_IO;
+        get_post_op_attr(h, &ret->READ3res_u.resfail.file_attributes);
+        return ret;
+    }
+
+    ret->READ3res_u.resok.count = len;
+    ret->READ3res_u.resok.eof = (ap->offset + len >= attr.size);
+    /* The data follows the encoded reply, straight from the cache */
+    ret->READ3res_u.resok.data.data_len = 0;
+    ret->READ3res_u.resok.data.data_val = NULL;
+
+    ret->READ3res_u.resok.file_attributes.attributes_follow = TRUE;
+    get_vattr3(&attr,
+               &ret->READ3res_u.resok.file_attributes.post_op_attr_u.attributes);
+
+    ret->status = NFS3_OK;
+    return ret;
+}
+
+WCC3res *
+nfsproc3_write_3(void *ap, SR rp)
+{
+    return rofs3(rp);
+}
+
+WCC3res *
+nfsproc3_create_3(void *ap, SR rp)
+{
+    return rofs3(rp);
+}
+
+WCC3res *
+nfsproc3_mkdir_3(void *ap, SR rp)
+{
+    return rofs3(rp);
+}
+
+WCC3res *
+nfsproc3_symlink_3(void *ap, SR rp)
+{
+    return rofs3(rp);
+}
+
+WCC3res *
+nfsproc3_mknod_3(void *ap, SR rp)
+{
+    return rofs3(rp);
+}
+
+WCC3res *
+nfsproc3_remove_3(void *ap, SR rp)
+{
+    return rofs3(rp);
+}
+
+WCC3res *
+nfsproc3_rmdir_3(void *ap, SR rp)
+{
+    return rofs3(rp);
+}
+
+RENAME3res *
+nfsproc3_rename_3(void *ap, SR rp)
+{
+    RENAME3res *ret = &VCFS_REQ(rp)->res.rename3;
+
+    ret->status = NFS3ERR_ROFS;
+    ret->fromdir_wcc.before.attributes_follow = FALSE;
+    ret->fromdir_wcc.after.attributes_follow = FALSE;
+    ret->todir_wcc.before.attributes_follow = FALSE;
+    ret->todir_wcc.after.attributes_follow = FALSE;
+    return ret;
+}
+
+LINK3res *
+nfsproc3_link_3(void *ap, SR rp)
+{
+    LINK3res *ret = &VCFS_REQ(rp)->res.link3;
+
+    ret->status = NFS3ERR_ROFS;
+    ret->file_attributes.attributes_follow = FALSE;
+    ret->linkdir_wcc.before.attributes_follow = FALSE;
+    ret->linkdir_wcc.after.attributes_follow = FALSE;
+    return ret;
+}
+
+READDIR3res *
+nfsproc3_readdir_3(READDIR3args *ap, SR rp)
+{
+    READDIR3res *ret = &VCFS_REQ(rp)->res.readdir3;
+    READDIR3resok *ok = &ret->READDIR3res_u.resok;
+    entry3 *entrytab = VCFS_REQ(rp)->entries.v3;
+    entry3 **prev;
+    vcfs_dir_cursor c;
+    vcfs_fileid *h;
+    vcfs_ventry *v;
+    char *name;
+    int fileid;
+    int count = 0;
+    int size = READDIR3_EMPTY;
+    int max;
+
+    h = get_fh3(&ap->dir);
+
+    if (h == NULL || !is_dir3(h))
+    {
+        ret->status = (h == NULL) ? NFS3ERR_STALE : NFS3ERR_NOTDIR;
+        get_post_op_attr(h, &ret->READDIR3res_u.resfail.dir_attributes);
+        return ret;
+    }
+
+    max = ap->count;
+    if (max > VCFS_NFS3_MAXDATA)
+    {
+        max = VCFS_NFS3_MAXDATA;
+    }
+
+    get_post_op_attr(h, &ok->dir_attributes);
+    memset(ok->cookieverf, 0, NFS3_COOKIEVERFSIZE);
+    prev = &ok->reply.entries;
+    *prev = NULL;
+    ok->reply.eof = TRUE;
+
+    vcfs_dir_seek(&c, h, ap->cookie);
+
+    while (vcfs_dir_next(&c, &name, &fileid, &v))
+    {
+        /* Only return as much as the client asked for */
+        size += ENTRY3_SIZE + RNDUP(strlen(name));
+        if (size > max || count == VCFS_READDIR_MAX)
+        {
+            ok->reply.eof = FALSE;
+            break;
+        }
+
+        entrytab[count].fileid = fileid;
+        entrytab[count].name = name;
+        entrytab[count].cookie = c.pos;
+        entrytab[count].nextentry = NULL;
+        *prev = &entrytab[count];
+        prev = &entrytab[count].nextentry;
+
+        count++;
+    }
+
+    if (count == 0 && !ok->reply.eof)
+    {
+        ret->status = NFS3ERR_TOOSMALL;
+        return ret;
+    }
+
+    ret->status = NFS3_OK;
+    return ret;
+}
+
+READDIRPLUS3res *
+nfsproc3_readdirplus_3(READDIRPLUS3args *ap, SR rp)
+{
+    READDIRPLUS3res *ret = &VCFS_REQ(rp)->res.readdirplus3;
+    READDIRPLUS3resok *ok = &ret->READDIRPLUS3res_u.resok;
+    entryplus3 *entrytab = VCFS_REQ(rp)->entries.plus;
+    nfs_fh *handles = VCFS_REQ(rp)->handles;
+    entryplus3 **prev;
+    vcfs_dir_cursor c;
+    vcfs_fileid *h;
+    vcfs_fileid *f;
+    vcfs_ventry *v;
+    char *name;
+    vcfs_fhdata *fh;
+    int fileid;
+    int count = 0;
+    int dirsize = 0;
+    int size = READDIR3_EMPTY;
+    int max;
+
+    h = get_fh3(&ap->dir);
+
+    if (h == NULL || !is_dir3(h))
+    {
+        ret->status = (h == NULL) ? NFS3ERR_STALE : NFS3ERR_NOTDIR;
+        get_post_op_attr(h, &ret->READDIRPLUS3res_u.resfail.dir_attributes);
+        return ret;
+    }
+
+    max = ap->maxcount;
+    if (max > VCFS_NFS3_MAXDATA)
+    {
+        max = VCFS_NFS3_MAXDATA;
+    }
+
+    get_post_op_attr(h, &ok->dir_attributes);
+    memset(ok->cookieverf, 0, NFS3_COOKIEVERFSIZE);
+    prev = &ok->reply.entries;
+    *prev = NULL;
+    ok->reply.eof = TRUE;
+
+    vcfs_dir_seek(&c, h, ap->cookie);
+
+    while (vcfs_dir_next(&c, &name, &fileid, &v))
+    {
+        /* dircount is just the names and cookies, maxcount is everything */
+        dirsize += ENTRY3_SIZE + RNDUP(strlen(name));
+        size += ENTRY3_SIZE + RNDUP(strlen(name)) + ENTRYPLUS3_EXTRA;
+        if (size > max || dirsize > ap->dircount ||
+            count == VCFS_READDIRPLUS_MAX)
+        {
+            ok->reply.eof = FALSE;
+            break;
+        }
+
+        entrytab[count].fileid = fileid;
+        entrytab[count].name = name;
+        entrytab[count].cookie = c.pos;
+        entrytab[count].name_attributes.attributes_follow = FALSE;
+        entrytab[count].name_handle.handle_follows = FALSE;
+
+        /* The client has to LOOKUP "." and ".." itself */
+        f = (v != NULL) ? lookup_fh_name(v->name) : NULL;
+        if (f != NULL)
+        {
+            memset(&handles[count], 0, sizeof(nfs_fh));
+            fh = (vcfs_fhdata *)&handles[count];
+            fh->magic = MAGICNUM;
+            fh->id = f->id;
+            fh->key = hash(f->name);
+
+            get_post_op_attr(f, &entrytab[count].name_attributes);
+            entrytab[count].name_handle.handle_follows = TRUE;
+            entrytab[count].name_handle.post_op_fh3_u.handle.data.data_len =
+                NFS_FHSIZE;
+            entrytab[count].name_handle.post_op_fh3_u.handle.data.data_val =
+                (char *)&handles[count];
+        }
+
+        entrytab[count].nextentry = NULL;
+        *prev = &entrytab[count];
+        prev = &entrytab[count].nextentry;
+
+        count++;
+    }
+
+    if (count == 0 && !ok->reply.eof)
+    {
+        ret->status = NFS3ERR_TOOSMALL;
+        return ret;
+    }
+
+    ret->status = NFS3_OK;
+    return ret;
+}
+
+FSSTAT3res *
+nfsproc3_fsstat_3(nfs_fh3 *ap, SR rp)
+{
+    FSSTAT3res *ret = &VCFS_REQ(rp)->res.fsstat3;
+    FSSTAT3resok *ok = &ret->FSSTAT3res_u.resok;
+    vcfs_fileid *f;
+
+    f = get_fh3(ap);
+
+    if (f == NULL)
+    {
+        ret->status = NFS3ERR_STALE;
+        ret->FSSTAT3res_u.resfail.obj_attributes.attributes_follow = FALSE;
+        return ret;
+    }
+
+    /* Nothing here takes up any space, and there is no room for more */
+    get_post_op_attr(f, &ok->obj_attributes);
+    ok->tbytes = 0;
+    ok->fbytes = 0;
+    ok->abytes = 0;
+    ok->tfiles = 0;
+    ok->ffiles = 0;
+    ok->afiles = 0;
+    ok->invarsec = 0;
+
+    ret->status = NFS3_OK;
+    return ret;
+}
+
+FSINFO3res *
+nfsproc3_fsinfo_3(nfs_fh3 *ap, SR rp)
+{
+    FSINFO3res *ret = &VCFS_REQ(rp)->res.fsinfo3;
+    FSINFO3resok *ok = &ret->FSINFO3res_u.resok;
+    vcfs_fileid *f;
+
+    f = get_fh3(ap);
+
+    if (f == NULL)
+    {
+        ret->status = NFS3ERR_STALE;
+        ret->FSINFO3res_u.resfail.obj_attributes.attributes_follow = FALSE;
+        return ret;
+    }
+
+    get_post_op_attr(f, &ok->obj_attributes);
+    ok->rtmax = VCFS_NFS3_MAXDATA;
+    ok->rtpref = VCFS_NFS3_MAXDATA;
+    ok->rtmult = 512;
+    ok->wtmax = VCFS_NFS3_MAXDATA;
+    ok->wtpref = VCFS_NFS3_MAXDATA;
+    ok->wtmult = 512;
+    ok->dtpref = VCFS_NFS3_MAXDATA;
+    ok->maxfilesize = 0x7fffffff;
+    ok->time_delta.seconds = 1;
+    ok->time_delta.nseconds = 0;
+    ok->properties = FSF3_HOMOGENEOUS;
+
+    ret->status = NFS3_OK;
+    return ret;
+}
+
+PATHCONF3res *
+nfsproc3_pathconf_3(nfs_fh3 *ap, SR rp)
+{
+    PATHCONF3res *ret = &VCFS_REQ(rp)->res.pathconf3;
+    PATHCONF3resok *ok = &ret->PATHCONF3res_u.resok;
+    vcfs_fileid *f;
+
+    f = get_fh3(ap);
+
+    if (f == NULL)
+    {
+        ret->status = NFS3ERR_STALE;
+        ret->PATHCONF3res_u.resfail.obj_attributes.attributes_follow = FALSE;
+        return ret;
+    }
+
+    get_post_op_attr(f, &ok->obj_attributes);
+    ok->linkmax = 1;
+    ok->name_max = NFS_MAXNAMLEN;
+    ok->no_trunc = TRUE;
+    ok->chown_restricted = TRUE;
+    ok->case_insensitive = FALSE;
+    ok->case_preserving = TRUE;
+
+    ret->status = NFS3_OK;
+    return ret;
+}
+
+WCC3res *
+nfsproc3_commit_3(void *ap, SR rp)
+{
+    return rofs3(rp);
+}
@@ -0,0 +1,396 @@
+/****************************************************************************
+ * File: vcfs_ns.c
+ * The namespace (the hash table of fileids and the ventry tree hanging off
+ * of it) is versioned, so that nobody ever sees it half-updated.
+ *
+ * Readers pin the current version with vcfs_ns_enter() for the length of a
+ * request. Writers (loading the project, a refresh, 'cvstool update') open
+ * a transaction with vcfs_ns_begin(), which gives them a private copy of
+ * the hash buckets. Any fileid or ventry they want to change is copied
+ * first, along with the directories between it and the top of the project.
+ * vcfs_ns_commit() then publishes the new version with one pointer swap.
+ *
+ * The copies that were replaced are freed once every reader that might
+ * still be looking at them has gone away. Each reader records the epoch it
+ * started in; anything retired before the oldest active reader started
+ * can't be reached by anyone.
+ ***************************************************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "vcfs.h"
+#include "utils.h"
+
+/* Something waiting for its readers to go away before it can be freed */
+typedef struct ns_limbo {
+    void *p;
+    unsigned long epoch;
+    struct ns_limbo *next;
+} ns_limbo;
+
+/* The namespace before anything has been loaded */
+static vcfs_ns ns_empty;
+
+/* The published namespace */
+static vcfs_ns *volatile ns_current = &ns_empty;
+
+/* The epoch each reader started in, or 0 if it isn't reading */
+static volatile unsigned long ns_readers[VCFS_NS_MAX_READERS];
+static int ns_nreaders = 0;
+static volatile unsigned long ns_epoch = 1;
+
+/* Per thread reader state */
+static __thread int ns_slot = -1;
+static __thread int ns_depth = 0;
+static __thread vcfs_ns *ns_pinned = NULL;
+
+/* There is only ever one writer. Everything below is protected by
+ * ns_write_lock.
+ */
+static pthread_mutex_t ns_write_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread int ns_txn_depth = 0;
+static vcfs_ns *ns_txn = NULL;
+static ns_limbo *ns_txn_retired = NULL;
+static ns_limbo *ns_limbo_list = NULL;
+
+/* Free everything that no reader can see anymore */
+static void ns_reclaim()
+{
+    unsigned long oldest;
+    ns_limbo **p;
+    ns_limbo *l;
+    int i;
+
+    oldest = ns_epoch;
+    for (i = 0; i < ns_nreaders; i++)
+    {
+        unsigned long e = ns_readers[i];
+
+        if (e != 0 && e < oldest)
+        {
+            oldest = e;
+        }
+    }
+
+    p = &ns_limbo_list;
+    while (*p != NULL)
+    {
+        l = *p;
+
+        if (l->epoch < oldest)
+        {
+            *p = l->next;
+            free(l->p);
+            free(l);
+        }
+        else
+        {
+            p = &l->next;
+        }
+    }
+}
+
+/* Start reading the namespace. Everything looked up until the matching
+ * vcfs_ns_exit() comes from the same version (or one this thread has
+ * committed since), and stays around.
+ */
+vcfs_ns *vcfs_ns_enter()
+{
+    if (ns_depth++ > 0)
+    {
+        return ns_pinned;
+    }
+
+    if (ns_slot < 0)
+    {
+        ns_slot = __sync_fetch_and_add(&ns_nreaders, 1);
+        ASSERT(ns_slot < VCFS_NS_MAX_READERS, "Too many namespace readers");
+    }
+
+    ns_readers[ns_slot] = ns_epoch;
+    __sync_synchronize();
+    ns_pinned = ns_current;
+
+    return ns_pinned;
+}
+
+/* Done reading the namespace */
+void vcfs_ns_exit()
+{
+    ASSERT(ns_depth > 0, "Leaving the namespace without entering it");
+
+    if (--ns_depth > 0)
+    {
+        return;
+    }
+
+    ns_pinned = NULL;
+    __sync_synchronize();
+    ns_readers[ns_slot] = 0;
+
+    /* We might have been the last one holding up some old copies */
+    if (ns_limbo_list != NULL && pthread_mutex_trylock(&ns_write_lock) == 0)
+    {
+        ns_reclaim();
+        pthread_mutex_unlock(&ns_write_lock);
+    }
+}
+
+/* The namespace this thread should be looking at: the one it is building
+ * if it has a transaction open, otherwise the one it has pinned.
+ */
+vcfs_ns *vcfs_ns_get()
+{
+    if (ns_txn_depth > 0)
+    {
+        return ns_txn;
+    }
+
+    if (ns_pinned != NULL)
+    {
+        return ns_pinned;
+    }
+
+    return ns_current;
+}
+
+/* Open a transaction. Transactions nest; only the outermost commit
+ * publishes anything.
+ */
+vcfs_ns *vcfs_ns_begin()
+{
+    vcfs_ns *ns;
+
+    if (ns_txn_depth++ > 0)
+    {
+        return ns_txn;
+    }
+
+    pthread_mutex_lock(&ns_write_lock);
+
+    ns = (vcfs_ns *)malloc(sizeof(vcfs_ns));
+    memcpy(ns, ns_current, sizeof(vcfs_ns));
+    ns->gen = ns_current->gen + 1;
+
+    ns_txn = ns;
+    return ns;
+}
+
+/* Publish everything done in this transaction */
+void vcfs_ns_commit()
+{
+    vcfs_ns *old;
+    ns_limbo *l;
+
+    ASSERT(ns_txn_depth > 0, "Commit without a transaction");
+
+    if (ns_txn_depth > 1)
+    {
+        ns_txn_depth--;
+        return;
+    }
+
+    old = ns_current;
+    __sync_synchronize();
+    ns_current = ns_txn;
+    __sync_synchronize();
+
+    if (old != &ns_empty)
+    {
+        vcfs_ns_retire(old);
+    }
+
+    /* Readers that started in this epoch or earlier may still see the old
+     * copies. Anyone who comes along later gets the new namespace.
+     */
+    while ((l = ns_txn_retired) != NULL)
+    {
+        ns_txn_retired = l->next;
+        l->epoch = ns_epoch;
+        l->next = ns_limbo_list;
+        ns_limbo_list = l;
+    }
+    __sync_fetch_and_add(&ns_epoch, 1);
+
+    /* A reader that has just changed something should see it for the rest
+     * of its request. It keeps the epoch it started in, so what it was
+     * already looking at stays around too.
+     */
+    if (ns_pinned != NULL)
+    {
+        ns_pinned = ns_current;
+    }
+
+    ns_txn = NULL;
+    ns_txn_depth = 0;
+    ns_reclaim();
+
+    pthread_mutex_unlock(&ns_write_lock);
+}
+
+/* Free something once the current readers have finished with it. Must be
+ * called from within a transaction.
+ */
+void vcfs_ns_retire(void *p)
+{
+    ns_limbo *l;
+
+    ASSERT(ns_txn_depth > 0, "Retiring outside of a transaction");
+
+    if (p == NULL)
+    {
+        return;
+    }
+
+    l = (ns_limbo *)malloc(sizeof(ns_limbo));
+    l->p = p;
+    l->next = ns_txn_retired;
+    ns_txn_retired = l;
+}
+
+/* Get a copy of the fileid that we are allowed to change. Every fileid in
+ * the hash chain ahead of it gets copied too, since their next pointers
+ * are part of the chain.
+ */
+vcfs_fileid *vcfs_ns_edit_fh(vcfs_fileid *f)
+{
+    vcfs_ns *ns = ns_txn;
+    vcfs_fileid **p;
+    vcfs_fileid *c;
+    vcfs_fileid *copy;
+
+    ASSERT(ns_txn_depth > 0, "Changing a fileid outside of a transaction");
+
+    if (f->gen == ns->gen)
+    {
+        return f;
+    }
+
+    for (p = &ns->file_hash[f->hash_key]; *p != NULL; p = &c->next)
+    {
+        c = *p;
+
+        if (c->gen != ns->gen)
+        {
+            copy = (vcfs_fileid *)malloc(sizeof(vcfs_fileid));
+            memcpy(copy, c, sizeof(vcfs_fileid));
+            copy->gen = ns->gen;
+            *p = copy;
+            vcfs_ns_retire(c);
+
+            if (c == f)
+            {
+                return copy;
+            }
+            c = copy;
+        }
+    }
+
+    ASSERT(1 < 0, "Fileid is not in the namespace");
+    return NULL;
+}
+
+/* Get a copy of the ventry that we are allowed to change, and hook it
+ * into the namespace in place of the original.
+ */
+static vcfs_ventry *ns_edit_ventry(vcfs_ventry *v)
+{
+    vcfs_ns *ns = ns_txn;
+    vcfs_ventry *copy;
+    vcfs_ventry *p;
+    vcfs_fileid *f;
+    vcfs_path parent;
+    vcfs_name entry;
+    int i;
+
+    if (v->gen == ns->gen)
+    {
+        return v;
+    }
+
+    copy = (vcfs_ventry *)malloc(sizeof(vcfs_ventry));
+    memcpy(copy, v, sizeof(vcfs_ventry));
+    copy->gen = ns->gen;
+
+    if (v->dirent != NULL)
+    {
+        copy->dirent = (vcfs_ventry **)malloc(v->maxents *
+                                              sizeof(vcfs_ventry *));
+        memcpy(copy->dirent, v->dirent, v->nents * sizeof(vcfs_ventry *));
+        vcfs_ns_retire(v->dirent);
+    }
+
+    if (v->bloom != NULL)
+    {
+        copy->bloom = (unsigned char *)malloc(v->maxents);
+        memcpy(copy->bloom, v->bloom, v->maxents);
+        vcfs_ns_retire(v->bloom);
+    }
+    vcfs_ns_retire(v);
+
+    f = lookup_fh_name(v->name);
+    if (f != NULL)
+    {
+        f = vcfs_ns_edit_fh(f);
+        f->ventry = copy;
+    }
+
+    if (ns->root == v)
+    {
+        ns->root = copy;
+        return copy;
+    }
+
+    /* The parent directory has to point at the copy */
+    split_path(v->name, &parent, &entry);
+    f = lookup_fh_name(parent);
+    ASSERT(f != NULL && f->ventry != NULL, "Ventry has no parent");
+
+    p = ns_edit_ventry(f->ventry);
+    for (i = 0; i < p->nents; i++)
+    {
+        if (p->dirent[i] == v)
+        {
+            p->dirent[i] = copy;
+            break;
+        }
+    }
+
+    return copy;
+}
+
+/* Get a ventry we are allowed to change, by name. Returns NULL if there
+ * is no such file. Must be called from within a transaction.
+ */
+vcfs_ventry *vcfs_ns_edit(char *name)
+{
+    vcfs_fileid *f;
+
+    ASSERT(ns_txn_depth > 0, "Changing a ventry outside of a transaction");
+
+    f = lookup_fh_name(name);
+
+    if (f == NULL || f->ventry == NULL)
+    {
+        return NULL;
+    }
+
+    return ns_edit_ventry(f->ventry);
+}
+
+/* Set the top directory of the project */
+void vcfs_ns_set_root(vcfs_ventry *v)
+{
+    ASSERT(ns_txn_depth > 0, "Setting the root outside of a transaction");
+
+    ns_txn->root = v;
+}
+
+/* The top directory of the project */
+vcfs_ventry *vcfs_ns_root()
+{
+    return vcfs_ns_get()->root;
+}
@@ -0,0 +1,418 @@
+/****************************************************************************
+ * File: vcfs_refresh.c
+ * Keeps the in-memory tree in step with the repository. Every so often we
+ * ask the server which files have changed since we last looked ("rdiff -s"),
+ * and apply just those changes to the ventry tree: new revisions of files,
+ * files and directories that have been added, and files that have been
+ * removed. Nothing else in the tree is touched. Everything we learn from the
+ * server is collected first, then applied in a single namespace transaction
+ * so readers see either all of the changes or none of them.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <time.h>
+
+#include "vcfs.h"
+#include "cvs_cmds.h"
+#include "utils.h"
+
+/* The kinds of changes rdiff -s tells us about */
+#define REFRESH_CHANGED 1
+#define REFRESH_NEW     2
+#define REFRESH_REMOVED 3
+
+/* Our clock and the server's won't agree exactly, so ask for a little
+ * more history than we need. Changes we already have are ignored.
+ */
+#define REFRESH_SLOP 60
+
+/* What we say a new file's size is until it is first read. Too big is
+ * better than too small: clients only read as much as they think there
+ * is, and the first read tells them the truth.
+ */
+#define REFRESH_SIZE_GUESS 4096
+
+/* One change reported by the server */
+typedef struct refresh_change {
+    int what;
+    vcfs_path path;
+    vcfs_ver ver;
+    int size;
+    time_t mtime; /* When the new revision was committed */
+    struct refresh_change *next;
+} refresh_change;
+
+/* When we last asked the server what changed */
+static time_t last_sync;
+
+/* Remember when the tree was last brought up to date */
+void vcfs_refresh_set_sync(time_t t)
+{
+    last_sync = t;
+}
+
+/* Work out how big the new revision of a file is, and when it was
+ * committed, if we already have it. If not, the size is a guess (the size
+ * of the revision it replaces, if any) that vcfs_read() puts right, and
+ * the time comes from the log (see refresh_times()).
+ */
+static void refresh_file_info(refresh_change *c, vcfs_fileid *f)
+{
+    vcfs_blob *b;
+
+    b = vcfs_cache_get(c->path, c->ver);
+    if (b != NULL)
+    {
+        c->size = b->size;
+        c->mtime = b->mtime;
+        vcfs_cache_release(b);
+        return;
+    }
+
+    if (f != NULL && f->ventry != NULL)
+    {
+        c->size = f->ventry->size;
+    }
+    else
+    {
+        c->size = REFRESH_SIZE_GUESS;
+    }
+}
+
+static int refresh_change_cmp(const void *a, const void *b)
+{
+    return strcmp((*(refresh_change **)a)->path,
+                  (*(refresh_change **)b)->path);
+}
+
+/* Find out when new revisions were committed, with one "rlog" of just the
+ * files they are revisions of. Any we can't find out about are given the
+ * time of the refresh.
+ */
+static void refresh_times(refresh_change **todo, int n)
+{
+    refresh_change key;
+    refresh_change *kp = &key;
+    refresh_change **found;
+    cvs_buff *resp;
+    vcfs_hist *h;
+    vcfs_rev *r;
+    char **paths;
+    int i;
+
+    qsort(todo, n, sizeof(refresh_change *), refresh_change_cmp);
+
+    paths = (char **)malloc(n * sizeof(char *));
+    for (i = 0; i < n; i++)
+    {
+        paths[i] = todo[i]->path;
+    }
+
+    cvs_rlog_files(paths, n, &resp);
+    free(paths);
+
+    if (resp == NULL)
+    {
+        return;
+    }
+
+    for (;;)
+    {
+        h = (vcfs_hist *)calloc(1, sizeof(vcfs_hist));
+
+        if (cvs_parse_log(resp, h) < 0)
+        {
+            vcfs_hist_free(h);
+            break;
+        }
+
+        strcpy(key.path, h->name);
+        found = bsearch(&kp, todo, n, sizeof(refresh_change *),
+                        refresh_change_cmp);
+
+        if (found != NULL && (r = vcfs_hist_find(h, (*found)->ver)) != NULL)
+        {
+            (*found)->mtime = r->when;
+        }
+        vcfs_hist_free(h);
+    }
+
+    cvs_free_buff(resp);
+}
+
+/* Bump the time on the directory containing the given path, so NFS clients
+ * notice that it has changed. Only done when an entry is added or removed;
+ * a new revision of a file leaves its directory alone.
+ */
+static void refresh_touch_parent(vcfs_path name, time_t t)
+{
+    vcfs_path parent;
+    vcfs_name entry;
+    vcfs_ventry *v;
+
+    split_path(name, &parent, &entry);
+    v = vcfs_ns_edit(parent);
+
+    if (v != NULL && v->mtime < t)
+    {
+        v->mtime = t;
+    }
+}
+
+/* Make sure the given directory (and all of its parents) exist */
+static vcfs_ventry *refresh_make_dir(vcfs_path path, time_t t)
+{
+    vcfs_path parent;
+    vcfs_name entry;
+    vcfs_fileid *f;
+    vcfs_ventry *v;
+
+    f = lookup_fh_name(path);
+
+    if (f != NULL)
+    {
+        return f->ventry;
+    }
+
+    split_path(path, &parent, &entry);
+
+    if (strlen(parent) == 0 || refresh_make_dir(parent, t) == NULL)
+    {
+        /* We never create the top of the project */
+        return NULL;
+    }
+
+    v = create_ventry(path, 2048, NFDIR, 0, NULL, t, NULL);
+    create_fh(path, 1, v);
+    refresh_touch_parent(path, t);
+
+    return v;
+}
+
+/* Pick apart one line of "rdiff -s" output. These look like:
+ *   M File vcfs/foo.c changed from revision 1.2 to 1.3
+ *   M File vcfs/bar.c is new; current revision 1.1
+ *   M File vcfs/baz.c is removed; not included in release tag FOO
+ * Returns the kind of change, or 0 if the line is something else.
+ */
+static int refresh_parse_line(char *line, vcfs_path *path, vcfs_ver *ver)
+{
+    char *p;
+    char *v = NULL;
+    int what;
+
+    memset(path, 0, sizeof(*path));
+    memset(ver, 0, sizeof(*ver));
+
+    if (strncmp(line, "M File ", 7))
+    {
+        return 0;
+    }
+    line += 7;
+
+    if ((p = strstr(line, " changed from revision ")) != NULL)
+    {
+        what = REFRESH_CHANGED;
+        v = strstr(p, " to ");
+        if (v == NULL)
+        {
+            return 0;
+        }
+        v += 4;
+    }
+    else if ((p = strstr(line, " is new;")) != NULL)
+    {
+        what = REFRESH_NEW;
+        v = strrchr(p, ' ') + 1;
+    }
+    else if ((p = strstr(line, " is removed;")) != NULL)
+    {
+        what = REFRESH_REMOVED;
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (p - line >= sizeof(*path))
+    {
+        return 0;
+    }
+    strncpy(*path, line, p - line);
+
+    if (v != NULL)
+    {
+        strncpy(*ver, v, sizeof(*ver) - 1);
+    }
+
+    return what;
+}
+
+/* Apply one change to the namespace. Must be called from within a
+ * transaction. Returns 1 if anything changed.
+ */
+static int refresh_apply(refresh_change *c, time_t now)
+{
+    vcfs_path parent;
+    vcfs_name entry;
+    vcfs_ventry *v;
+    time_t t;
+
+    split_path(c->path, &parent, &entry);
+    vcfs_hist_forget(c->path);
+    vcfs_index_forget(c->path);
+
+    /* Servers that don't send Mod-time only tell us it happened recently */
+    t = c->mtime ? c->mtime : now;
+
+    if (c->what == REFRESH_REMOVED)
+    {
+        v = vcfs_ns_edit(c->path);
+
+        if (v == NULL)
+        {
+            return 0;
+        }
+
+        remove_ventry(v);
+        DEBUG(DEBUG_M, "[vcfs_refresh] removed %s", c->path);
+        refresh_touch_parent(c->path, t);
+    }
+    else if ((v = vcfs_ns_edit(c->path)) != NULL)
+    {
+        strncpy(v->ver, c->ver, sizeof(v->ver));
+        v->size = c->size;
+        v->mtime = t;
+        DEBUG(DEBUG_M, "[vcfs_refresh] %s is now %s", c->path, c->ver);
+    }
+    else
+    {
+        if (refresh_make_dir(parent, t) == NULL)
+        {
+            return 0;
+        }
+
+        v = create_ventry(c->path, c->size, NFREG, 0, c->ver, t,
+                          cvs_session_tag());
+        create_fh(c->path, 1, v);
+        DEBUG(DEBUG_M, "[vcfs_refresh] added %s,%s", c->path, c->ver);
+        refresh_touch_parent(c->path, t);
+    }
+
+    return 1;
+}
+
+/* Bring the tree up to date with the repository. Returns the number of
+ * files that changed, or -1 if we couldn't talk to the server.
+ */
+int vcfs_refresh()
+{
+    cvs_buff *resp;
+    char *line;
+    char since[64];
+    time_t now;
+    time_t from;
+    vcfs_fileid *f;
+    refresh_change *changes = NULL;
+    refresh_change *c;
+    refresh_change **todo;
+    int ntodo = 0;
+    int count = 0;
+
+    time(&now);
+    from = last_sync - REFRESH_SLOP;
+    strftime(since, sizeof(since), "%d %b %Y %H:%M:%S -0000", gmtime(&from));
+
+    DEBUG(DEBUG_L, "[vcfs_refresh] looking for changes since %s", since);
+
+    if (!cvs_rdiff_summary(since, &resp))
+    {
+        fprintf(stderr, "vcfs_refresh: Could not get changes from server\n");
+        return -1;
+    }
+
+    /* Find out everything that changed, without holding up anyone else */
+    vcfs_ns_enter();
+
+    while (cvs_buff_read_line(resp, &line) > 0)
+    {
+        c = (refresh_change *)malloc(sizeof(refresh_change));
+        c->what = refresh_parse_line(line, &c->path, &c->ver);
+        c->size = 0;
+        c->mtime = 0;
+        free(line);
+
+        f = lookup_fh_name(c->path);
+
+        if (c->what == REFRESH_CHANGED || c->what == REFRESH_NEW)
+        {
+            if (f != NULL && f->ventry != NULL && !strcmp(f->ventry->ver, c->ver))
+            {
+                /* We already have this revision */
+                c->what = 0;
+            }
+            else
+            {
+                refresh_file_info(c, f);
+                ntodo += (c->mtime == 0);
+            }
+        }
+        else if (c->what == REFRESH_REMOVED && f == NULL)
+        {
+            c->what = 0;
+        }
+
+        if (c->what == 0)
+        {
+            free(c);
+            continue;
+        }
+
+        c->next = changes;
+        changes = c;
+    }
+
+    vcfs_ns_exit();
+    cvs_free_buff(resp);
+
+    if (ntodo > 0)
+    {
+        todo = (refresh_change **)malloc(ntodo * sizeof(refresh_change *));
+        ntodo = 0;
+        for (c = changes; c != NULL; c = c->next)
+        {
+            if (c->what != REFRESH_REMOVED && c->mtime == 0)
+            {
+                todo[ntodo++] = c;
+            }
+        }
+
+        refresh_times(todo, ntodo);
+        free(todo);
+    }
+
+    /* Now make all of the changes at once */
+    if (changes != NULL)
+    {
+        vcfs_ns_begin();
+
+        while ((c = changes) != NULL)
+        {
+            changes = c->next;
+            count += refresh_apply(c, now);
+            free(c);
+        }
+
+        vcfs_ns_commit();
+
+        /* Revisions we were told don't exist might now */
+        if (count > 0)
+        {
+            vcfs_neg_clear();
+        }
+    }
+
+    last_sync = now;
+
+    return count;
+}
@@ -0,0 +1,973 @@
+/****************************************************************************
+ * File: vcfs_rpc.c
+ * The NFS side of vcfsd. We read NFS calls off the sockets ourselves
+ * instead of going through svc_run(), so that more than one can be worked
+ * on at a time. A dispatcher thread reads each call and decodes it, then
+ * hands it to a pool of worker threads which run it and send the reply. A
+ * READ of a file that isn't in the cache doesn't hold up a worker at all:
+ * the handler returns without a result, and the request is put aside until
+ * the file arrives (see vcfs_cache_fetch_async()), then run again.
+ *
+ * Versions 2 and 3 of NFS are both served on the same socket; each call is
+ * handed to the right set of handlers by its version number.
+ *
+ * NFS over TCP is served on the same port. Each connection gets a thread
+ * of its own to read calls off it (RPC record marking, RFC 1831), which go
+ * to the same workers as the UDP ones. A client can have any number of
+ * calls outstanding on a connection; replies go back in whatever order
+ * they are finished, one at a time.
+ *
+ * Replies and calls over UDP go through the kernel in batches where they
+ * can. A dispatcher reads every datagram that is waiting with one system
+ * call, and a worker takes a share of the queue at a time and sends all of
+ * the replies to it together. Under a stream of small calls (GETATTR and
+ * LOOKUP from find or make) that saves most of the system calls; when
+ * things are quiet the batches are just one long. Several UDP sockets can
+ * share the port (SO_REUSEPORT), each with its own dispatcher.
+ *
+ * The cvstool service is still run by svc_run() style code in vcfs.c.
+ ***************************************************************************/
+
+#define _GNU_SOURCE /* recvmmsg() and sendmmsg() */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "vcfs_rpc.h"
+#include "utils.h"
+
+typedef void *(*rpc_handler)(void *, struct svc_req *);
+
+/* The NFS version 2 procedures, indexed by procedure number */
+static vcfs_rpc_proc nfs_procs[] = {
+    { (xdrproc_t)xdr_void, (xdrproc_t)xdr_void,
+      (rpc_handler)nfsproc_null_2 },
+    { (xdrproc_t)vcfs_xdr_nfs_fh, (xdrproc_t)vcfs_xdr_attrstat,
+      (rpc_handler)nfsproc_getattr_2 },
+    { (xdrproc_t)xdr_sattrargs, (xdrproc_t)xdr_attrstat,
+      (rpc_handler)nfsproc_setattr_2 },
+    { (xdrproc_t)xdr_void, (xdrproc_t)xdr_void,
+      (rpc_handler)nfsproc_root_2 },
+    { (xdrproc_t)vcfs_xdr_diropargs, (xdrproc_t)vcfs_xdr_diropres,
+      (rpc_handler)nfsproc_lookup_2 },
+    { (xdrproc_t)xdr_nfs_fh, (xdrproc_t)xdr_readlinkres,
+      (rpc_handler)nfsproc_readlink_2 },
+    { (xdrproc_t)vcfs_xdr_readargs, (xdrproc_t)vcfs_xdr_readres,
+      (rpc_handler)nfsproc_read_2 },
+    { (xdrproc_t)xdr_void, (xdrproc_t)xdr_void,
+      (rpc_handler)nfsproc_writecache_2 },
+    { (xdrproc_t)xdr_writeargs, (xdrproc_t)xdr_attrstat,
+      (rpc_handler)nfsproc_write_2 },
+    { (xdrproc_t)xdr_createargs, (xdrproc_t)xdr_diropres,
+      (rpc_handler)nfsproc_create_2 },
+    { (xdrproc_t)xdr_diropargs, (xdrproc_t)xdr_nfsstat,
+      (rpc_handler)nfsproc_remove_2 },
+    { (xdrproc_t)xdr_renameargs, (xdrproc_t)xdr_nfsstat,
+      (rpc_handler)nfsproc_rename_2 },
+    { (xdrproc_t)xdr_linkargs, (xdrproc_t)xdr_nfsstat,
+      (rpc_handler)nfsproc_link_2 },
+    { (xdrproc_t)xdr_symlinkargs, (xdrproc_t)xdr_nfsstat,
+      (rpc_handler)nfsproc_symlink_2 },
+    { (xdrproc_t)xdr_createargs, (xdrproc_t)xdr_diropres,
+      (rpc_handler)nfsproc_mkdir_2 },
+    { (xdrproc_t)xdr_diropargs, (xdrproc_t)xdr_nfsstat,
+      (rpc_handler)nfsproc_rmdir_2 },
+    { (xdrproc_t)vcfs_xdr_readdirargs, (xdrproc_t)vcfs_xdr_readdirres,
+      (rpc_handler)nfsproc_readdir_2 },
+    { (xdrproc_t)xdr_nfs_fh, (xdrproc_t)xdr_statfsres,
+      (rpc_handler)nfsproc_statfs_2 },
+};
+
+/* The NFS version 3 procedures. The ones that would change anything just
+ * say the filesystem is read only, so their arguments aren't decoded.
+ */
+static vcfs_rpc_proc nfs3_procs[] = {
+    { (xdrproc_t)xdr_void, (xdrproc_t)xdr_void,
+      (rpc_handler)nfsproc3_null_3 },
+    { (xdrproc_t)vcfs_xdr_nfs_fh3, (xdrproc_t)vcfs_xdr_GETATTR3res,
+      (rpc_handler)nfsproc3_getattr_3 },
+    { (xdrproc_t)xdr_void, (xdrproc_t)xdr_WCC3res,
+      (rpc_handler)nfsproc3_setattr_3 },
+    { (xdrproc_t)vcfs_xdr_diropargs3, (xdrproc_t)vcfs_xdr_LOOKUP3res,
+      (rpc_handler)nfsproc3_lookup_3 },
+    { (xdrproc_t)xdr_ACCESS3args, (xdrproc_t)xdr_ACCESS3res,
+      (rpc_handler)nfsproc3_access_3 },
+    { (xdrproc_t)xdr_nfs_fh3, (xdrproc_t)xdr_READLINK3res,
+      (rpc_handler)nfsproc3_readlink_3 },
+    { (xdrproc_t)vcfs_xdr_READ3args, (xdrproc_t)vcfs_xdr_READ3res,
+      (rpc_handler)nfsproc3_read_3 },
+    { (xdrproc_t)xdr_void, (xdrproc_t)xdr_WCC3res,
+      (rpc_handler)nfsproc3_write_3 },
+    { (xdrproc_t)xdr_void, (xdrproc_t)xdr_WCC3res,
+      (rpc_handler)nfsproc3_create_3 },
+    { (xdrproc_t)xdr_void, (xdrproc_t)xdr_WCC3res,
+      (rpc_handler)nfsproc3_mkdir_3 },
+    { (xdrproc_t)xdr_void, (xdrproc_t)xdr_WCC3res,
+      (rpc_handler)nfsproc3_symlink_3 },
+    { (xdrproc_t)xdr_void, (xdrproc_t)xdr_WCC3res,
+      (rpc_handler)nfsproc3_mknod_3 },
+    { (xdrproc_t)xdr_void, (xdrproc_t)xdr_WCC3res,
+      (rpc_handler)nfsproc3_remove_3 },
+    { (xdrproc_t)xdr_void, (xdrproc_t)xdr_WCC3res,
+      (rpc_handler)nfsproc3_rmdir_3 },
+    { (xdrproc_t)xdr_void, (xdrproc_t)xdr_RENAME3res,
+      (rpc_handler)nfsproc3_rename_3 },
+    { (xdrproc_t)xdr_void, (xdrproc_t)xdr_LINK3res,
+      (rpc_handler)nfsproc3_link_3 },
+    { (xdrproc_t)vcfs_xdr_READDIR3args, (xdrproc_t)vcfs_xdr_READDIR3res,
+      (rpc_handler)nfsproc3_readdir_3 },
+    { (xdrproc_t)xdr_READDIRPLUS3args, (xdrproc_t)xdr_READDIRPLUS3res,
+      (rpc_handler)nfsproc3_readdirplus_3 },
+    { (xdrproc_t)xdr_nfs_fh3, (xdrproc_t)xdr_FSSTAT3res,
+      (rpc_handler)nfsproc3_fsstat_3 },
+    { (xdrproc_t)xdr_nfs_fh3, (xdrproc_t)xdr_FSINFO3res,
+      (rpc_handler)nfsproc3_fsinfo_3 },
+    { (xdrproc_t)xdr_nfs_fh3, (xdrproc_t)xdr_PATHCONF3res,
+      (rpc_handler)nfsproc3_pathconf_3 },
+    { (xdrproc_t)xdr_void, (xdrproc_t)xdr_WCC3res,
+      (rpc_handler)nfsproc3_commit_3 },
+};
+
+#define NFS_NPROCS (sizeof(nfs_procs) / sizeof(nfs_procs[0]))
+#define NFS3_NPROCS (sizeof(nfs3_procs) / sizeof(nfs3_procs[0]))
+
+/* The listening TCP socket */
+static int rpc_tcpsock;
+
+/* How many workers there are */
+static int rpc_nworkers;
+
+/* UDP replies a thread has encoded but not sent yet, so that it can send
+ * a batch of them at once
+ */
+typedef struct rpc_outbox {
+    vcfs_req *reqs[VCFS_RPC_BATCH];
+    int n;
+} rpc_outbox;
+
+static __thread rpc_outbox *rpc_out = NULL;
+
+/* Protects the reference counts of TCP connections */
+static pthread_mutex_t rpc_conn_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* A reply goes out in at most three pieces: see rpc_reply_iov() */
+#define RPC_REPLY_IOVS 3
+
+/* The top bit of a record mark says it's the last fragment of the record */
+#define RPC_LAST_FRAG 0x80000000
+
+/* Requests waiting for a worker */
+static pthread_mutex_t rpc_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rpc_queue_cond = PTHREAD_COND_INITIALIZER;
+static vcfs_req *rpc_queue_head = NULL;
+static vcfs_req **rpc_queue_tail = &rpc_queue_head;
+static int rpc_queue_len = 0;
+
+/* Read exactly len bytes from a socket. Returns -1 if we couldn't */
+static int rpc_read(int sock, char *buf, int len)
+{
+    int n;
+
+    while (len > 0)
+    {
+        n = read(sock, buf, len);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+/* Write all of an iovec to a socket. Returns -1 if we couldn't */
+static int rpc_writev(int sock, struct iovec *iov, int n)
+{
+    int len;
+
+    while (n > 0)
+    {
+        len = writev(sock, iov, n);
+        if (len < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (len <= 0)
+        {
+            return -1;
+        }
+
+        /* Skip over what went */
+        while (n > 0 && len >= iov->iov_len)
+        {
+            len -= iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + len;
+            iov->iov_len -= len;
+        }
+    }
+
+    return 0;
+}
+
+/* Point an iovec at a reply: the encoded part starting at start, then
+ * the data of a READ and its padding. Returns how many pieces there are.
+ */
+static int rpc_reply_iov(vcfs_req *req, char *start, int len,
+                         struct iovec *iov)
+{
+    static char pad[BYTES_PER_XDR_UNIT];
+    int n = 0;
+
+    iov[n].iov_base = start;
+    iov[n].iov_len = len;
+    n++;
+
+    if (req->read_len > 0)
+    {
+        iov[n].iov_base = req->read_data;
+        iov[n].iov_len = req->read_len;
+        n++;
+
+        if (RNDUP(req->read_len) != req->read_len)
+        {
+            iov[n].iov_base = pad;
+            iov[n].iov_len = RNDUP(req->read_len) - req->read_len;
+            n++;
+        }
+    }
+
+    return n;
+}
+
+/* Done with a TCP connection. The last one out closes it */
+static void rpc_conn_release(vcfs_conn *conn)
+{
+    int refs;
+
+    pthread_mutex_lock(&rpc_conn_lock);
+    refs = --conn->refs;
+    pthread_mutex_unlock(&rpc_conn_lock);
+
+    if (refs == 0)
+    {
+        close(conn->sock);
+        pthread_mutex_destroy(&conn->write_lock);
+        free(conn);
+    }
+}
+
+/* Send all the replies in an outbox, with as few system calls as we can */
+static void rpc_flush(rpc_outbox *out)
+{
+    struct mmsghdr msgs[VCFS_RPC_BATCH];
+    struct iovec iovs[VCFS_RPC_BATCH][RPC_REPLY_IOVS];
+    int sent[VCFS_RPC_BATCH];
+    int sock;
+    int i;
+    int j;
+    int n;
+    int done;
+
+    memset(sent, 0, sizeof(sent));
+
+    /* One sendmmsg() for each socket the replies go out on */
+    for (i = 0; i < out->n; i++)
+    {
+        if (sent[i])
+        {
+            continue;
+        }
+
+        sock = out->reqs[i]->sock;
+        n = 0;
+
+        for (j = i; j < out->n; j++)
+        {
+            if (sent[j] || out->reqs[j]->sock != sock)
+            {
+                continue;
+            }
+
+            memset(&msgs[n], 0, sizeof(msgs[n]));
+            msgs[n].msg_hdr.msg_name = &out->reqs[j]->addr;
+            msgs[n].msg_hdr.msg_namelen = sizeof(out->reqs[j]->addr);
+            msgs[n].msg_hdr.msg_iov = iovs[n];
+            msgs[n].msg_hdr.msg_iovlen =
+                rpc_reply_iov(out->reqs[j], out->reqs[j]->buf,
+                              out->reqs[j]->len, iovs[n]);
+
+            sent[j] = 1;
+            n++;
+        }
+
+        for (done = 0; done < n; )
+        {
+            j = sendmmsg(sock, msgs + done, n - done, 0);
+
+            if (j < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (j < 0)
+            {
+                /* Give up on this one, the client will ask again */
+                perror("vcfs_rpc: sendmmsg failed");
+                j = 1;
+            }
+            done += j;
+        }
+    }
+
+    out->n = 0;
+}
+
+/* Send the reply in a UDP request's buffer. Threads with an outbox send
+ * it later, along with the others.
+ */
+static void rpc_send(vcfs_req *req)
+{
+    struct iovec iov[RPC_REPLY_IOVS];
+    struct msghdr msg;
+
+    if (rpc_out != NULL)
+    {
+        if (rpc_out->n == VCFS_RPC_BATCH)
+        {
+            rpc_flush(rpc_out);
+        }
+        rpc_out->reqs[rpc_out->n++] = req;
+        return;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &req->addr;
+    msg.msg_namelen = sizeof(req->addr);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = rpc_reply_iov(req, req->buf, req->len, iov);
+
+    if (sendmsg(req->sock, &msg, 0) < 0)
+    {
+        perror("vcfs_rpc: sendmsg failed");
+    }
+}
+
+/* Encode a reply to the request in its buffer, and send it */
+static void rpc_reply(vcfs_req *req, struct rpc_msg *msg)
+{
+    struct iovec iov[RPC_REPLY_IOVS];
+    XDR xdrs;
+    char *start;
+    u_int mark;
+    u_int n;
+    int len;
+
+    msg->rm_xid = req->xid;
+    msg->rm_direction = REPLY;
+
+    /* Over TCP, leave room for the record mark */
+    start = req->buf;
+    if (req->conn != NULL)
+    {
+        start += sizeof(mark);
+    }
+
+    xdrmem_create(&xdrs, start, sizeof(req->buf) - (start - req->buf),
+                  XDR_ENCODE);
+
+    if (!xdr_replymsg(&xdrs, msg))
+    {
+        fprintf(stderr, "vcfs_rpc: Could not encode reply to procedure %d\n",
+                (int)req->svc.rq_proc);
+        xdr_destroy(&xdrs);
+        req->len = 0;
+        return;
+    }
+
+    len = xdr_getpos(&xdrs);
+    xdr_destroy(&xdrs);
+
+    /* The reply is what's in the buffer now */
+    req->len = len;
+
+    if (req->read_len > 0)
+    {
+        /* The results of a READ were encoded with no data, so they end
+         * with the length of an empty opaque. The data itself goes out
+         * after them, straight from the cache.
+         */
+        n = htonl(req->read_len);
+        memcpy(start + len - sizeof(n), &n, sizeof(n));
+    }
+
+    if (req->conn != NULL)
+    {
+        /* The whole reply goes in one fragment */
+        n = rpc_reply_iov(req, req->buf, len + sizeof(mark), iov);
+        mark = htonl(RPC_LAST_FRAG | (len + RNDUP(req->read_len)));
+        memcpy(req->buf, &mark, sizeof(mark));
+
+        pthread_mutex_lock(&req->conn->write_lock);
+        if (rpc_writev(req->conn->sock, iov, n) < 0)
+        {
+            /* The client has gone away, the reader will notice */
+            DEBUG(DEBUG_M, "[rpc_reply] write failed: %s", strerror(errno));
+        }
+        pthread_mutex_unlock(&req->conn->write_lock);
+        return;
+    }
+
+    rpc_send(req);
+}
+
+/* Send an accepted reply. The results are only sent if stat is SUCCESS */
+static void rpc_accept(vcfs_req *req, enum accept_stat stat,
+                       xdrproc_t xdr_res, void *res)
+{
+    struct rpc_msg msg;
+
+    msg.rm_reply.rp_stat = MSG_ACCEPTED;
+    msg.acpted_rply.ar_verf = _null_auth;
+    msg.acpted_rply.ar_stat = stat;
+
+    if (stat == SUCCESS)
+    {
+        msg.acpted_rply.ar_results.where = res;
+        msg.acpted_rply.ar_results.proc = xdr_res;
+    }
+    else if (stat == PROG_MISMATCH)
+    {
+        msg.acpted_rply.ar_vers.low = NFS_VERSION;
+        msg.acpted_rply.ar_vers.high = NFS_V3;
+    }
+
+    rpc_reply(req, &msg);
+}
+
+/* Decode the call in the request's buffer. Returns 1 if it should be
+ * handed to a worker, 0 if it has already been dealt with.
+ */
+static int rpc_decode(vcfs_req *req)
+{
+    struct rpc_msg msg;
+    char cred[2 * MAX_AUTH_BYTES];
+    XDR xdrs;
+    vcfs_rpc_proc *procs = NULL;
+    u_long nprocs = 0;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.rm_call.cb_cred.oa_base = cred;
+    msg.rm_call.cb_verf.oa_base = cred + MAX_AUTH_BYTES;
+
+    xdrmem_create(&xdrs, req->buf, req->len, XDR_DECODE);
+
+    if (!xdr_callmsg(&xdrs, &msg))
+    {
+        /* Not an RPC call at all, don't bother answering */
+        xdr_destroy(&xdrs);
+        return 0;
+    }
+
+    req->xid = msg.rm_xid;
+    req->svc.rq_prog = msg.rm_call.cb_prog;
+    req->svc.rq_vers = msg.rm_call.cb_vers;
+    req->svc.rq_proc = msg.rm_call.cb_proc;
+    req->svc.rq_cred.oa_flavor = msg.rm_call.cb_cred.oa_flavor;
+    req->svc.rq_cred.oa_base = NULL;
+    req->svc.rq_cred.oa_length = 0;
+    req->svc.rq_clntcred = NULL;
+    req->svc.rq_xprt = NULL;
+    req->read_blob = NULL;
+    req->read_len = 0;
+
+    if (req->svc.rq_vers == NFS_VERSION)
+    {
+        procs = nfs_procs;
+        nprocs = NFS_NPROCS;
+    }
+    else if (req->svc.rq_vers == NFS_V3)
+    {
+        procs = nfs3_procs;
+        nprocs = NFS3_NPROCS;
+    }
+
+    if (req->svc.rq_prog != NFS_PROGRAM)
+    {
+        rpc_accept(req, PROG_UNAVAIL, NULL, NULL);
+    }
+    else if (procs == NULL)
+    {
+        rpc_accept(req, PROG_MISMATCH, NULL, NULL);
+    }
+    else if (req->svc.rq_proc >= nprocs)
+    {
+        rpc_accept(req, PROC_UNAVAIL, NULL, NULL);
+    }
+    else
+    {
+        req->proc = &procs[req->svc.rq_proc];
+        memset(&req->args, 0, sizeof(req->args));
+
+        if ((*req->proc->xdr_args)(&xdrs, &req->args))
+        {
+            xdr_destroy(&xdrs);
+            return 1;
+        }
+
+        xdr_free(req->proc->xdr_args, (char *)&req->args);
+        rpc_accept(req, GARBAGE_ARGS, NULL, NULL);
+    }
+
+    xdr_destroy(&xdrs);
+    return 0;
+}
+
+/* Hand a list of n requests to the workers. tail points to the next
+ * pointer of the last one.
+ */
+static void rpc_queue_list(vcfs_req *head, vcfs_req **tail, int n)
+{
+    *tail = NULL;
+
+    pthread_mutex_lock(&rpc_queue_lock);
+    *rpc_queue_tail = head;
+    rpc_queue_tail = tail;
+    rpc_queue_len += n;
+
+    if (n > 1)
+    {
+        pthread_cond_broadcast(&rpc_queue_cond);
+    }
+    else
+    {
+        pthread_cond_signal(&rpc_queue_cond);
+    }
+    pthread_mutex_unlock(&rpc_queue_lock);
+}
+
+/* Hand a request to the workers */
+static void rpc_queue(vcfs_req *req)
+{
+    rpc_queue_list(req, &req->next, 1);
+}
+
+/* Run a decoded request and send back the results. Returns 0 if the
+ * handler put the request aside to be run again later, in which case
+ * it no longer belongs to us.
+ */
+static int rpc_run(vcfs_req *req)
+{
+    vcfs_rpc_proc *proc = req->proc;
+    void *res;
+
+    /* The request sees one version of the namespace, and the results
+     * can point into it until they are sent.
+     */
+    vcfs_ns_enter();
+
+    res = (*proc->run)(&req->args, &req->svc);
+
+    if (res == NULL)
+    {
+        /* Deferred. It may already be running again somewhere else, so
+         * don't touch it.
+         */
+        vcfs_ns_exit();
+        return 0;
+    }
+
+    rpc_accept(req, SUCCESS, proc->xdr_res, res);
+
+    vcfs_ns_exit();
+
+    if (req->conn == NULL)
+    {
+        vcfs_drc_done(req);
+    }
+
+    xdr_free(proc->xdr_args, (char *)&req->args);
+    return 1;
+}
+
+/* Send the replies this thread has finished, before it does something that
+ * may take a while, such as asking the CVS server. Otherwise they would
+ * wait for the rest of the batch, and the clients would send them again.
+ */
+void vcfs_rpc_flush()
+{
+    if (rpc_out != NULL && rpc_out->n > 0)
+    {
+        rpc_flush(rpc_out);
+    }
+}
+
+/* Run a request that was put aside again, now that whatever it was
+ * waiting for is ready.
+ */
+void vcfs_rpc_resume(vcfs_req *req)
+{
+    req->waited = 1;
+    rpc_queue(req);
+}
+
+/* Read NFS calls off a UDP socket and queue them up for the workers. We
+ * take as many datagrams as are waiting with each system call, and queue
+ * up the ones that need running all at once.
+ */
+static void *rpc_dispatch(void *arg)
+{
+    int sock = (int)(long)arg;
+    vcfs_req *reqs[VCFS_RPC_BATCH];
+    struct mmsghdr msgs[VCFS_RPC_BATCH];
+    struct iovec iovs[VCFS_RPC_BATCH];
+    rpc_outbox out;
+    vcfs_req *batch;
+    vcfs_req **tail;
+    vcfs_req *req;
+    int nbatch;
+    int i;
+    int n;
+
+    memset(reqs, 0, sizeof(reqs));
+    out.n = 0;
+    rpc_out = &out;
+
+    for (;;)
+    {
+        for (i = 0; i < VCFS_RPC_BATCH; i++)
+        {
+            if (reqs[i] == NULL)
+            {
+                reqs[i] = (vcfs_req *)malloc(sizeof(vcfs_req));
+            }
+
+            iovs[i].iov_base = reqs[i]->buf;
+            iovs[i].iov_len = sizeof(reqs[i]->buf);
+
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = &reqs[i]->addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(reqs[i]->addr);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        /* Wait for one, and take whatever else has come in with it */
+        n = recvmmsg(sock, msgs, VCFS_RPC_BATCH, MSG_WAITFORONE, NULL);
+
+        if (n < 0)
+        {
+            if (errno != EINTR)
+            {
+                perror("vcfs_rpc: recvmmsg failed");
+            }
+            continue;
+        }
+
+        batch = NULL;
+        tail = &batch;
+        nbatch = 0;
+
+        for (i = 0; i < n; i++)
+        {
+            req = reqs[i];
+            req->len = msgs[i].msg_len;
+            req->sock = sock;
+            req->conn = NULL;
+
+            if (!rpc_decode(req))
+            {
+                /* Reuse the request for the next call */
+                continue;
+            }
+
+            /* The client may be resending a call because we're slow */
+            switch (vcfs_drc_check(req))
+            {
+            case VCFS_DRC_DONE:
+                rpc_send(req);
+                xdr_free(req->proc->xdr_args, (char *)&req->args);
+                continue;
+
+            case VCFS_DRC_IN_PROGRESS:
+                xdr_free(req->proc->xdr_args, (char *)&req->args);
+                continue;
+            }
+
+            req->blob = NULL;
+            req->waited = 0;
+            *tail = req;
+            tail = &req->next;
+            nbatch++;
+
+            reqs[i] = NULL;
+        }
+
+        if (nbatch > 0)
+        {
+            rpc_queue_list(batch, tail, nbatch);
+        }
+
+        /* Errors and replies from the duplicate request cache. This has to
+         * be done before the buffers are used again.
+         */
+        rpc_flush(&out);
+    }
+
+    return NULL;
+}
+
+/* Read one RPC record off a TCP connection into the request's buffer.
+ * Returns -1 if the connection has been closed, or the record is too big
+ * for us.
+ */
+static int rpc_read_record(vcfs_conn *conn, vcfs_req *req)
+{
+    u_int mark;
+    u_int len;
+
+    req->len = 0;
+
+    do
+    {
+        if (rpc_read(conn->sock, (char *)&mark, sizeof(mark)) < 0)
+        {
+            return -1;
+        }
+
+        mark = ntohl(mark);
+        len = mark & ~RPC_LAST_FRAG;
+
+        if (len > sizeof(req->buf) - req->len)
+        {
+            fprintf(stderr, "vcfs_rpc: Dropping connection, record too big\n");
+            return -1;
+        }
+
+        if (rpc_read(conn->sock, req->buf + req->len, len) < 0)
+        {
+            return -1;
+        }
+        req->len += len;
+    } while (!(mark & RPC_LAST_FRAG));
+
+    return 0;
+}
+
+/* Read NFS calls off a TCP connection and queue them up for the workers */
+static void *rpc_conn_reader(void *arg)
+{
+    vcfs_conn *conn = (vcfs_conn *)arg;
+    vcfs_req *req = NULL;
+
+    for (;;)
+    {
+        if (req == NULL)
+        {
+            req = (vcfs_req *)malloc(sizeof(vcfs_req));
+        }
+
+        if (rpc_read_record(conn, req) < 0)
+        {
+            break;
+        }
+
+        req->conn = conn;
+
+        if (!rpc_decode(req))
+        {
+            continue;
+        }
+
+        /* The request keeps the connection open until it's answered */
+        pthread_mutex_lock(&rpc_conn_lock);
+        conn->refs++;
+        pthread_mutex_unlock(&rpc_conn_lock);
+
+        req->blob = NULL;
+        req->waited = 0;
+        rpc_queue(req);
+
+        req = NULL;
+    }
+
+    free(req);
+    rpc_conn_release(conn);
+
+    return NULL;
+}
+
+/* Accept TCP connections, and start a thread to read each one */
+static void *rpc_accept_conns(void *arg)
+{
+    vcfs_conn *conn;
+    pthread_t tid;
+    int sock;
+
+    for (;;)
+    {
+        sock = accept(rpc_tcpsock, NULL, NULL);
+
+        if (sock < 0)
+        {
+            if (errno != EINTR)
+            {
+                perror("vcfs_rpc: accept failed");
+            }
+            continue;
+        }
+
+        conn = (vcfs_conn *)malloc(sizeof(vcfs_conn));
+        conn->sock = sock;
+        conn->refs = 1;
+        pthread_mutex_init(&conn->write_lock, NULL);
+
+        if (pthread_create(&tid, NULL, rpc_conn_reader, conn) != 0)
+        {
+            perror("vcfs_rpc: Could not start connection reader");
+            rpc_conn_release(conn);
+            continue;
+        }
+        pthread_detach(tid);
+    }
+
+    return NULL;
+}
+
+/* Run requests as they come off the queue */
+static void *rpc_worker(void *arg)
+{
+    vcfs_req *batch[VCFS_RPC_BATCH];
+    vcfs_req *req;
+    rpc_outbox out;
+    int ndone;
+    int n;
+    int i;
+
+    out.n = 0;
+    rpc_out = &out;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&rpc_queue_lock);
+
+        while (rpc_queue_head == NULL)
+        {
+            pthread_cond_wait(&rpc_queue_cond, &rpc_queue_lock);
+        }
+
+        /* Take our share of what's waiting, and leave the rest for the
+         * other workers
+         */
+        n = (rpc_queue_len + rpc_nworkers - 1) / rpc_nworkers;
+        if (n > VCFS_RPC_BATCH)
+        {
+            n = VCFS_RPC_BATCH;
+        }
+
+        for (i = 0; i < n && rpc_queue_head != NULL; i++)
+        {
+            batch[i] = rpc_queue_head;
+            rpc_queue_head = rpc_queue_head->next;
+        }
+        n = i;
+
+        rpc_queue_len -= n;
+        if (rpc_queue_head == NULL)
+        {
+            rpc_queue_tail = &rpc_queue_head;
+        }
+
+        pthread_mutex_unlock(&rpc_queue_lock);
+
+        /* Requests that are put aside drop out of the batch */
+        ndone = 0;
+        for (i = 0; i < n; i++)
+        {
+            if (rpc_run(batch[i]))
+            {
+                batch[ndone++] = batch[i];
+            }
+        }
+
+        rpc_flush(&out);
+
+        /* Only now that the replies have gone can READs let go of the
+         * files their data was sent from
+         */
+        for (i = 0; i < ndone; i++)
+        {
+            req = batch[i];
+            if (req->read_blob != NULL)
+            {
+                vcfs_cache_release(req->read_blob);
+            }
+            if (req->conn != NULL)
+            {
+                rpc_conn_release(req->conn);
+            }
+            free(req);
+        }
+    }
+
+    return NULL;
+}
+
+/* Start serving NFS requests that arrive on the given (bound) UDP sockets
+ * and listening TCP socket, using nworkers threads to run them.
+ */
+void vcfs_rpc_start(int *socks, int nsocks, int tcpsock, int nworkers)
+{
+    pthread_t tid;
+    int i;
+
+    rpc_tcpsock = tcpsock;
+    rpc_nworkers = nworkers;
+
+    /* A client closing its connection shouldn't kill us */
+    signal(SIGPIPE, SIG_IGN);
+
+    for (i = 0; i < nworkers; i++)
+    {
+        if (pthread_create(&tid, NULL, rpc_worker, NULL) != 0)
+        {
+            perror("vcfs_rpc: Could not start worker");
+            exit(1);
+        }
+        pthread_detach(tid);
+    }
+
+    for (i = 0; i < nsocks; i++)
+    {
+        if (pthread_create(&tid, NULL, rpc_dispatch, (void *)(long)socks[i])
+            != 0)
+        {
+            perror("vcfs_rpc: Could not start dispatcher");
+            exit(1);
+        }
+        pthread_detach(tid);
+    }
+
+    if (pthread_create(&tid, NULL, rpc_accept_conns, NULL) != 0)
+    {
+        perror("vcfs_rpc: Could not start TCP listener");
+        exit(1);
+    }
+    pthread_detach(tid);
+}
@@ -0,0 +1,187 @@
+#ifndef _VCFS_RPC_H_
+#define _VCFS_RPC_H_ 1
+
+#include <pthread.h>
+#include <netinet/in.h>
+#include <rpc/rpc.h>
+#include "nfsproto.h"
+#include "nfs3proto.h"
+#include "vcfs.h"
+
+/* The most file data we send back from one version 3 READ, and the most
+ * directory we send from one READDIR or READDIRPLUS
+ */
+#define VCFS_NFS3_MAXDATA 32768
+
+/* Big enough for any NFS call or reply we handle */
+#define VCFS_RPC_MSGSIZE (VCFS_NFS3_MAXDATA + 1024)
+
+/* The most entries we hand back from one READDIR. How many we send is
+ * up to the size the client asks for, and every entry takes at least 28
+ * bytes of a version 3 reply (20 of a version 2 one, which is never more
+ * than NFS_MAXDATA), so this many always fill the biggest reply we make.
+ */
+#define VCFS_READDIR_MAX (VCFS_NFS3_MAXDATA / 28)
+
+/* The same for READDIRPLUS, whose entries are far bigger */
+#define VCFS_READDIRPLUS_MAX 256
+
+/* How many UDP calls the duplicate request cache remembers, and for how
+ * many seconds it will send an answer again
+ */
+#define VCFS_DRC_SIZE 512
+#define VCFS_DRC_TIMEOUT 120
+
+/* What vcfs_drc_check() says about a call */
+#define VCFS_DRC_NEW 0
+#define VCFS_DRC_IN_PROGRESS 1
+#define VCFS_DRC_DONE 2
+
+/* The most UDP calls read, or replies sent, with one system call */
+#define VCFS_RPC_BATCH 32
+
+/* How much the kernel should queue up on each UDP socket */
+#define VCFS_RPC_RCVBUF (1024 * 1024)
+
+/* The most UDP sockets we will share the NFS port between */
+#define VCFS_MAX_UDP_SOCKS 16
+
+/* How many threads run NFS requests if the user doesn't say, and the most
+ * there can be. Each needs a namespace reader slot, and the main thread
+ * needs one too.
+ */
+#define VCFS_DEFAULT_WORKERS 4
+#define VCFS_MAX_WORKERS (VCFS_NS_MAX_READERS - 4)
+
+/* A TCP connection from an NFS client. It stays open until the client
+ * closes it and every request that came in on it has been answered.
+ */
+typedef struct vcfs_conn {
+    int sock;
+    int refs; /* The thread reading it, and each request from it */
+    pthread_mutex_t write_lock; /* Held while a reply is written */
+} vcfs_conn;
+
+/* Everything needed to run one NFS request and send its reply. The
+ * handlers in vcfs_nfs.c are given a pointer to the svc_req at the top of
+ * this, and build their results in here instead of in static variables.
+ */
+typedef struct vcfs_req {
+    struct svc_req svc; /* Must be first, see VCFS_REQ() */
+    struct sockaddr_in addr;
+    int sock; /* The UDP socket it came in on */
+    vcfs_conn *conn; /* NULL if the request came over UDP */
+    u_long xid;
+    struct vcfs_rpc_proc *proc;
+
+    union {
+        nfs_fh fh;
+        sattrargs sattr;
+        diropargs dirop;
+        readargs read;
+        writeargs write;
+        createargs create;
+        renameargs rename;
+        linkargs link;
+        symlinkargs symlink;
+        readdirargs readdir;
+
+        nfs_fh3 fh3;
+        diropargs3 dirop3;
+        ACCESS3args access3;
+        READ3args read3;
+        READDIR3args readdir3;
+        READDIRPLUS3args readdirplus3;
+    } args;
+
+    union {
+        int nothing;
+        nfsstat stat;
+        attrstat attr;
+        diropres dirop;
+        readlinkres readlink;
+        readres read;
+        readdirres readdir;
+        statfsres statfs;
+
+        GETATTR3res getattr3;
+        LOOKUP3res lookup3;
+        ACCESS3res access3;
+        READLINK3res readlink3;
+        READ3res read3;
+        WCC3res wcc3;
+        RENAME3res rename3;
+        LINK3res link3;
+        READDIR3res readdir3;
+        READDIRPLUS3res readdirplus3;
+        FSSTAT3res fsstat3;
+        FSINFO3res fsinfo3;
+        PATHCONF3res pathconf3;
+    } res;
+
+    /* A successful READ holds on to the cached file until the reply has
+     * been sent, and the data is sent straight from it after the rest of
+     * the reply
+     */
+    vcfs_blob *read_blob;
+    char *read_data;
+    int read_len;
+
+    /* Storage the results point into. Directory entry names point
+     * straight into the namespace, which stays put until the reply has
+     * been encoded.
+     */
+    union {
+        entry v2[VCFS_READDIR_MAX];
+        entry3 v3[VCFS_READDIR_MAX];
+        entryplus3 plus[VCFS_READDIRPLUS_MAX];
+    } entries;
+    nfs_fh handles[VCFS_READDIRPLUS_MAX];
+
+    /* Set when the request is run again after waiting for a file */
+    int waited;
+    vcfs_blob *blob;
+
+    int len;
+    char buf[VCFS_RPC_MSGSIZE];
+
+    struct vcfs_req *next;
+} vcfs_req;
+
+/* Get from the svc_req a handler was called with to the whole request */
+#define VCFS_REQ(rp) ((vcfs_req *)(rp))
+
+/* One NFS procedure */
+typedef struct vcfs_rpc_proc {
+    xdrproc_t xdr_args;
+    xdrproc_t xdr_res;
+    void *(*run)(void *args, struct svc_req *rp);
+} vcfs_rpc_proc;
+
+void vcfs_rpc_start(int *socks, int nsocks, int tcpsock, int nworkers);
+void vcfs_rpc_resume(vcfs_req *req);
+void vcfs_rpc_flush();
+
+/* Hand-written XDR for the busiest procedures (vcfs_xdr.c) */
+bool_t vcfs_xdr_attrstat(XDR *xdrs, attrstat *objp);
+bool_t vcfs_xdr_diropres(XDR *xdrs, diropres *objp);
+bool_t vcfs_xdr_readres(XDR *xdrs, readres *objp);
+bool_t vcfs_xdr_readdirres(XDR *xdrs, readdirres *objp);
+bool_t vcfs_xdr_nfs_fh(XDR *xdrs, nfs_fh *objp);
+bool_t vcfs_xdr_diropargs(XDR *xdrs, diropargs *objp);
+bool_t vcfs_xdr_readargs(XDR *xdrs, readargs *objp);
+bool_t vcfs_xdr_readdirargs(XDR *xdrs, readdirargs *objp);
+bool_t vcfs_xdr_GETATTR3res(XDR *xdrs, GETATTR3res *objp);
+bool_t vcfs_xdr_LOOKUP3res(XDR *xdrs, LOOKUP3res *objp);
+bool_t vcfs_xdr_READ3res(XDR *xdrs, READ3res *objp);
+bool_t vcfs_xdr_READDIR3res(XDR *xdrs, READDIR3res *objp);
+bool_t vcfs_xdr_nfs_fh3(XDR *xdrs, nfs_fh3 *objp);
+bool_t vcfs_xdr_diropargs3(XDR *xdrs, diropargs3 *objp);
+bool_t vcfs_xdr_READ3args(XDR *xdrs, READ3args *objp);
+bool_t vcfs_xdr_READDIR3args(XDR *xdrs, READDIR3args *objp);
+
+/* Duplicate request cache (vcfs_drc.c) */
+int vcfs_drc_check(vcfs_req *req);
+void vcfs_drc_done(vcfs_req *req);
+
+#endif
@@ -0,0 +1,556 @@
+/****************************************************************************
+ * File: vcfs_view.c
+ * Views of the project at other tags and dates. Looking up .tags/REL_1 at
+ * the top of the project gives a directory that looks like the project as
+ * it was tagged REL_1, so it can be compared with what's checked out with
+ * an ordinary 'diff -r', on the same mount. Likewise .at/2001-01-31 is the
+ * trunk as it was at midnight (UTC) at the start of that day, as
+ * 'cvs co -D' would give it, and .at/2001-01-31T12:30 is the trunk at
+ * half past twelve.
+ *
+ * A view is made a directory at a time, the first time anyone looks in it.
+ * Which revision of each file to show comes from the module index
+ * (vcfs_index.c), or from one "rlog" of the directory if the index isn't
+ * ready, doesn't know the tag, or is older than the date. The files in a
+ * view have their own ventries, since the ones in the main tree are
+ * replaced whenever a refresh changes them, but their contents come from
+ * the same cache. A view never changes once it has been made, so a view
+ * of a date that hasn't passed yet shows the trunk as it was when it was
+ * first looked at.
+ ***************************************************************************/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vcfs.h"
+#include "utils.h"
+
+/* What kind of view a name is in */
+#define VIEW_NONE 0
+#define VIEW_TAG 1
+#define VIEW_AT 2
+
+/* A file in a view, relative to the directory being filled in */
+typedef struct view_file {
+    char *rel;
+    vcfs_ver ver;
+    time_t when;
+} view_file;
+
+/* Take a name apart: which kind of view it is in, the tag or date of the
+ * view (empty for .tags and .at themselves), and the real path of the
+ * file, with .tags/TAG or .at/DATE taken out. key and real may be NULL.
+ * Names that aren't in a view give VIEW_NONE, and real is just a copy.
+ */
+static int view_split(char *name, vcfs_tag key, vcfs_path real)
+{
+    static char *dirs[] = { NULL, VCFS_TAGS_DIR, VCFS_AT_DIR };
+    vcfs_ventry *root = vcfs_ns_root();
+    vcfs_path out;
+    char *rest = NULL;
+    char *end;
+    int kind;
+    int len;
+    int dlen;
+
+    len = (root != NULL) ? strlen(root->name) : 0;
+
+    for (kind = VIEW_AT; kind > VIEW_NONE; kind--)
+    {
+        if (len == 0 || strncmp(name, root->name, len) || name[len] != '/')
+        {
+            continue;
+        }
+
+        dlen = strlen(dirs[kind]);
+        if (!strncmp(name + len + 1, dirs[kind], dlen) &&
+            (name[len + 1 + dlen] == '\0' || name[len + 1 + dlen] == '/'))
+        {
+            rest = name + len + 1 + dlen;
+            break;
+        }
+    }
+
+    if (kind == VIEW_NONE)
+    {
+        if (real != NULL && real != name)
+        {
+            strcpy(real, name);
+        }
+        return VIEW_NONE;
+    }
+
+    /* Skip .tags or .at, then the tag or date */
+    if (*rest == '/')
+    {
+        rest++;
+    }
+    end = strchr(rest, '/');
+
+    if (key != NULL)
+    {
+        len = (end != NULL) ? end - rest : (int)strlen(rest);
+        snprintf(key, VCFS_TAG_LEN, "%.*s", len, rest);
+    }
+
+    if (real != NULL)
+    {
+        snprintf(out, sizeof(out), "%s%s", root->name,
+                 (end != NULL) ? end : "");
+        strcpy(real, out);
+    }
+
+    return kind;
+}
+
+/* Work out what a name in a view stands for in the project. Returns 1 if
+ * the name is in a view (real may be NULL if all you want to know is
+ * that), otherwise real is just a copy of the name.
+ */
+int vcfs_view_real(char *name, vcfs_path real)
+{
+    return view_split(name, NULL, real) != VIEW_NONE;
+}
+
+/* Could this be the name of a tag? Anything else that is looked up in
+ * .tags (shells and editors look for all sorts) doesn't need a trip to the
+ * server.
+ */
+static int view_tag_name(char *name)
+{
+    char *p;
+
+    if (!isalpha((unsigned char)name[0]) || strlen(name) >= VCFS_TAG_LEN)
+    {
+        return 0;
+    }
+
+    for (p = name; *p != '\0'; p++)
+    {
+        if (!isalnum((unsigned char)*p) && *p != '-' && *p != '_')
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* Is this a date, as YYYY-MM-DD, YYYY-MM-DDTHH:MM or YYYY-MM-DDTHH:MM:SS?
+ * If so, when is the time (UTC) it stands for. Version extended names
+ * (foo.c,@2001-01-31) use the same dates.
+ */
+int vcfs_view_date(char *name, time_t *when)
+{
+    static char *pattern = "0000-00-00T00:00:00";
+    struct tm tm;
+    int len = strlen(name);
+    int mday;
+    int i;
+
+    if (len != 10 && len != 16 && len != 19)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < len; i++)
+    {
+        if ((pattern[i] == '0') ? !isdigit((unsigned char)name[i]) :
+            name[i] != pattern[i])
+        {
+            return 0;
+        }
+    }
+
+    memset(&tm, 0, sizeof(tm));
+    sscanf(name, "%d-%d-%dT%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+           &tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+
+    if (tm.tm_mon < 1 || tm.tm_mon > 12 || tm.tm_mday < 1 ||
+        tm.tm_hour > 23 || tm.tm_min > 59 || tm.tm_sec > 59)
+    {
+        return 0;
+    }
+
+    tm.tm_year -= 1900;
+    tm.tm_mon--;
+    mday = tm.tm_mday;
+    *when = timegm(&tm);
+
+    /* timegm() takes the 31st of February to be in March */
+    return tm.tm_mday == mday;
+}
+
+static void view_free(view_file *files, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        free(files[i].rel);
+    }
+    free(files);
+}
+
+/* Add revision r of a file to the files found for a view */
+static void view_push(view_file **files, int *n, int *max, char *rel,
+                      vcfs_index *x, int r)
+{
+    if (*n == *max)
+    {
+        *max = *max ? *max * 2 : 64;
+        *files = (view_file *)realloc(*files, *max * sizeof(view_file));
+    }
+
+    (*files)[*n].rel = strdup(rel);
+    memcpy((*files)[*n].ver, x->rev_ver[r], sizeof(vcfs_ver));
+    (*files)[*n].when = x->rev_when[r];
+    (*n)++;
+}
+
+/* Find the revision of every file under a directory that carries a tag.
+ * Returns how many there are, or -1 if the server couldn't tell us.
+ */
+static int view_tagged(char *tag, char *dir, view_file **files)
+{
+    vcfs_index *x;
+    vcfs_index *tmp = NULL;
+    char *name;
+    int first;
+    int count;
+    int len = strlen(dir);
+    int max = 0;
+    int n = 0;
+    int file;
+    int i;
+    int t;
+    int r;
+
+    *files = NULL;
+
+    x = vcfs_index_get();
+    if (x == NULL || (count = vcfs_index_tagged(x, tag, &first)) == 0)
+    {
+        /* The index isn't ready, or the tag is newer than it */
+        x = tmp = vcfs_index_read(dir);
+        if (x == NULL)
+        {
+            return -1;
+        }
+        count = vcfs_index_tagged(x, tag, &first);
+    }
+
+    for (i = first; i < first + count; i++)
+    {
+        t = x->tag_order[i];
+        file = x->tag_file[t];
+        name = x->strs + x->file_name[file];
+
+        if (strncmp(name, dir, len) || name[len] != '/')
+        {
+            continue;
+        }
+
+        /* Files that were removed before they were tagged aren't there */
+        r = vcfs_index_rev(x, file, x->tag_ver[t]);
+        if (r < 0 || !strcmp(x->strs + x->rev_state[r], "dead"))
+        {
+            continue;
+        }
+
+        view_push(files, &n, &max, name + len + 1, x, r);
+    }
+
+    if (tmp != NULL)
+    {
+        vcfs_index_free(tmp);
+    }
+
+    return n;
+}
+
+/* Find the revision of every file under a directory on the trunk at a
+ * time. Returns how many there are, or -1 if the server couldn't tell us.
+ */
+static int view_dated(time_t when, char *dir, view_file **files)
+{
+    vcfs_index *x;
+    vcfs_index *tmp = NULL;
+    char *name;
+    int len = strlen(dir);
+    int max = 0;
+    int n = 0;
+    int file;
+    int r;
+
+    *files = NULL;
+
+    x = vcfs_index_get();
+    if (x == NULL || x->built <= when)
+    {
+        /* The index can't know what was committed after it was made.
+         * Revisions of files that have changed since are still right.
+         */
+        x = tmp = vcfs_index_read(dir);
+        if (x == NULL)
+        {
+            return -1;
+        }
+    }
+
+    for (file = 0; file < x->nfiles; file++)
+    {
+        name = x->strs + x->file_name[file];
+
+        if (strncmp(name, dir, len) || name[len] != '/')
+        {
+            continue;
+        }
+
+        /* Files that hadn't been added yet, or had been removed */
+        r = vcfs_index_at(x, file, when);
+        if (r < 0 || !strcmp(x->strs + x->rev_state[r], "dead"))
+        {
+            continue;
+        }
+
+        view_push(files, &n, &max, name + len + 1, x, r);
+    }
+
+    if (tmp != NULL)
+    {
+        vcfs_index_free(tmp);
+    }
+
+    return n;
+}
+
+/* Find the files under a directory in a view of a tag or date */
+static int view_files(int kind, char *key, char *dir, view_file **files)
+{
+    time_t when;
+
+    if (kind == VIEW_TAG)
+    {
+        return view_tagged(key, dir, files);
+    }
+
+    *files = NULL;
+    return vcfs_view_date(key, &when) ? view_dated(when, dir, files) : 0;
+}
+
+/* Put the files found by view_files() into a view directory. Files in
+ * subdirectories get the subdirectory, which is filled in when somebody
+ * looks in it. Must be called from within a transaction.
+ */
+static void view_add(vcfs_ventry *d, char *real, view_file *files, int n)
+{
+    vcfs_path path;
+    vcfs_path name;
+    vcfs_fileid *f;
+    vcfs_ventry *v;
+    vcfs_blob *b;
+    char *slash;
+    time_t newest = 0;
+    int size;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        if (files[i].when > newest)
+        {
+            newest = files[i].when;
+        }
+
+        slash = strchr(files[i].rel, '/');
+
+        if (slash != NULL)
+        {
+            /* Something in a subdirectory */
+            snprintf(path, sizeof(path), "%s/%.*s", d->name,
+                     (int)(slash - files[i].rel), files[i].rel);
+
+            f = lookup_fh_name(path);
+            if (f == NULL)
+            {
+                v = create_ventry(path, 2048, NFDIR, 0, NULL, files[i].when,
+                                  d->tag);
+                v->lazy = 1;
+                create_fh(path, 1, v);
+            }
+            else if (files[i].when > f->ventry->mtime)
+            {
+                vcfs_ns_edit(path)->mtime = files[i].when;
+            }
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/%s", d->name, files[i].rel);
+        if (lookup_fh_name(path) != NULL)
+        {
+            continue;
+        }
+
+        /* If we have this revision we know how big it is. If not, guess
+         * the size of the checked out one; vcfs_read() puts it right.
+         */
+        snprintf(name, sizeof(name), "%s/%s", real, files[i].rel);
+        f = lookup_fh_name(name);
+        size = (f != NULL && f->ventry != NULL) ? f->ventry->size : 0;
+
+        b = vcfs_cache_get(name, files[i].ver);
+        if (b != NULL)
+        {
+            size = b->size;
+            vcfs_cache_release(b);
+        }
+
+        v = create_ventry(path, size, NFREG, 0, files[i].ver, files[i].when,
+                          d->tag);
+        create_fh(path, 1, v);
+    }
+
+    if (newest != 0)
+    {
+        d->mtime = newest;
+    }
+}
+
+/* Fill in a view directory if nobody has yet. Returns the fileid of the
+ * directory as it is now.
+ */
+vcfs_fileid *vcfs_view_fill(vcfs_fileid *d)
+{
+    vcfs_path real;
+    vcfs_tag key;
+    view_file *files;
+    vcfs_fileid *f;
+    vcfs_ventry *v;
+    int kind;
+    int n;
+
+    if (d->ventry == NULL || !d->ventry->lazy)
+    {
+        return d;
+    }
+
+    kind = view_split(d->name, key, real);
+
+    n = view_files(kind, key, real, &files);
+    if (n < 0)
+    {
+        /* Try again next time */
+        return d;
+    }
+
+    vcfs_ns_begin();
+
+    f = lookup_fh_name(d->name);
+    if (f != NULL && f->ventry->lazy)
+    {
+        v = vcfs_ns_edit(d->name);
+        v->lazy = 0;
+        view_add(v, real, files, n);
+        f = lookup_fh_name(d->name);
+    }
+
+    vcfs_ns_commit();
+
+    DEBUG(DEBUG_M, "[vcfs_view_fill] %s: %d files", d->name, n);
+    view_free(files, n);
+
+    return (f != NULL) ? f : d;
+}
+
+/* Look up the names that make views: .tags and .at at the top of the
+ * project, a tag in .tags and a date in .at. Returns NULL for anything
+ * else, and for tags and dates that no file has.
+ */
+vcfs_fileid *vcfs_view_lookup(vcfs_fileid *d, char *name)
+{
+    vcfs_ventry *root = vcfs_ns_root();
+    vcfs_path path;
+    vcfs_tag key;
+    view_file *files;
+    vcfs_fileid *f;
+    vcfs_ventry *v;
+    time_t when;
+    int kind;
+    int n;
+
+    if (d->ventry == NULL || root == NULL)
+    {
+        return NULL;
+    }
+
+    snprintf(path, sizeof(path), "%s/%s", d->name, name);
+
+    if (d->ventry->id == root->id &&
+        (!strcmp(name, VCFS_TAGS_DIR) || !strcmp(name, VCFS_AT_DIR)))
+    {
+        f = lookup_fh_name(path);
+        if (f != NULL)
+        {
+            return f;
+        }
+
+        vcfs_ns_begin();
+
+        f = lookup_fh_name(path);
+        if (f == NULL)
+        {
+            v = create_ventry(path, 2048, NFDIR, 0, NULL, root->mtime, NULL);
+            f = create_fh(path, 1, v);
+        }
+
+        vcfs_ns_commit();
+        return f;
+    }
+
+    /* Only .tags and .at themselves, not the views in them */
+    kind = view_split(d->name, key, NULL);
+    if (kind == VIEW_NONE || key[0] != '\0')
+    {
+        return NULL;
+    }
+
+    f = lookup_fh_name(path);
+    if (f != NULL || vcfs_neg_check(path) ||
+        (kind == VIEW_TAG && !view_tag_name(name)) ||
+        (kind == VIEW_AT && !vcfs_view_date(name, &when)))
+    {
+        return f;
+    }
+
+    n = view_files(kind, name, root->name, &files);
+    if (n <= 0)
+    {
+        if (n == 0)
+        {
+            vcfs_neg_add(path);
+        }
+        return NULL;
+    }
+
+    vcfs_ns_begin();
+
+    f = lookup_fh_name(path);
+    if (f == NULL)
+    {
+        v = create_ventry(path, 2048, NFDIR, 0, NULL, root->mtime,
+                          (kind == VIEW_TAG) ? name : NULL);
+        create_fh(path, 1, v);
+        view_add(v, root->name, files, n);
+        f = lookup_fh_name(path);
+    }
+
+    vcfs_ns_commit();
+
+    DEBUG(DEBUG_M, "[vcfs_view_lookup] %s: %d files", path, n);
+    view_free(files, n);
+
+    return f;
+}
@@ -0,0 +1,872 @@
+/****************************************************************************
+ * File: vcfs_xdr.c
+ * XDR routines written by hand for the calls that make up nearly all of
+ * our traffic: GETATTR, LOOKUP, READ and READDIR, in both versions. The
+ * rpcgen ones go through a chain of xdr_*() calls for every field; these
+ * work out how big the whole thing is, get that much of the buffer with
+ * one XDR_INLINE() and store straight into it.
+ *
+ * They can be used anywhere the rpcgen ones can. Anything they don't
+ * handle themselves (freeing, or a stream that won't give them a buffer)
+ * is passed on to the rpcgen routine. Build with -DVCFS_XDR_VERIFY ('make
+ * verify') to have everything they do checked against the rpcgen routine
+ * as it happens.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vcfs_rpc.h"
+#include "utils.h"
+
+/* Sizes, in XDR units, of the parts that are always the same size */
+#define FATTR_UNITS 17
+#define FATTR3_UNITS 21
+#define FH_UNITS (NFS_FHSIZE / BYTES_PER_XDR_UNIT)
+#define COOKIE_UNITS (NFS_COOKIESIZE / BYTES_PER_XDR_UNIT)
+#define COOKIEVERF3_UNITS (NFS3_COOKIEVERFSIZE / BYTES_PER_XDR_UNIT)
+
+/* How many units some bytes take up, padding included */
+#define UNITS(len) (RNDUP(len) / BYTES_PER_XDR_UNIT)
+
+#define PUT_HYPER(buf, v) \
+    (IXDR_PUT_U_INT32(buf, (v) >> 32), IXDR_PUT_U_INT32(buf, (v)))
+
+#define GET_HYPER(buf, v) \
+    ((v) = (u_quad_t)IXDR_GET_U_INT32(buf) << 32, \
+     (v) |= IXDR_GET_U_INT32(buf))
+
+#ifdef VCFS_XDR_VERIFY
+
+/* Encode something with an rpcgen routine. Returns how long it came out,
+ * or -1 if it wouldn't go.
+ */
+static int xdr_generic_encode(xdrproc_t proc, void *objp, char *buf)
+{
+    XDR xdrs;
+    int len = -1;
+
+    xdrmem_create(&xdrs, buf, VCFS_RPC_MSGSIZE, XDR_ENCODE);
+    if ((*proc)(&xdrs, objp))
+    {
+        len = xdr_getpos(&xdrs);
+    }
+    xdr_destroy(&xdrs);
+
+    return len;
+}
+
+/* Check that we encoded objp the same way the rpcgen routine does */
+static void xdr_verify_encode(xdrproc_t proc, void *objp, char *ours,
+                              int len)
+{
+    char *theirs;
+
+    theirs = (char *)malloc(VCFS_RPC_MSGSIZE);
+
+    ASSERT(xdr_generic_encode(proc, objp, theirs) == len &&
+           !memcmp(ours, theirs, len), "Hand-written XDR encoded wrong");
+
+    free(theirs);
+}
+
+/* Check that we decoded what is between pos and where xdrs is now the same
+ * way the rpcgen routine does. It is read again from the stream, and the
+ * two results are compared by encoding them, so that pointers and padding
+ * don't matter.
+ */
+static void xdr_verify_decode(xdrproc_t proc, void *objp, int size,
+                              XDR *xdrs, u_int pos)
+{
+    u_int end = xdr_getpos(xdrs);
+    void *obj;
+    char *ours;
+    char *theirs;
+    int len;
+    int ok;
+
+    if (!xdr_setpos(xdrs, pos))
+    {
+        /* A stream that can't go back; nothing to check against */
+        return;
+    }
+
+    obj = calloc(1, size);
+    ours = (char *)malloc(VCFS_RPC_MSGSIZE);
+    theirs = (char *)malloc(VCFS_RPC_MSGSIZE);
+
+    ok = (*proc)(xdrs, obj) && xdr_getpos(xdrs) == end;
+
+    if (ok)
+    {
+        len = xdr_generic_encode(proc, objp, ours);
+        ok = len >= 0 && xdr_generic_encode(proc, obj, theirs) == len &&
+            !memcmp(ours, theirs, len);
+    }
+
+    ASSERT(ok, "Hand-written XDR decoded wrong");
+
+    xdr_free(proc, (char *)obj);
+    free(obj);
+    free(ours);
+    free(theirs);
+}
+
+/* An encoder has put exactly units units in front of end */
+#define VERIFY_ENCODE(proc, objp, end, units) \
+    xdr_verify_encode((xdrproc_t)proc, objp, (char *)((end) - (units)), \
+                      (units) * BYTES_PER_XDR_UNIT)
+
+/* A decoder notes where it starts, and is checked when it's done */
+#define VERIFY_MARK(xdrs, pos) ((pos) = xdr_getpos(xdrs))
+#define VERIFY_DECODE(proc, objp, xdrs, pos) \
+    xdr_verify_decode((xdrproc_t)proc, objp, sizeof(*(objp)), xdrs, pos)
+
+#else
+
+#define VERIFY_ENCODE(proc, objp, end, units)
+#define VERIFY_MARK(xdrs, pos)
+#define VERIFY_DECODE(proc, objp, xdrs, pos)
+
+#endif
+
+/* Store a counted string or opaque, with its padding */
+static int32_t *xdr_put_bytes(int32_t *buf, char *data, u_int len)
+{
+    IXDR_PUT_U_INT32(buf, len);
+
+    if (len % BYTES_PER_XDR_UNIT)
+    {
+        buf[len / BYTES_PER_XDR_UNIT] = 0;
+    }
+    memcpy(buf, data, len);
+
+    return buf + UNITS(len);
+}
+
+/* Copy out a string whose length we have just read. Like xdr_string(), we
+ * allocate it if the caller didn't give us somewhere to put it.
+ */
+static bool_t xdr_get_string(XDR *xdrs, char **sp, u_int len)
+{
+    int32_t *buf;
+
+    /* Anything this long can't be in the call, and would overflow below */
+    if (len >= VCFS_RPC_MSGSIZE)
+    {
+        return FALSE;
+    }
+
+    buf = XDR_INLINE(xdrs, RNDUP(len));
+    if (buf == NULL)
+    {
+        return FALSE;
+    }
+
+    if (*sp == NULL)
+    {
+        *sp = (char *)malloc(len + 1);
+    }
+    memcpy(*sp, buf, len);
+    (*sp)[len] = '\0';
+
+    return TRUE;
+}
+
+/****************************************************************************
+ * Version 2
+ ***************************************************************************/
+
+static int32_t *xdr_put_fattr(int32_t *buf, fattr *fa)
+{
+    IXDR_PUT_U_INT32(buf, fa->type);
+    IXDR_PUT_U_INT32(buf, fa->mode);
+    IXDR_PUT_U_INT32(buf, fa->nlink);
+    IXDR_PUT_U_INT32(buf, fa->uid);
+    IXDR_PUT_U_INT32(buf, fa->gid);
+    IXDR_PUT_U_INT32(buf, fa->size);
+    IXDR_PUT_U_INT32(buf, fa->blocksize);
+    IXDR_PUT_U_INT32(buf, fa->rdev);
+    IXDR_PUT_U_INT32(buf, fa->blocks);
+    IXDR_PUT_U_INT32(buf, fa->fsid);
+    IXDR_PUT_U_INT32(buf, fa->fileid);
+    IXDR_PUT_U_INT32(buf, fa->atime.seconds);
+    IXDR_PUT_U_INT32(buf, fa->atime.useconds);
+    IXDR_PUT_U_INT32(buf, fa->mtime.seconds);
+    IXDR_PUT_U_INT32(buf, fa->mtime.useconds);
+    IXDR_PUT_U_INT32(buf, fa->ctime.seconds);
+    IXDR_PUT_U_INT32(buf, fa->ctime.useconds);
+
+    return buf;
+}
+
+/* GETATTR results */
+bool_t vcfs_xdr_attrstat(XDR *xdrs, attrstat *objp)
+{
+    int32_t *buf;
+    u_int units;
+
+    if (xdrs->x_op != XDR_ENCODE)
+    {
+        return xdr_attrstat(xdrs, objp);
+    }
+
+    units = 1;
+    if (objp->status == NFS_OK)
+    {
+        units += FATTR_UNITS;
+    }
+
+    buf = XDR_INLINE(xdrs, units * BYTES_PER_XDR_UNIT);
+    if (buf == NULL)
+    {
+        return xdr_attrstat(xdrs, objp);
+    }
+
+    IXDR_PUT_U_INT32(buf, objp->status);
+    if (objp->status == NFS_OK)
+    {
+        buf = xdr_put_fattr(buf, &objp->attrstat_u.attributes);
+    }
+
+    VERIFY_ENCODE(xdr_attrstat, objp, buf, units);
+    return TRUE;
+}
+
+/* LOOKUP results */
+bool_t vcfs_xdr_diropres(XDR *xdrs, diropres *objp)
+{
+    diropokres *ok = &objp->diropres_u.diropres;
+    int32_t *buf;
+    u_int units;
+
+    if (xdrs->x_op != XDR_ENCODE)
+    {
+        return xdr_diropres(xdrs, objp);
+    }
+
+    units = 1;
+    if (objp->status == NFS_OK)
+    {
+        units += FH_UNITS + FATTR_UNITS;
+    }
+
+    buf = XDR_INLINE(xdrs, units * BYTES_PER_XDR_UNIT);
+    if (buf == NULL)
+    {
+        return xdr_diropres(xdrs, objp);
+    }
+
+    IXDR_PUT_U_INT32(buf, objp->status);
+    if (objp->status == NFS_OK)
+    {
+        memcpy(buf, ok->file.data, NFS_FHSIZE);
+        buf += FH_UNITS;
+        buf = xdr_put_fattr(buf, &ok->attributes);
+    }
+
+    VERIFY_ENCODE(xdr_diropres, objp, buf, units);
+    return TRUE;
+}
+
+/* READ results. The data is usually empty, see rpc_reply() */
+bool_t vcfs_xdr_readres(XDR *xdrs, readres *objp)
+{
+    readokres *ok = &objp->readres_u.reply;
+    int32_t *buf;
+    u_int units;
+
+    if (xdrs->x_op != XDR_ENCODE ||
+        (objp->status == NFS_OK && ok->data.data_len > NFS_MAXDATA))
+    {
+        return xdr_readres(xdrs, objp);
+    }
+
+    units = 1;
+    if (objp->status == NFS_OK)
+    {
+        units += FATTR_UNITS + 1 + UNITS(ok->data.data_len);
+    }
+
+    buf = XDR_INLINE(xdrs, units * BYTES_PER_XDR_UNIT);
+    if (buf == NULL)
+    {
+        return xdr_readres(xdrs, objp);
+    }
+
+    IXDR_PUT_U_INT32(buf, objp->status);
+    if (objp->status == NFS_OK)
+    {
+        buf = xdr_put_fattr(buf, &ok->attributes);
+        buf = xdr_put_bytes(buf, ok->data.data_val, ok->data.data_len);
+    }
+
+    VERIFY_ENCODE(xdr_readres, objp, buf, units);
+    return TRUE;
+}
+
+/* READDIR results */
+bool_t vcfs_xdr_readdirres(XDR *xdrs, readdirres *objp)
+{
+    entry *e;
+    int32_t *buf;
+    u_int units;
+    u_int len;
+
+    if (xdrs->x_op != XDR_ENCODE)
+    {
+        return xdr_readdirres(xdrs, objp);
+    }
+
+    units = 1;
+    if (objp->status == NFS_OK)
+    {
+        for (e = objp->readdirres_u.reply.entries; e != NULL; e = e->nextentry)
+        {
+            len = strlen(e->name);
+            if (len > NFS_MAXNAMLEN)
+            {
+                return xdr_readdirres(xdrs, objp);
+            }
+            units += 3 + UNITS(len) + COOKIE_UNITS;
+        }
+        units += 2;
+    }
+
+    buf = XDR_INLINE(xdrs, units * BYTES_PER_XDR_UNIT);
+    if (buf == NULL)
+    {
+        return xdr_readdirres(xdrs, objp);
+    }
+
+    IXDR_PUT_U_INT32(buf, objp->status);
+    if (objp->status == NFS_OK)
+    {
+        for (e = objp->readdirres_u.reply.entries; e != NULL; e = e->nextentry)
+        {
+            IXDR_PUT_U_INT32(buf, TRUE);
+            IXDR_PUT_U_INT32(buf, e->fileid);
+            buf = xdr_put_bytes(buf, e->name, strlen(e->name));
+            memcpy(buf, e->cookie, NFS_COOKIESIZE);
+            buf += COOKIE_UNITS;
+        }
+        IXDR_PUT_U_INT32(buf, FALSE);
+        IXDR_PUT_U_INT32(buf, objp->readdirres_u.reply.eof);
+    }
+
+    VERIFY_ENCODE(xdr_readdirres, objp, buf, units);
+    return TRUE;
+}
+
+/* GETATTR arguments */
+bool_t vcfs_xdr_nfs_fh(XDR *xdrs, nfs_fh *objp)
+{
+    int32_t *buf;
+#ifdef VCFS_XDR_VERIFY
+    u_int pos;
+#endif
+
+    if (xdrs->x_op != XDR_DECODE)
+    {
+        return xdr_nfs_fh(xdrs, objp);
+    }
+
+    VERIFY_MARK(xdrs, pos);
+    buf = XDR_INLINE(xdrs, NFS_FHSIZE);
+    if (buf == NULL)
+    {
+        return xdr_nfs_fh(xdrs, objp);
+    }
+
+    memcpy(objp->data, buf, NFS_FHSIZE);
+
+    VERIFY_DECODE(xdr_nfs_fh, objp, xdrs, pos);
+    return TRUE;
+}
+
+/* LOOKUP arguments */
+bool_t vcfs_xdr_diropargs(XDR *xdrs, diropargs *objp)
+{
+    int32_t *buf;
+    u_int len;
+#ifdef VCFS_XDR_VERIFY
+    u_int pos;
+#endif
+
+    if (xdrs->x_op != XDR_DECODE)
+    {
+        return xdr_diropargs(xdrs, objp);
+    }
+
+    VERIFY_MARK(xdrs, pos);
+    buf = XDR_INLINE(xdrs, NFS_FHSIZE + BYTES_PER_XDR_UNIT);
+    if (buf == NULL)
+    {
+        return xdr_diropargs(xdrs, objp);
+    }
+
+    memcpy(objp->dir.data, buf, NFS_FHSIZE);
+    buf += FH_UNITS;
+
+    len = IXDR_GET_U_INT32(buf);
+    if (len > NFS_MAXNAMLEN || !xdr_get_string(xdrs, &objp->name, len))
+    {
+        return FALSE;
+    }
+
+    VERIFY_DECODE(xdr_diropargs, objp, xdrs, pos);
+    return TRUE;
+}
+
+/* READ arguments */
+bool_t vcfs_xdr_readargs(XDR *xdrs, readargs *objp)
+{
+    int32_t *buf;
+#ifdef VCFS_XDR_VERIFY
+    u_int pos;
+#endif
+
+    if (xdrs->x_op != XDR_DECODE)
+    {
+        return xdr_readargs(xdrs, objp);
+    }
+
+    VERIFY_MARK(xdrs, pos);
+    buf = XDR_INLINE(xdrs, NFS_FHSIZE + 3 * BYTES_PER_XDR_UNIT);
+    if (buf == NULL)
+    {
+        return xdr_readargs(xdrs, objp);
+    }
+
+    memcpy(objp->file.data, buf, NFS_FHSIZE);
+    buf += FH_UNITS;
+    objp->offset = IXDR_GET_U_INT32(buf);
+    objp->count = IXDR_GET_U_INT32(buf);
+    objp->totalcount = IXDR_GET_U_INT32(buf);
+
+    VERIFY_DECODE(xdr_readargs, objp, xdrs, pos);
+    return TRUE;
+}
+
+/* READDIR arguments */
+bool_t vcfs_xdr_readdirargs(XDR *xdrs, readdirargs *objp)
+{
+    int32_t *buf;
+#ifdef VCFS_XDR_VERIFY
+    u_int pos;
+#endif
+
+    if (xdrs->x_op != XDR_DECODE)
+    {
+        return xdr_readdirargs(xdrs, objp);
+    }
+
+    VERIFY_MARK(xdrs, pos);
+    buf = XDR_INLINE(xdrs, NFS_FHSIZE + NFS_COOKIESIZE +
+                             BYTES_PER_XDR_UNIT);
+    if (buf == NULL)
+    {
+        return xdr_readdirargs(xdrs, objp);
+    }
+
+    memcpy(objp->dir.data, buf, NFS_FHSIZE);
+    buf += FH_UNITS;
+    memcpy(objp->cookie, buf, NFS_COOKIESIZE);
+    buf += COOKIE_UNITS;
+    objp->count = IXDR_GET_U_INT32(buf);
+
+    VERIFY_DECODE(xdr_readdirargs, objp, xdrs, pos);
+    return TRUE;
+}
+
+/****************************************************************************
+ * Version 3
+ ***************************************************************************/
+
+static int32_t *xdr_put_fattr3(int32_t *buf, fattr3 *fa)
+{
+    IXDR_PUT_U_INT32(buf, fa->type);
+    IXDR_PUT_U_INT32(buf, fa->mode);
+    IXDR_PUT_U_INT32(buf, fa->nlink);
+    IXDR_PUT_U_INT32(buf, fa->uid);
+    IXDR_PUT_U_INT32(buf, fa->gid);
+    PUT_HYPER(buf, fa->size);
+    PUT_HYPER(buf, fa->used);
+    IXDR_PUT_U_INT32(buf, fa->rdev.specdata1);
+    IXDR_PUT_U_INT32(buf, fa->rdev.specdata2);
+    PUT_HYPER(buf, fa->fsid);
+    PUT_HYPER(buf, fa->fileid);
+    IXDR_PUT_U_INT32(buf, fa->atime.seconds);
+    IXDR_PUT_U_INT32(buf, fa->atime.nseconds);
+    IXDR_PUT_U_INT32(buf, fa->mtime.seconds);
+    IXDR_PUT_U_INT32(buf, fa->mtime.nseconds);
+    IXDR_PUT_U_INT32(buf, fa->ctime.seconds);
+    IXDR_PUT_U_INT32(buf, fa->ctime.nseconds);
+
+    return buf;
+}
+
+static u_int post_op_attr_units(post_op_attr *pa)
+{
+    return 1 + (pa->attributes_follow ? FATTR3_UNITS : 0);
+}
+
+static int32_t *xdr_put_post_op_attr(int32_t *buf, post_op_attr *pa)
+{
+    IXDR_PUT_U_INT32(buf, pa->attributes_follow);
+    if (pa->attributes_follow)
+    {
+        buf = xdr_put_fattr3(buf, &pa->post_op_attr_u.attributes);
+    }
+
+    return buf;
+}
+
+/* Read a version 3 file handle. Like xdr_bytes(), we allocate room for it
+ * if the caller didn't, unless it's empty.
+ */
+static bool_t xdr_get_fh3(XDR *xdrs, nfs_fh3 *fh)
+{
+    int32_t *buf;
+    u_int len;
+
+    buf = XDR_INLINE(xdrs, BYTES_PER_XDR_UNIT);
+    if (buf == NULL)
+    {
+        return FALSE;
+    }
+
+    len = IXDR_GET_U_INT32(buf);
+    if (len > NFS3_FHSIZE)
+    {
+        return FALSE;
+    }
+
+    fh->data.data_len = len;
+    if (len == 0)
+    {
+        return TRUE;
+    }
+
+    buf = XDR_INLINE(xdrs, RNDUP(len));
+    if (buf == NULL)
+    {
+        return FALSE;
+    }
+
+    if (fh->data.data_val == NULL)
+    {
+        fh->data.data_val = (char *)malloc(len);
+    }
+    memcpy(fh->data.data_val, buf, len);
+
+    return TRUE;
+}
+
+/* GETATTR results */
+bool_t vcfs_xdr_GETATTR3res(XDR *xdrs, GETATTR3res *objp)
+{
+    int32_t *buf;
+    u_int units;
+
+    if (xdrs->x_op != XDR_ENCODE)
+    {
+        return xdr_GETATTR3res(xdrs, objp);
+    }
+
+    units = 1;
+    if (objp->status == NFS3_OK)
+    {
+        units += FATTR3_UNITS;
+    }
+
+    buf = XDR_INLINE(xdrs, units * BYTES_PER_XDR_UNIT);
+    if (buf == NULL)
+    {
+        return xdr_GETATTR3res(xdrs, objp);
+    }
+
+    IXDR_PUT_U_INT32(buf, objp->status);
+    if (objp->status == NFS3_OK)
+    {
+        buf = xdr_put_fattr3(buf,
+                             &objp->GETATTR3res_u.resok.obj_attributes);
+    }
+
+    VERIFY_ENCODE(xdr_GETATTR3res, objp, buf, units);
+    return TRUE;
+}
+
+/* LOOKUP results */
+bool_t vcfs_xdr_LOOKUP3res(XDR *xdrs, LOOKUP3res *objp)
+{
+    LOOKUP3resok *ok = &objp->LOOKUP3res_u.resok;
+    LOOKUP3resfail *fail = &objp->LOOKUP3res_u.resfail;
+    int32_t *buf;
+    u_int units;
+
+    if (xdrs->x_op != XDR_ENCODE ||
+        (objp->status == NFS3_OK && ok->object.data.data_len > NFS3_FHSIZE))
+    {
+        return xdr_LOOKUP3res(xdrs, objp);
+    }
+
+    units = 1;
+    if (objp->status == NFS3_OK)
+    {
+        units += 1 + UNITS(ok->object.data.data_len) +
+            post_op_attr_units(&ok->obj_attributes) +
+            post_op_attr_units(&ok->dir_attributes);
+    }
+    else
+    {
+        units += post_op_attr_units(&fail->dir_attributes);
+    }
+
+    buf = XDR_INLINE(xdrs, units * BYTES_PER_XDR_UNIT);
+    if (buf == NULL)
+    {
+        return xdr_LOOKUP3res(xdrs, objp);
+    }
+
+    IXDR_PUT_U_INT32(buf, objp->status);
+    if (objp->status == NFS3_OK)
+    {
+        buf = xdr_put_bytes(buf, ok->object.data.data_val,
+                            ok->object.data.data_len);
+        buf = xdr_put_post_op_attr(buf, &ok->obj_attributes);
+        buf = xdr_put_post_op_attr(buf, &ok->dir_attributes);
+    }
+    else
+    {
+        buf = xdr_put_post_op_attr(buf, &fail->dir_attributes);
+    }
+
+    VERIFY_ENCODE(xdr_LOOKUP3res, objp, buf, units);
+    return TRUE;
+}
+
+/* READ results. The data is usually empty, see rpc_reply() */
+bool_t vcfs_xdr_READ3res(XDR *xdrs, READ3res *objp)
+{
+    READ3resok *ok = &objp->READ3res_u.resok;
+    READ3resfail *fail = &objp->READ3res_u.resfail;
+    int32_t *buf;
+    u_int units;
+
+    if (xdrs->x_op != XDR_ENCODE)
+    {
+        return xdr_READ3res(xdrs, objp);
+    }
+
+    units = 1;
+    if (objp->status == NFS3_OK)
+    {
+        units += post_op_attr_units(&ok->file_attributes) + 3 +
+            UNITS(ok->data.data_len);
+    }
+    else
+    {
+        units += post_op_attr_units(&fail->file_attributes);
+    }
+
+    buf = XDR_INLINE(xdrs, units * BYTES_PER_XDR_UNIT);
+    if (buf == NULL)
+    {
+        return xdr_READ3res(xdrs, objp);
+    }
+
+    IXDR_PUT_U_INT32(buf, objp->status);
+    if (objp->status == NFS3_OK)
+    {
+        buf = xdr_put_post_op_attr(buf, &ok->file_attributes);
+        IXDR_PUT_U_INT32(buf, ok->count);
+        IXDR_PUT_U_INT32(buf, ok->eof);
+        buf = xdr_put_bytes(buf, ok->data.data_val, ok->data.data_len);
+    }
+    else
+    {
+        buf = xdr_put_post_op_attr(buf, &fail->file_attributes);
+    }
+
+    VERIFY_ENCODE(xdr_READ3res, objp, buf, units);
+    return TRUE;
+}
+
+/* READDIR results */
+bool_t vcfs_xdr_READDIR3res(XDR *xdrs, READDIR3res *objp)
+{
+    READDIR3resok *ok = &objp->READDIR3res_u.resok;
+    READDIR3resfail *fail = &objp->READDIR3res_u.resfail;
+    entry3 *e;
+    int32_t *buf;
+    u_int units;
+
+    if (xdrs->x_op != XDR_ENCODE)
+    {
+        return xdr_READDIR3res(xdrs, objp);
+    }
+
+    units = 1;
+    if (objp->status == NFS3_OK)
+    {
+        units += post_op_attr_units(&ok->dir_attributes) + COOKIEVERF3_UNITS;
+        for (e = ok->reply.entries; e != NULL; e = e->nextentry)
+        {
+            units += 6 + UNITS(strlen(e->name));
+        }
+        units += 2;
+    }
+    else
+    {
+        units += post_op_attr_units(&fail->dir_attributes);
+    }
+
+    buf = XDR_INLINE(xdrs, units * BYTES_PER_XDR_UNIT);
+    if (buf == NULL)
+    {
+        return xdr_READDIR3res(xdrs, objp);
+    }
+
+    IXDR_PUT_U_INT32(buf, objp->status);
+    if (objp->status == NFS3_OK)
+    {
+        buf = xdr_put_post_op_attr(buf, &ok->dir_attributes);
+        memcpy(buf, ok->cookieverf, NFS3_COOKIEVERFSIZE);
+        buf += COOKIEVERF3_UNITS;
+
+        for (e = ok->reply.entries; e != NULL; e = e->nextentry)
+        {
+            IXDR_PUT_U_INT32(buf, TRUE);
+            PUT_HYPER(buf, e->fileid);
+            buf = xdr_put_bytes(buf, e->name, strlen(e->name));
+            PUT_HYPER(buf, e->cookie);
+        }
+        IXDR_PUT_U_INT32(buf, FALSE);
+        IXDR_PUT_U_INT32(buf, ok->reply.eof);
+    }
+    else
+    {
+        buf = xdr_put_post_op_attr(buf, &fail->dir_attributes);
+    }
+
+    VERIFY_ENCODE(xdr_READDIR3res, objp, buf, units);
+    return TRUE;
+}
+
+/* GETATTR arguments */
+bool_t vcfs_xdr_nfs_fh3(XDR *xdrs, nfs_fh3 *objp)
+{
+#ifdef VCFS_XDR_VERIFY
+    u_int pos;
+#endif
+
+    if (xdrs->x_op != XDR_DECODE)
+    {
+        return xdr_nfs_fh3(xdrs, objp);
+    }
+
+    VERIFY_MARK(xdrs, pos);
+    if (!xdr_get_fh3(xdrs, objp))
+    {
+        return FALSE;
+    }
+
+    VERIFY_DECODE(xdr_nfs_fh3, objp, xdrs, pos);
+    return TRUE;
+}
+
+/* LOOKUP arguments */
+bool_t vcfs_xdr_diropargs3(XDR *xdrs, diropargs3 *objp)
+{
+    int32_t *buf;
+#ifdef VCFS_XDR_VERIFY
+    u_int pos;
+#endif
+
+    if (xdrs->x_op != XDR_DECODE)
+    {
+        return xdr_diropargs3(xdrs, objp);
+    }
+
+    VERIFY_MARK(xdrs, pos);
+    if (!xdr_get_fh3(xdrs, &objp->dir))
+    {
+        return FALSE;
+    }
+
+    buf = XDR_INLINE(xdrs, BYTES_PER_XDR_UNIT);
+    if (buf == NULL ||
+        !xdr_get_string(xdrs, &objp->name, IXDR_GET_U_INT32(buf)))
+    {
+        return FALSE;
+    }
+
+    VERIFY_DECODE(xdr_diropargs3, objp, xdrs, pos);
+    return TRUE;
+}
+
+/* READ arguments */
+bool_t vcfs_xdr_READ3args(XDR *xdrs, READ3args *objp)
+{
+    int32_t *buf;
+#ifdef VCFS_XDR_VERIFY
+    u_int pos;
+#endif
+
+    if (xdrs->x_op != XDR_DECODE)
+    {
+        return xdr_READ3args(xdrs, objp);
+    }
+
+    VERIFY_MARK(xdrs, pos);
+    if (!xdr_get_fh3(xdrs, &objp->file))
+    {
+        return FALSE;
+    }
+
+    buf = XDR_INLINE(xdrs, 3 * BYTES_PER_XDR_UNIT);
+    if (buf == NULL)
+    {
+        return FALSE;
+    }
+    GET_HYPER(buf, objp->offset);
+    objp->count = IXDR_GET_U_INT32(buf);
+
+    VERIFY_DECODE(xdr_READ3args, objp, xdrs, pos);
+    return TRUE;
+}
+
+/* READDIR arguments */
+bool_t vcfs_xdr_READDIR3args(XDR *xdrs, READDIR3args *objp)
+{
+    int32_t *buf;
+#ifdef VCFS_XDR_VERIFY
+    u_int pos;
+#endif
+
+    if (xdrs->x_op != XDR_DECODE)
+    {
+        return xdr_READDIR3args(xdrs, objp);
+    }
+
+    VERIFY_MARK(xdrs, pos);
+    if (!xdr_get_fh3(xdrs, &objp->dir))
+    {
+        return FALSE;
+    }
+
+    buf = XDR_INLINE(xdrs, 3 * BYTES_PER_XDR_UNIT + NFS3_COOKIEVERFSIZE);
+    if (buf == NULL)
+    {
+        return FALSE;
+    }
+    GET_HYPER(buf, objp->cookie);
+    memcpy(objp->cookieverf, buf, NFS3_COOKIEVERFSIZE);
+    buf += COOKIEVERF3_UNITS;
+    objp->count = IXDR_GET_U_INT32(buf);
+
+    VERIFY_DECODE(xdr_READDIR3args, objp, xdrs, pos);
+    return TRUE;
+}